@@ -6,11 +6,11 @@ if not exist build (
 
 set RAYLIB=build\_deps\raylib-build\raylib\Debug\raylib.lib
 set INCLUD=build\_deps\raylib-src\src
-set SOURCE=src\*.c
+set SOURCE=src\*.c src\core\*.c
 set OUTPUT=build\src\Debug\raylib_game.exe
 set WINLIB=user32.lib winmm.lib gdi32.lib shell32.lib
 
-cl /MDd %RAYLIB% %WINLIB% %SOURCE% /I %INCLUD% /Fe:%OUTPUT%
+cl /MDd %RAYLIB% %WINLIB% %SOURCE% /I %INCLUD% /I src /Fe:%OUTPUT%
 if %errorlevel% neq 0 exit /b %errorlevel%
 
 %OUTPUT%
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*******************************************************************************************
+*
+*   Nettis core - 128-bit cell masks
+*
+*   A bitboard holds one bit per board cell, cell (x, y) at bit y*BOARD_WIDTH + x. Shifting
+*   by BOARD_WIDTH bits moves a whole mask one row, so bulk board operations become a
+*   handful of word operations
+*
+********************************************************************************************/
+
+#ifndef NETTIS_BITBOARD_H
+#define NETTIS_BITBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    uint64_t Lo;        // Bits 0..63
+    uint64_t Hi;        // Bits 64..127
+} bitboard;
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (inline, used on every hot path)
+//----------------------------------------------------------------------------------
+static inline bitboard BB_Cell(int i)
+{
+    bitboard Result = { 0 };
+    if (i < 64) Result.Lo = (uint64_t)1 << i;
+    else Result.Hi = (uint64_t)1 << (i - 64);
+    return Result;
+}
+
+// Mask with the lowest Count bits set
+static inline bitboard BB_Range(int Count)
+{
+    bitboard Result = { 0 };
+    if (Count >= 128) { Result.Lo = ~(uint64_t)0; Result.Hi = ~(uint64_t)0; }
+    else if (Count >= 64) { Result.Lo = ~(uint64_t)0; Result.Hi = (Count > 64)? (~(uint64_t)0 >> (128 - Count)) : 0; }
+    else if (Count > 0) Result.Lo = ~(uint64_t)0 >> (64 - Count);
+    return Result;
+}
+
+static inline bool BB_Test(bitboard Mask, int i)
+{
+    return (i < 64)? ((Mask.Lo >> i) & 1) : ((Mask.Hi >> (i - 64)) & 1);
+}
+
+static inline bool BB_IsEmpty(bitboard Mask)
+{
+    return (Mask.Lo | Mask.Hi) == 0;
+}
+
+static inline bool BB_Equal(bitboard a, bitboard b)
+{
+    return a.Lo == b.Lo && a.Hi == b.Hi;
+}
+
+static inline bitboard BB_And(bitboard a, bitboard b)
+{
+    return (bitboard){ a.Lo & b.Lo, a.Hi & b.Hi };
+}
+
+static inline bitboard BB_Or(bitboard a, bitboard b)
+{
+    return (bitboard){ a.Lo | b.Lo, a.Hi | b.Hi };
+}
+
+static inline bitboard BB_AndNot(bitboard a, bitboard b)
+{
+    return (bitboard){ a.Lo & ~b.Lo, a.Hi & ~b.Hi };
+}
+
+static inline bitboard BB_Xor(bitboard a, bitboard b)
+{
+    return (bitboard){ a.Lo ^ b.Lo, a.Hi ^ b.Hi };
+}
+
+// Moves every bit n positions towards higher cell indices (0 < n < 64)
+static inline bitboard BB_ShiftLeft(bitboard Mask, int n)
+{
+    return (bitboard){ Mask.Lo << n, (Mask.Hi << n) | (Mask.Lo >> (64 - n)) };
+}
+
+// Moves every bit n positions towards lower cell indices (0 < n < 64)
+static inline bitboard BB_ShiftRight(bitboard Mask, int n)
+{
+    return (bitboard){ (Mask.Lo >> n) | (Mask.Hi << (64 - n)), Mask.Hi >> n };
+}
+
+static inline int BB_PopCount64(uint64_t Word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(Word);
+#else
+    int Count = 0;
+    for (; Word != 0; Word &= Word - 1) Count++;
+    return Count;
+#endif
+}
+
+static inline int BB_LowestBit64(uint64_t Word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(Word);
+#else
+    int Index = 0;
+    while ((Word & 1) == 0) { Word >>= 1; Index++; }
+    return Index;
+#endif
+}
+
+static inline int BB_PopCount(bitboard Mask)
+{
+    return BB_PopCount64(Mask.Lo) + BB_PopCount64(Mask.Hi);
+}
+
+// Index of the lowest set bit, the mask must not be empty
+static inline int BB_Lowest(bitboard Mask)
+{
+    return (Mask.Lo != 0)? BB_LowestBit64(Mask.Lo) : 64 + BB_LowestBit64(Mask.Hi);
+}
+
+#endif // NETTIS_BITBOARD_H
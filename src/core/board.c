@@ -0,0 +1,393 @@
+/*******************************************************************************************
+*
+*   Nettis core - board storage, placement and gravity
+*
+********************************************************************************************/
+
+#include "board.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//--------------------------------------------------------------------------------------------
+// Key of a whole piece plane, both halves and the piece scrambled together so there is no
+// table to set up. An empty plane has no key, a zeroed board hashes to zero
+static inline uint64_t Board_PlaneKey(bitboard Plane, int Piece)
+{
+    if (BB_IsEmpty(Plane))
+    {
+        return 0;
+    }
+
+    uint64_t z = Plane.Lo*0x9E3779B97F4A7C15ULL ^ (Plane.Hi + ((uint64_t)Piece << 32))*0xC2B2AE3D27D4EB4FULL;
+    z = (z ^ (z >> 29))*0xBF58476D1CE4E5B9ULL;
+    return z ^ (z >> 32);
+}
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+// Empties the board as a change, so nothing derived from the old contents is reused
+void Board_Reset(board *Board)
+{
+    unsigned int Version = Board->Version;
+
+    *Board = (board){ 0 };
+    Board->Version = Version + 1;
+    Board->Touched = BOARD_MASK_FULL;
+}
+
+// Returns the cells changed since the last call and starts a new journal
+bitboard Board_TakeTouched(board *Board)
+{
+    bitboard Touched = Board->Touched;
+    Board->Touched = (bitboard){ 0 };
+    return Touched;
+}
+
+// Grows a mask by one cell in the four directions
+bitboard Board_Dilate(bitboard Mask)
+{
+    bitboard FirstColumn = { 0 }, LastColumn = { 0 };
+    for (int y = 0; y < BOARD_HEIGHT; y++)
+    {
+        FirstColumn = BB_Or(FirstColumn, BB_Cell(BOARD_INDEX(0, y)));
+        LastColumn = BB_Or(LastColumn, BB_Cell(BOARD_INDEX(BOARD_WIDTH - 1, y)));
+    }
+
+    bitboard Result = Mask;
+    Result = BB_Or(Result, BB_ShiftLeft(BB_AndNot(Mask, LastColumn), 1));
+    Result = BB_Or(Result, BB_ShiftRight(BB_AndNot(Mask, FirstColumn), 1));
+    Result = BB_Or(Result, BB_ShiftLeft(Mask, BOARD_WIDTH));
+    Result = BB_Or(Result, BB_ShiftRight(Mask, BOARD_WIDTH));
+
+    return BB_And(Result, BOARD_MASK_FULL);
+}
+
+piece Board_GetTile(board *Board, int x, int y)
+{
+    int i = BOARD_INDEX(x, y);
+
+    if (!BB_Test(Board->Occupied, i))
+    {
+        return PIECE_EMPTY;
+    }
+
+    for (int Piece = PIECE_EMPTY + 1; Piece < PIECE_PALLETE_SIZE; Piece++)
+    {
+        if (BB_Test(Board->Planes[Piece], i))
+        {
+            return Piece;
+        }
+    }
+
+    return PIECE_EMPTY;
+}
+
+// Overwrites a cell inside the board, PIECE_EMPTY clears it
+void Board_SetTile(board *Board, int x, int y, piece Piece)
+{
+    bitboard Cell = BB_Cell(BOARD_INDEX(x, y));
+    piece Old = Board_GetTile(Board, x, y);
+
+    if (Old == Piece)
+    {
+        return;
+    }
+
+    Board->Version++;
+    Board->Touched = BB_Or(Board->Touched, Cell);
+
+    // Only the two planes that change swap their keys
+    Board->Hash ^= Board_PlaneKey(Board->Planes[Old], Old) ^ Board_PlaneKey(Board->Planes[Piece], Piece);
+    for (int i = PIECE_EMPTY + 1; i < PIECE_PALLETE_SIZE; i++)
+    {
+        Board->Planes[i] = BB_AndNot(Board->Planes[i], Cell);
+    }
+    Board->Occupied = BB_AndNot(Board->Occupied, Cell);
+
+    if (Piece != PIECE_EMPTY)
+    {
+        Board->Planes[Piece] = BB_Or(Board->Planes[Piece], Cell);
+        Board->Occupied = BB_Or(Board->Occupied, Cell);
+    }
+    Board->Hash ^= Board_PlaneKey(Board->Planes[Old], Old) ^ Board_PlaneKey(Board->Planes[Piece], Piece);
+}
+
+void Board_PutTileSafe(board *Board, int x, int y, piece Piece)
+{
+    if (Piece == PIECE_EMPTY)
+    {
+        return;
+    }
+
+    if (!Board_IsOob(Board, x, y))
+    {
+        Board_SetTile(Board, x, y, Piece);
+    }
+}
+
+void Board_PutBrick(board *Board, brick *Brick)
+{
+    int x[2], y[2];
+    Brick_Locations(Brick, x, y);
+    Board_PutTileSafe(Board, x[0], y[0], Brick->Pieces[0]);
+    Board_PutTileSafe(Board, x[1], y[1], Brick->Pieces[1]);
+}
+
+brick Board_BumpBrick(board *Board, brick *Brick)
+{
+    brick NewBrick;
+    memcpy(&NewBrick, Brick, sizeof(brick));
+    if (NewBrick.Pieces[0] == PIECE_EMPTY || NewBrick.Pieces[1] == PIECE_EMPTY)
+    {
+        while (true) {
+            int x = NewBrick.x, y = NewBrick.y;
+            if (x < 0) NewBrick.x++;
+            else if (x >= BOARD_WIDTH) NewBrick.x--;
+            else if (y < 0) NewBrick.y++;
+            else break;
+        }
+        return NewBrick;
+    }
+
+    int x[2], y[2];
+    while (true) {
+        Brick_Locations(&NewBrick, x, y);
+
+        if (x[0] < 0 || x[1] < 0) NewBrick.x++;
+        else if (x[0] >= BOARD_WIDTH || x[1] >= BOARD_WIDTH) NewBrick.x--;
+        else if (y[0] < 0 || y[1] < 0) NewBrick.y++;
+        else break;
+    }
+
+    return NewBrick;
+}
+
+bool Board_IsOob(board *Board, int x, int y)
+{
+    return x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT;
+}
+
+bool Board_IsOccupied(board *Board, int x, int y)
+{
+    if (Board_IsOob(Board, x, y)) 
+        return true;
+
+    return BB_Test(Board->Occupied, BOARD_INDEX(x, y));
+}
+
+// Cells covered by the non-empty pieces of a brick, parts outside the board are left out
+bitboard Board_BrickMask(board *Board, brick *Brick)
+{
+    int x[2], y[2];
+    Brick_Locations(Brick, x, y);
+
+    bitboard Mask = { 0 };
+    for (int i = 0; i < 2; i++)
+    {
+        if (Brick->Pieces[i] != PIECE_EMPTY && !Board_IsOob(Board, x[i], y[i]))
+        {
+            Mask = BB_Or(Mask, BB_Cell(BOARD_INDEX(x[i], y[i])));
+        }
+    }
+
+    return Mask;
+}
+
+bool Board_ShouldPlaceBrick(board *Board, brick *Brick)
+{
+    int x[2], y[2];
+    Brick_Locations(Brick, x, y);
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (Brick->Pieces[i] != PIECE_EMPTY && Board_IsOob(Board, x[i], y[i]))
+        {
+            return true;
+        }
+    }
+
+    return !BB_IsEmpty(BB_And(Board_BrickMask(Board, Brick), Board->Occupied));
+}
+
+// Occupied cells with an empty cell right below them
+bitboard Board_FallingMask(board *Board)
+{
+    bitboard Empty = BB_AndNot(BOARD_MASK_FULL, Board->Occupied);
+    return BB_And(Board->Occupied, BB_ShiftRight(Empty, BOARD_WIDTH));
+}
+
+bitboard Board_ConnectionMask(board *Board)
+{
+    bitboard Mask = { 0 };
+    for (int Piece = PIECE_HCONN; Piece <= PIECE_UR; Piece++)
+    {
+        Mask = BB_Or(Mask, Board->Planes[Piece]);
+    }
+
+    return Mask;
+}
+
+// Moves every unsupported piece one row down, returns false once the board has settled
+bool Board_GravityStep(board *Board)
+{
+    bitboard Falling = Board_FallingMask(Board);
+
+    if (BB_IsEmpty(Falling))
+    {
+        return false;
+    }
+
+    for (int Piece = PIECE_EMPTY + 1; Piece < PIECE_PALLETE_SIZE; Piece++)
+    {
+        bitboard Moving = BB_And(Board->Planes[Piece], Falling);
+        if (BB_IsEmpty(Moving))
+        {
+            continue;
+        }
+
+        Board->Hash ^= Board_PlaneKey(Board->Planes[Piece], Piece);
+        Board->Planes[Piece] = BB_Or(BB_AndNot(Board->Planes[Piece], Moving), BB_ShiftLeft(Moving, BOARD_WIDTH));
+        Board->Hash ^= Board_PlaneKey(Board->Planes[Piece], Piece);
+    }
+    Board->Occupied = BB_Or(BB_AndNot(Board->Occupied, Falling), BB_ShiftLeft(Falling, BOARD_WIDTH));
+    Board->Version++;
+    Board->Touched = BB_Or(Board->Touched, BB_Or(Falling, BB_ShiftLeft(Falling, BOARD_WIDTH)));
+
+    return true;
+}
+
+// Drops every piece as far as it goes in a single pass over each column, the same result as
+// running Board_GravityStep() until it returns false. Falls is optional and receives every
+// piece that moved; the number of moved pieces is returned
+int Board_Settle(board *Board, board_falls *Falls)
+{
+    int Count = 0;
+
+    if (BB_IsEmpty(Board_FallingMask(Board)))
+    {
+        if (Falls != NULL) Falls->Count = 0;
+        return 0;
+    }
+
+    bitboard Before[PIECE_PALLETE_SIZE];
+    memcpy(Before, Board->Planes, sizeof(Before));
+    bitboard Moved = { 0 };
+
+    for (int x = 0; x < BOARD_WIDTH; x++)
+    {
+        int Floor = BOARD_HEIGHT - 1;
+
+        for (int y = BOARD_HEIGHT - 1; y >= 0; y--)
+        {
+            if (!BB_Test(Board->Occupied, BOARD_INDEX(x, y)))
+            {
+                continue;
+            }
+
+            if (y != Floor)
+            {
+                piece Piece = Board_GetTile(Board, x, y);
+                bitboard Move = BB_Or(BB_Cell(BOARD_INDEX(x, y)), BB_Cell(BOARD_INDEX(x, Floor)));
+                Board->Planes[Piece] = BB_Xor(Board->Planes[Piece], Move);
+                Board->Occupied = BB_Xor(Board->Occupied, Move);
+                Moved = BB_Or(Moved, Move);
+
+                if (Falls != NULL)
+                {
+                    Falls->Falls[Count] = (board_fall){ x, y, Floor };
+                }
+                Count++;
+            }
+
+            Floor--;
+        }
+    }
+
+    // One key swap per plane, however many of its pieces fell
+    for (int Piece = PIECE_EMPTY + 1; Piece < PIECE_PALLETE_SIZE; Piece++)
+    {
+        if (!BB_Equal(Before[Piece], Board->Planes[Piece]))
+        {
+            Board->Hash ^= Board_PlaneKey(Before[Piece], Piece) ^ Board_PlaneKey(Board->Planes[Piece], Piece);
+        }
+    }
+    Board->Version++;
+    Board->Touched = BB_Or(Board->Touched, Moved);
+
+    if (Falls != NULL) Falls->Count = Count;
+    return Count;
+}
+
+void Board_CleanSurroundings(board *Board, int x, int y)
+{
+    struct {
+        int x, y;
+    } Positions[8] = {
+        { 0, 1 },
+        { 1, 0 },
+        { 0, -1 },
+        { -1, 0 },
+        { 1, 1 },
+        { -1, 1 },
+        { 1, -1 },
+        { -1, -1 },
+    };
+
+    bitboard Around = { 0 };
+    for (int i = 0; i < 8; i++)
+    {
+        int x2 = x + Positions[i].x;
+        int y2 = y + Positions[i].y;
+
+        if (Board_IsOob(Board, x2, y2))
+        {
+            continue;
+        }
+
+        Around = BB_Or(Around, BB_Cell(BOARD_INDEX(x2, y2)));
+    }
+
+    bitboard Junk = BB_And(Board->Planes[PIECE_JUNK], Around);
+    if (BB_IsEmpty(Junk))
+    {
+        return;
+    }
+
+    Board->Hash ^= Board_PlaneKey(Board->Planes[PIECE_JUNK], PIECE_JUNK);
+    Board->Planes[PIECE_JUNK] = BB_AndNot(Board->Planes[PIECE_JUNK], Junk);
+    Board->Hash ^= Board_PlaneKey(Board->Planes[PIECE_JUNK], PIECE_JUNK);
+    Board->Occupied = BB_AndNot(Board->Occupied, Junk);
+    Board->Version++;
+    Board->Touched = BB_Or(Board->Touched, Junk);
+}
+
+uint64_t Board_ComputeHash(board *Board)
+{
+    uint64_t Hash = 0;
+    for (int Piece = PIECE_EMPTY + 1; Piece < PIECE_PALLETE_SIZE; Piece++)
+    {
+        Hash ^= Board_PlaneKey(Board->Planes[Piece], Piece);
+    }
+
+    return Hash;
+}
+
+// FNV-1a over the pieces in cell order, independent of how the board stores them
+unsigned int Board_Checksum(board *Board)
+{
+    unsigned int Hash = 2166136261u;
+
+    for (int y = 0; y < BOARD_HEIGHT; y++)
+    {
+        for (int x = 0; x < BOARD_WIDTH; x++)
+        {
+            Hash ^= (unsigned int)Board_GetTile(Board, x, y);
+            Hash *= 16777619u;
+        }
+    }
+
+    return Hash;
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************************
+*
+*   Nettis core - board storage, placement and gravity
+*
+********************************************************************************************/
+
+#ifndef NETTIS_BOARD_H
+#define NETTIS_BOARD_H
+
+#include "piece.h"
+#include "brick.h"
+#include "bitboard.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BOARD_WIDTH 6
+#define BOARD_HEIGHT 13
+#define BOARD_CELLS (BOARD_WIDTH*BOARD_HEIGHT)
+
+#define BOARD_INDEX(x, y) ((y)*BOARD_WIDTH + (x))
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Each cell is set in Occupied and in the plane of its piece type, empty cells in neither.
+// Planes[PIECE_EMPTY] is always zero, a zeroed board is an empty board.
+// Every change bumps Version and marks the cells it touched in Touched, so anything derived
+// from the board can tell whether, and where, it has to be recomputed. Hash is the XOR of a
+// key per piece plane, kept up to date by every change from the planes it rewrites: equal
+// boards hash equal however they were reached
+typedef struct {
+    bitboard Occupied;
+    bitboard Planes[PIECE_PALLETE_SIZE];
+    unsigned int Version;
+    bitboard Touched;
+    uint64_t Hash;
+} board;
+
+// A piece moved by Board_Settle(), it fell from (x, FromY) to (x, ToY)
+typedef struct {
+    unsigned char x;
+    unsigned char FromY;
+    unsigned char ToY;
+} board_fall;
+
+typedef struct {
+    board_fall Falls[BOARD_CELLS];
+    int Count;
+} board_falls;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void Board_Reset(board *Board);
+bitboard Board_TakeTouched(board *Board);
+bitboard Board_Dilate(bitboard Mask);
+piece Board_GetTile(board *Board, int x, int y);
+void Board_SetTile(board *Board, int x, int y, piece Piece);
+void Board_PutTileSafe(board *Board, int x, int y, piece Piece);
+void Board_PutBrick(board *Board, brick *Brick);
+brick Board_BumpBrick(board *Board, brick *Brick);
+bool Board_IsOob(board *Board, int x, int y);
+bool Board_IsOccupied(board *Board, int x, int y);
+bool Board_ShouldPlaceBrick(board *Board, brick *Brick);
+bitboard Board_BrickMask(board *Board, brick *Brick);
+bitboard Board_FallingMask(board *Board);
+bitboard Board_ConnectionMask(board *Board);
+bool Board_GravityStep(board *Board);
+int Board_Settle(board *Board, board_falls *Falls);
+void Board_CleanSurroundings(board *Board, int x, int y);
+unsigned int Board_Checksum(board *Board);                 // Same pieces, same checksum
+uint64_t Board_ComputeHash(board *Board);                  // Hash from scratch, what Hash should hold
+
+// The cells that exist on the board
+#define BOARD_MASK_FULL BB_Range(BOARD_CELLS)
+
+#endif // NETTIS_BOARD_H
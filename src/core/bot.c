@@ -0,0 +1,473 @@
+/*******************************************************************************************
+*
+*   Nettis core - placement search bot
+*
+********************************************************************************************/
+
+#include "bot.h"
+#include "zone.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BOT_UNREACHED -2
+#define BOT_ROOT -1
+
+// Board evaluation weights, points won are counted one to one
+#define BOT_WEIGHT_HEIGHT -0.5f         // Per piece, times the height it sits at
+#define BOT_WEIGHT_PEAK -2.0f           // Per row of the highest column
+#define BOT_WEIGHT_JUNK -1.5f           // Per junk piece
+#define BOT_WEIGHT_DANGLING -1.0f       // Per wire in a network open off the board
+#define BOT_WEIGHT_BLOCKED -100000.0f   // Next brick cannot spawn, the game is lost
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Breadth-first search over the brick states reachable with player input
+typedef struct {
+    brick Queue[BOT_STATES];
+    int Count;
+    short Parent[BOT_STATES];           // State the first visit came from, or BOT_UNREACHED
+    unsigned char Input[BOT_STATES];    // GP_INPUT_* that led there from Parent
+} bot_explore;
+
+typedef struct {
+    bot *Bot;
+    brick *Brick;
+    int Level;
+} bot_level;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static int Bot_StateIndex(brick *Brick);
+static void Bot_Explore(board *Board, brick *Start, bot_explore *Explore);
+static void Bot_ExpandNode(void *Context, int Index);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool Bot_Init(bot *Bot, int Depth, int Width, bot_parallel_for ParallelFor)
+{
+    *Bot = (bot){ 0 };
+    Bot->Depth = (Depth < 1)? 1 : (Depth > BOT_MAX_DEPTH)? BOT_MAX_DEPTH : Depth;
+    Bot->Width = (Width < 1)? 1 : Width;
+    Bot->ParallelFor = ParallelFor;
+    Bot_Restart(Bot);
+
+    Bot->Beam = malloc(sizeof(bot_node)*Bot->Width);
+    Bot->Children = malloc(sizeof(bot_node)*Bot->Width*BOT_STATES);
+    Bot->ChildCount = malloc(sizeof(int)*Bot->Width);
+    Bot->Order = malloc(sizeof(int)*Bot->Width*BOT_STATES);
+    Bot->Caches = calloc(Bot->Width, sizeof(trace_cache));
+
+    if (Bot->Beam == NULL || Bot->Children == NULL || Bot->ChildCount == NULL || Bot->Order == NULL || Bot->Caches == NULL)
+    {
+        Bot_Free(Bot);
+        return false;
+    }
+
+    for (int i = 0; i < Bot->Width; i++)
+    {
+        if (!Cache_Init(&Bot->Caches[i], BOT_CACHE_ENTRIES))
+        {
+            Bot_Free(Bot);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Bot_Free(bot *Bot)
+{
+    free(Bot->Beam);
+    free(Bot->Children);
+    free(Bot->ChildCount);
+    free(Bot->Order);
+    for (int i = 0; Bot->Caches != NULL && i < Bot->Width; i++)
+    {
+        Cache_Free(&Bot->Caches[i]);
+    }
+    free(Bot->Caches);
+    *Bot = (bot){ 0 };
+}
+
+// The result only depends on the game state, never on how the levels were split over threads
+bool Bot_Search(bot *Bot, gameplay *Gameplay, brick *Target)
+{
+    // Searches copy whole boards around, only the standard one is small enough
+    if (GP_IsField(Gameplay))
+    {
+        return false;
+    }
+
+    brick Bricks[BOT_MAX_DEPTH];
+    Bricks[0] = Gameplay->Brick;
+    for (int d = 1; d < Bot->Depth; d++)
+    {
+        Bricks[d] = *Brick_QueuePeek(&Gameplay->Queue, d - 1);
+    }
+
+    Bot->Beam[0].Board = Gameplay->Board;
+    Bot->Beam[0].Points = 0;
+    Bot->Beam[0].Value = 0.0f;
+    Bot->Beam[0].First = Gameplay->Brick;
+    int BeamCount = 1;
+
+    for (int Level = 0; Level < Bot->Depth; Level++)
+    {
+        bot_level Context = { Bot, &Bricks[Level], Level };
+
+        if (Bot->ParallelFor != NULL) Bot->ParallelFor(BeamCount, Bot_ExpandNode, &Context);
+        else for (int i = 0; i < BeamCount; i++) Bot_ExpandNode(&Context, i);
+
+        int Count = 0;
+        for (int i = 0; i < BeamCount; i++)
+        {
+            for (int c = 0; c < Bot->ChildCount[i]; c++)
+            {
+                Bot->Order[Count++] = i*BOT_STATES + c;
+            }
+        }
+        Bot->Nodes += Count;
+
+        if (Count == 0)
+        {
+            if (Level == 0) return false;
+            break;
+        }
+
+        // Partial selection of the best Width children, ties go to the earlier child
+        int Keep = (Count < Bot->Width)? Count : Bot->Width;
+        for (int k = 0; k < Keep; k++)
+        {
+            int Best = k;
+            for (int j = k + 1; j < Count; j++)
+            {
+                if (Bot->Children[Bot->Order[j]].Value > Bot->Children[Bot->Order[Best]].Value ||
+                    (Bot->Children[Bot->Order[j]].Value == Bot->Children[Bot->Order[Best]].Value && Bot->Order[j] < Bot->Order[Best]))
+                {
+                    Best = j;
+                }
+            }
+
+            int Swap = Bot->Order[k];
+            Bot->Order[k] = Bot->Order[Best];
+            Bot->Order[Best] = Swap;
+            Bot->Beam[k] = Bot->Children[Bot->Order[k]];
+        }
+        BeamCount = Keep;
+    }
+
+    *Target = Bot->Beam[0].First;
+    return true;
+}
+
+void Bot_Restart(bot *Bot)
+{
+    Bot->HasTarget = false;
+    Bot->BrickHead = -1;
+}
+
+// Searches once per brick, as soon as the clears and junk of the last lock are over and
+// evaluated, so the search sees the board the brick will really land on. Searches again if
+// gravity took the brick past its path
+unsigned int Bot_Play(bot *Bot, gameplay *Gameplay)
+{
+    if (GP_IsField(Gameplay))
+    {
+        return 0;
+    }
+
+    if (Gameplay->Queue.Head != Bot->BrickHead)
+    {
+        Bot->BrickHead = Gameplay->Queue.Head;
+        Bot->HasTarget = false;
+    }
+
+    if (!GP_IsIdle(Gameplay))
+    {
+        return 0;
+    }
+
+    unsigned int Input = 0;
+    if (Bot->HasTarget)
+    {
+        Input = Bot_NextInput(&Gameplay->Board, &Gameplay->Brick, &Bot->Target);
+    }
+
+    if (Input == 0)
+    {
+        Bot->Searches++;
+        Bot->HasTarget = Bot_Search(Bot, Gameplay, &Bot->Target);
+        if (Bot->HasTarget)
+        {
+            Input = Bot_NextInput(&Gameplay->Board, &Gameplay->Brick, &Bot->Target);
+        }
+    }
+
+    return Input;
+}
+
+// Every state where the brick locks when moved down, duplicates of the same locked pieces
+// removed. Placements is filled in the order the states are reached
+int Bot_Placements(board *Board, brick *Brick, brick *Placements)
+{
+    bot_explore Explore;
+    Bot_Explore(Board, Brick, &Explore);
+
+    unsigned int Keys[BOT_STATES];
+    int Count = 0;
+
+    for (int i = 0; i < Explore.Count; i++)
+    {
+        brick *State = &Explore.Queue[i];
+        brick Below = Brick_Move(State, 0, 1);
+        if (!Board_ShouldPlaceBrick(Board, &Below))
+        {
+            continue;
+        }
+
+        // Cells and pieces it locks, the lower cell first
+        int x[2], y[2];
+        Brick_Locations(State, x, y);
+        unsigned int Parts[2];
+        for (int p = 0; p < 2; p++)
+        {
+            bool Placed = State->Pieces[p] != PIECE_EMPTY && !Board_IsOob(Board, x[p], y[p]);
+            Parts[p] = Placed? (unsigned int)(BOARD_INDEX(x[p], y[p]) + 1)<<4 | State->Pieces[p] : 0;
+        }
+        unsigned int Key = (Parts[0] < Parts[1])? Parts[0]<<16 | Parts[1] : Parts[1]<<16 | Parts[0];
+
+        bool Seen = false;
+        for (int k = 0; k < Count && !Seen; k++)
+        {
+            Seen = Keys[k] == Key;
+        }
+        if (Seen)
+        {
+            continue;
+        }
+
+        Keys[Count] = Key;
+        Placements[Count++] = *State;
+    }
+
+    return Count;
+}
+
+// First input of the shortest path to Target, down once the brick is there
+unsigned int Bot_NextInput(board *Board, brick *Brick, brick *Target)
+{
+    if (Brick->x == Target->x && Brick->y == Target->y && Brick->Orientation == Target->Orientation)
+    {
+        return GP_INPUT_DOWN;
+    }
+
+    bot_explore Explore;
+    Bot_Explore(Board, Brick, &Explore);
+
+    if (Explore.Count == 0)
+    {
+        return 0;
+    }
+
+    int State = Bot_StateIndex(Target);
+    if (Explore.Parent[State] == BOT_UNREACHED)
+    {
+        return 0;
+    }
+
+    while (Explore.Parent[State] != Bot_StateIndex(Brick))
+    {
+        State = Explore.Parent[State];
+    }
+
+    return Explore.Input[State];
+}
+
+// Same order as GP_Update(): every circuit is cleared, then junk spreads, then pieces settle
+// and chains start over. Everything happens at once, without the clearing timers
+int Bot_Resolve(board *Board, trace_cache *Cache)
+{
+    power_board Powers;
+    trace Trace;
+    scoring Scoring = { 0 };
+
+    while (true)
+    {
+        Scoring.Multiplier += 1;
+        Cache_GetTrace(Cache, Board, &Powers, &Trace);
+
+        if (Trace.Count > 0)
+        {
+            for (int i = 0; i < Trace.Count; i++)
+            {
+                int x = Trace.Cells[i] % BOARD_WIDTH, y = Trace.Cells[i] / BOARD_WIDTH;
+                Scoring_AddCleared(&Scoring, Board_GetTile(Board, x, y));
+                Board_SetTile(Board, x, y, PIECE_EMPTY);
+                ZONE_BEGIN("Board_CleanSurroundings");
+                Board_CleanSurroundings(Board, x, y);
+                ZONE_END();
+            }
+            continue;
+        }
+
+        Scoring.Multiplier += 1;
+        Cache_GetTraceJunk(Cache, Board, &Trace);
+
+        if (Trace.Count > 0)
+        {
+            for (int i = 0; i < Trace.Count; i++)
+            {
+                Board_SetTile(Board, Trace.Cells[i] % BOARD_WIDTH, Trace.Cells[i] / BOARD_WIDTH, PIECE_JUNK);
+            }
+            continue;
+        }
+
+        Scoring.NodeChain = 0;
+        Scoring.WireChain = 0;
+        Scoring.Multiplier = 0;
+
+        ZONE_BEGIN("Board_Settle");
+        int Fallen = Board_Settle(Board, NULL);
+        ZONE_END();
+        if (Fallen == 0)
+        {
+            break;
+        }
+    }
+
+    return Scoring.Score;
+}
+
+// Higher is better. Expects a settled board, so a column height is its piece count
+float Bot_Evaluate(board *Board)
+{
+    float Value = 0.0f;
+    int Peak = 0;
+
+    for (int x = 0; x < BOARD_WIDTH; x++)
+    {
+        int Height = 0;
+        for (int y = 0; y < BOARD_HEIGHT; y++)
+        {
+            if (BB_Test(Board->Occupied, BOARD_INDEX(x, y))) Height++;
+        }
+
+        Value += BOT_WEIGHT_HEIGHT*Height*(Height + 1)/2;
+        if (Height > Peak) Peak = Height;
+    }
+
+    Value += BOT_WEIGHT_PEAK*Peak;
+    Value += BOT_WEIGHT_JUNK*BB_PopCount(Board->Planes[PIECE_JUNK]);
+
+    network_index Index = { 0 };
+    bitboard Wires = Board_ConnectionMask(Board);
+    while (!BB_IsEmpty(Wires))
+    {
+        int i = BB_Lowest(Wires);
+        Wires = BB_AndNot(Wires, BB_Cell(i));
+        if (Network_IsDangling(&Index, Board, i % BOARD_WIDTH, i / BOARD_WIDTH)) Value += BOT_WEIGHT_DANGLING;
+    }
+
+    int Spawn = BOARD_WIDTH/2 - 1;
+    if (Board_IsOccupied(Board, Spawn, 0) || Board_IsOccupied(Board, Spawn + 1, 0) || Board_IsOccupied(Board, Spawn, 1))
+    {
+        Value += BOT_WEIGHT_BLOCKED;
+    }
+
+    return Value;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// Valid bricks always have their first piece on the board
+static int Bot_StateIndex(brick *Brick)
+{
+    return BOARD_INDEX(Brick->x, Brick->y)*4 + Brick->Orientation;
+}
+
+// Moves are tried the way GP_Update() applies them: a blocked move or rotation leaves the
+// brick where it was, and moving down into something locks it instead
+static void Bot_Explore(board *Board, brick *Start, bot_explore *Explore)
+{
+    Explore->Count = 0;
+    for (int i = 0; i < BOT_STATES; i++)
+    {
+        Explore->Parent[i] = BOT_UNREACHED;
+    }
+
+    if (Board_ShouldPlaceBrick(Board, Start))
+    {
+        return;
+    }
+
+    Explore->Queue[Explore->Count++] = *Start;
+    Explore->Parent[Bot_StateIndex(Start)] = BOT_ROOT;
+
+    for (int Head = 0; Head < Explore->Count; Head++)
+    {
+        brick *Brick = &Explore->Queue[Head];
+
+        struct {
+            brick Brick;
+            unsigned char Input;
+        } Moves[4] = {
+            { Brick_Move(Brick, -1, 0), GP_INPUT_LEFT },
+            { Brick_Move(Brick, 1, 0), GP_INPUT_RIGHT },
+            { Brick_Move(Brick, 0, 1), GP_INPUT_DOWN },
+            { Brick_Rotate(Brick), GP_INPUT_ROTATE },
+        };
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (Board_ShouldPlaceBrick(Board, &Moves[i].Brick))
+            {
+                continue;
+            }
+
+            int State = Bot_StateIndex(&Moves[i].Brick);
+            if (Explore->Parent[State] != BOT_UNREACHED)
+            {
+                continue;
+            }
+
+            Explore->Parent[State] = (short)Bot_StateIndex(Brick);
+            Explore->Input[State] = Moves[i].Input;
+            Explore->Queue[Explore->Count++] = Moves[i].Brick;
+        }
+    }
+}
+
+// Task of one beam node: locks every placement of the level brick on a copy of its board
+static void Bot_ExpandNode(void *Context, int Index)
+{
+    bot_level *Level = Context;
+    bot *Bot = Level->Bot;
+    bot_node *Node = &Bot->Beam[Index];
+    bot_node *Children = &Bot->Children[Index*BOT_STATES];
+
+    brick Placements[BOT_STATES];
+    int Count = Bot_Placements(&Node->Board, Level->Brick, Placements);
+
+    for (int c = 0; c < Count; c++)
+    {
+        bot_node *Child = &Children[c];
+        Child->Board = Node->Board;
+        Board_PutBrick(&Child->Board, &Placements[c]);
+        ZONE_BEGIN("Board_Settle");
+        Board_Settle(&Child->Board, NULL);
+        ZONE_END();
+
+        Child->Points = Node->Points + Bot_Resolve(&Child->Board, &Bot->Caches[Index]);
+        Child->Value = Child->Points + Bot_Evaluate(&Child->Board);
+        Child->First = (Level->Level == 0)? Placements[c] : Node->First;
+    }
+
+    Bot->ChildCount[Index] = Count;
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************************
+*
+*   Nettis core - placement search bot
+*
+*   The bot only moves bricks the way a player can: every state it considers is reached with
+*   Brick_Move() and Brick_Rotate() from the falling brick and checked with
+*   Board_ShouldPlaceBrick(), exactly like GP_Update() handles input.
+*
+*   A search is a beam search over the falling brick and the bricks in the preview queue.
+*   For every kept board, each final placement of the next brick is locked, its circuits and
+*   junk are resolved at once (no timers) and the result is scored. The best Width boards
+*   move on to the next brick. Expanding the boards of one level is independent work that
+*   the caller can spread over threads through bot.ParallelFor. Only games on the standard
+*   board are played, the bot gives no input on a field
+*
+********************************************************************************************/
+
+#ifndef NETTIS_BOT_H
+#define NETTIS_BOT_H
+
+#include "gameplay.h"
+#include "cache.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BOT_STATES (BOARD_CELLS*4)          // Brick positions times orientations
+#define BOT_MAX_DEPTH (1 + BRICK_PREVIEW)   // The falling brick and every previewed one
+#define BOT_CACHE_ENTRIES 1024              // Evaluations remembered per beam node
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    board Board;
+    int Points;             // Score won on the way to this board
+    float Value;            // Points plus the board evaluation, what the beam ranks
+    brick First;            // Placement of the falling brick this board comes from
+} bot_node;
+
+// Runs Task(Context, i) for every i in [0, Count) and returns once all are done
+typedef void (*bot_task)(void *Context, int Index);
+typedef void (*bot_parallel_for)(int Count, bot_task Task, void *Context);
+
+typedef struct {
+    int Depth;                      // Bricks searched, at most BOT_MAX_DEPTH
+    int Width;                      // Boards kept per level
+    bot_parallel_for ParallelFor;   // NULL runs everything on the calling thread
+
+    bot_node *Beam;                 // Width nodes
+    bot_node *Children;             // Width*BOT_STATES nodes
+    int *ChildCount;                // Width counters
+    int *Order;                     // Width*BOT_STATES indices
+    trace_cache *Caches;            // Width caches, one per task so threads never share one
+
+    unsigned long long Nodes;       // Placements evaluated since Bot_Init()
+    unsigned int Searches;
+
+    brick Target;                   // Where Bot_Play() is taking the falling brick
+    bool HasTarget;
+    int BrickHead;                  // Queue position of the brick Target was chosen for
+} bot;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Bot_Init(bot *Bot, int Depth, int Width, bot_parallel_for ParallelFor);
+void Bot_Free(bot *Bot);
+bool Bot_Search(bot *Bot, gameplay *Gameplay, brick *Target);     // Best final placement of the falling brick
+void Bot_Restart(bot *Bot);                                         // Call before playing a new game
+unsigned int Bot_Play(bot *Bot, gameplay *Gameplay);               // Input to give GP_Update() this tick
+
+int Bot_Placements(board *Board, brick *Brick, brick *Placements);      // Final placements, up to BOT_STATES
+unsigned int Bot_NextInput(board *Board, brick *Brick, brick *Target);  // GP_INPUT_* towards Target, 0 if unreachable
+int Bot_Resolve(board *Board, trace_cache *Cache);                      // Clears circuits and spreads junk, returns points
+float Bot_Evaluate(board *Board);
+
+#endif // NETTIS_BOT_H
@@ -0,0 +1,300 @@
+/*******************************************************************************************
+*
+*   Nettis core - falling bricks
+*
+********************************************************************************************/
+
+#include "brick.h"
+#include "board.h"
+#include "zone.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+// Pieces of a brick are drawn from this table, repeated entries are more likely
+static const piece CHANCE_TBL[] = {
+    PIECE_HCONN,
+    PIECE_HCONN,
+    PIECE_HCONN,
+    PIECE_VCONN,
+    PIECE_VCONN,
+    PIECE_VCONN,
+    PIECE_UL,
+    PIECE_DL,
+    PIECE_DR,
+    PIECE_UR,
+    PIECE_DST,
+    PIECE_DST,
+    PIECE_JUNK,
+    PIECE_FIRE
+};
+
+static const brick_type TYPE_CHANCE_TBL[] = {
+    BRICK_TYPE_CONNECTION,
+    BRICK_TYPE_CONNECTION,
+    BRICK_TYPE_CONNECTION,
+    BRICK_TYPE_JUNK,
+    BRICK_TYPE_RANDOM,
+    BRICK_TYPE_RANDOM,
+    BRICK_TYPE_DEST,
+    BRICK_TYPE_FIRE,
+};
+
+static brick_table DefaultTable;
+static bool DefaultTableBuilt = false;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Brick_IsValidPair(brick_type Type, orientation Orientation, piece First, piece Second);
+static void Brick_QueueFill(brick_queue *Queue);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+brick Brick_Rotate(brick *Brick)
+{
+    brick NewBrick;
+    memcpy(&NewBrick, Brick, sizeof(brick));
+
+    switch (NewBrick.Orientation)
+    {
+        case RIGHT:
+            NewBrick.Orientation = DOWN;
+            break;
+        case DOWN:
+            NewBrick.Orientation = LEFT;
+            break;
+        case LEFT:
+            NewBrick.Orientation = UP;
+            break;
+        case UP:
+            NewBrick.Orientation = RIGHT;
+            break;
+        default:
+            break;
+    }
+
+    NewBrick.Pieces[0] = Piece_Rotate(NewBrick.Pieces[0]);
+    NewBrick.Pieces[1] = Piece_Rotate(NewBrick.Pieces[1]);
+
+    return NewBrick;
+}
+
+brick Brick_Move(brick *Brick, int dx, int dy)
+{
+    brick NewBrick;
+    memcpy(&NewBrick, Brick, sizeof(brick));
+
+    NewBrick.x += dx;
+    NewBrick.y += dy;
+
+    return NewBrick;
+}
+
+void Brick_DefaultOdds(brick_odds *Odds)
+{
+    *Odds = (brick_odds){ 0 };
+
+    Odds->PieceCount = sizeof(CHANCE_TBL)/sizeof(CHANCE_TBL[0]);
+    for (int i = 0; i < Odds->PieceCount; i++) Odds->Pieces[i] = CHANCE_TBL[i];
+
+    Odds->TypeCount = sizeof(TYPE_CHANCE_TBL)/sizeof(TYPE_CHANCE_TBL[0]);
+    for (int i = 0; i < Odds->TypeCount; i++) Odds->Types[i] = TYPE_CHANCE_TBL[i];
+}
+
+// Lists every valid pair of pieces per brick type and orientation, once per way of drawing
+// it from Odds->Pieces, which keeps the odds of drawing pairs until one is valid. Fails when
+// a brick type of Odds->Types can never be drawn from Odds->Pieces
+bool Brick_BuildTable(brick_table *Table, const brick_odds *Odds)
+{
+    memset(Table, 0, sizeof(brick_table));
+    if (Odds->PieceCount <= 0 || Odds->PieceCount > BRICK_ODDS_CAPACITY ||
+        Odds->TypeCount <= 0 || Odds->TypeCount > BRICK_ODDS_CAPACITY)
+    {
+        return false;
+    }
+
+    Table->Odds = *Odds;
+    bool Valid = true;
+
+    for (int Type = 0; Type < BRICK_TYPE_COUNT; Type++)
+    {
+        for (int Orientation = 0; Orientation < 2; Orientation++)
+        {
+            int Count = 0;
+            for (int a = 0; a < Odds->PieceCount; a++)
+            {
+                for (int b = 0; b < Odds->PieceCount; b++)
+                {
+                    if (!Brick_IsValidPair(Type, Orientation, Odds->Pieces[a], Odds->Pieces[b]))
+                        continue;
+                    Table->Pairs[Type][Orientation][Count][0] = (unsigned char)Odds->Pieces[a];
+                    Table->Pairs[Type][Orientation][Count][1] = (unsigned char)Odds->Pieces[b];
+                    Count++;
+                }
+            }
+            Table->PairCount[Type][Orientation] = Count;
+        }
+    }
+
+    for (int i = 0; i < Odds->TypeCount; i++)
+    {
+        brick_type Type = Odds->Types[i];
+        if (Type != BRICK_TYPE_FIRE && (Table->PairCount[Type][0] == 0 || Table->PairCount[Type][1] == 0))
+        {
+            Valid = false;
+        }
+    }
+
+    return Valid;
+}
+
+// Built on first use. Threads sharing it should only start after one call on a single thread
+const brick_table *Brick_DefaultTable(void)
+{
+    if (!DefaultTableBuilt)
+    {
+        brick_odds Odds;
+        Brick_DefaultOdds(&Odds);
+        Brick_BuildTable(&DefaultTable, &Odds);
+        DefaultTableBuilt = true;
+    }
+
+    return &DefaultTable;
+}
+
+// Every brick is drawn in constant time: a brick type, an orientation and then one pair of
+// pieces among the pairs that type allows
+brick Brick_Random(rng *Rng, const brick_table *Table)
+{
+    brick NewBrick;
+    NewBrick.x = BOARD_WIDTH/2-1;
+    NewBrick.y = 0;
+    NewBrick.Orientation = Rng_Below(Rng, 2);
+
+    brick_type Type = Table->Odds.Types[Rng_Below(Rng, Table->Odds.TypeCount)];
+
+    if (Type == BRICK_TYPE_FIRE)
+    {
+        NewBrick.Pieces[0] = PIECE_FIRE;
+        NewBrick.Pieces[1] = PIECE_EMPTY;
+        return NewBrick;
+    }
+
+    int Count = Table->PairCount[Type][NewBrick.Orientation];
+    const unsigned char *Pair = Table->Pairs[Type][NewBrick.Orientation][Rng_Below(Rng, Count)];
+    NewBrick.Pieces[0] = Pair[0];
+    NewBrick.Pieces[1] = Pair[1];
+
+    return NewBrick;
+}
+
+void Brick_Locations(brick *Brick, int x[2], int y[2])
+{
+    switch (Brick->Orientation)
+    {
+        case RIGHT:
+            x[0] = Brick->x;
+            x[1] = Brick->x+1;
+            y[0] = Brick->y;
+            y[1] = Brick->y;
+            break;
+        case DOWN:
+            x[0] = Brick->x;
+            x[1] = Brick->x;
+            y[0] = Brick->y;
+            y[1] = Brick->y+1;
+            break;
+        case LEFT:
+            x[0] = Brick->x;
+            x[1] = Brick->x-1;
+            y[0] = Brick->y;
+            y[1] = Brick->y;
+            break;
+        case UP:
+            x[0] = Brick->x;
+            x[1] = Brick->x;
+            y[0] = Brick->y;
+            y[1] = Brick->y-1;
+            break;
+    }
+}
+
+void Brick_QueueInit(brick_queue *Queue, uint64_t Seed, const brick_table *Table)
+{
+    Rng_Seed(&Queue->Rng, Seed);
+    Queue->Table = Table;
+    Queue->Head = 0;
+    Queue->Count = 0;
+    Brick_QueueFill(Queue);
+}
+
+brick Brick_QueueNext(brick_queue *Queue)
+{
+    brick Brick = Queue->Bricks[Queue->Head];
+    Queue->Head = (Queue->Head + 1) % BRICK_QUEUE_SIZE;
+    Queue->Count--;
+
+    if (Queue->Count < BRICK_PREVIEW)
+    {
+        Brick_QueueFill(Queue);
+    }
+
+    return Brick;
+}
+
+brick *Brick_QueuePeek(brick_queue *Queue, int i)
+{
+    return &Queue->Bricks[(Queue->Head + i) % BRICK_QUEUE_SIZE];
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// The rules each brick type puts on a pair of pieces, Orientation is the brick orientation
+static bool Brick_IsValidPair(brick_type Type, orientation Orientation, piece First, piece Second)
+{
+    if (First == PIECE_FIRE || Second == PIECE_FIRE)
+    {
+        return false;
+    }
+
+    switch (Type)
+    {
+        case BRICK_TYPE_CONNECTION:
+        {
+            if (!(Piece_IsConnectionType(First) || Piece_IsConnectionType(Second)))
+                return false;
+            unsigned int DirFrom = Piece_OutgoingOrientations(First);
+            unsigned int DirTo = Piece_IncomingOrientations(Second);
+            return (DirFrom & DirTo & 1<<Orientation) != 0;
+        }
+        case BRICK_TYPE_JUNK:
+            return First == PIECE_JUNK || Second == PIECE_JUNK;
+        case BRICK_TYPE_RANDOM:
+            return First != PIECE_JUNK && Second != PIECE_JUNK;
+        case BRICK_TYPE_DEST:
+            if (First == PIECE_JUNK || Second == PIECE_JUNK)
+                return false;
+            return (First == PIECE_DST) != (Second == PIECE_DST);
+        default:
+            return false;
+    }
+}
+
+// Tops the queue up to BRICK_QUEUE_SIZE bricks in one go
+static void Brick_QueueFill(brick_queue *Queue)
+{
+    int Tail = (Queue->Head + Queue->Count) % BRICK_QUEUE_SIZE;
+
+    for (; Queue->Count < BRICK_QUEUE_SIZE; Queue->Count++)
+    {
+        ZONE_BEGIN("Brick_Random");
+        Queue->Bricks[Tail] = Brick_Random(&Queue->Rng, Queue->Table);
+        ZONE_END();
+        Tail = (Tail + 1) % BRICK_QUEUE_SIZE;
+    }
+}
@@ -0,0 +1,77 @@
+/*******************************************************************************************
+*
+*   Nettis core - falling bricks
+*
+********************************************************************************************/
+
+#ifndef NETTIS_BRICK_H
+#define NETTIS_BRICK_H
+
+#include "piece.h"
+#include "rng.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BRICK_QUEUE_SIZE 16         // Bricks generated ahead, refilled in one batch
+#define BRICK_PREVIEW 3             // Upcoming bricks Brick_QueuePeek() can always see
+#define BRICK_ODDS_CAPACITY 32      // Entries of each chance table
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    int x, y;
+    piece Pieces[2];
+    orientation Orientation;
+} brick;
+
+typedef enum {
+    BRICK_TYPE_CONNECTION = 0,      // At least one wire, joined across the pair
+    BRICK_TYPE_JUNK,                // At least one junk piece
+    BRICK_TYPE_RANDOM,              // Anything but junk
+    BRICK_TYPE_DEST,                // Exactly one node, no junk
+    BRICK_TYPE_FIRE,                // A lone fire piece
+    BRICK_TYPE_COUNT
+} brick_type;
+
+// Chance tables: every entry is equally likely, so repeating an entry raises its odds
+typedef struct {
+    piece Pieces[BRICK_ODDS_CAPACITY];          // Pieces of a brick are drawn from here
+    int PieceCount;
+    brick_type Types[BRICK_ODDS_CAPACITY];      // Type of the next brick
+    int TypeCount;
+} brick_odds;
+
+// Every valid pair of pieces per brick type and orientation (RIGHT or DOWN)
+typedef struct {
+    brick_odds Odds;
+    unsigned char Pairs[BRICK_TYPE_COUNT][2][BRICK_ODDS_CAPACITY*BRICK_ODDS_CAPACITY][2];
+    int PairCount[BRICK_TYPE_COUNT][2];
+} brick_table;
+
+// Ring buffer of upcoming bricks with the generator that produces them
+typedef struct {
+    rng Rng;
+    const brick_table *Table;
+    brick Bricks[BRICK_QUEUE_SIZE];
+    int Head;
+    int Count;
+} brick_queue;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+brick Brick_Rotate(brick *Brick);
+brick Brick_Move(brick *Brick, int dx, int dy);
+void Brick_DefaultOdds(brick_odds *Odds);
+bool Brick_BuildTable(brick_table *Table, const brick_odds *Odds);
+const brick_table *Brick_DefaultTable(void);
+brick Brick_Random(rng *Rng, const brick_table *Table);
+void Brick_Locations(brick *Brick, int x[2], int y[2]);
+
+void Brick_QueueInit(brick_queue *Queue, uint64_t Seed, const brick_table *Table);
+brick Brick_QueueNext(brick_queue *Queue);
+brick *Brick_QueuePeek(brick_queue *Queue, int i);     // 0 is the next brick, i < BRICK_PREVIEW
+
+#endif // NETTIS_BRICK_H
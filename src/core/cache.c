@@ -0,0 +1,156 @@
+/*******************************************************************************************
+*
+*   Nettis core - memoized board evaluation
+*
+********************************************************************************************/
+
+#include "cache.h"
+#include "zone.h"
+
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static inline unsigned int Cache_Slot(trace_cache *Cache, board *Board)
+{
+    return (unsigned int)(Board->Hash ^ (Board->Hash >> 32)) & Cache->Mask;
+}
+
+static inline bool Cache_Matches(uint64_t Hash, bitboard Occupied, bool Used, board *Board)
+{
+    return Used && Hash == Board->Hash && BB_Equal(Occupied, Board->Occupied);
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition
+//----------------------------------------------------------------------------------
+bool Cache_Init(trace_cache *Cache, int Capacity)
+{
+    unsigned int Size = 1;
+    while (Size < (unsigned int)Capacity && Size < (1u << 24)) Size <<= 1;
+
+    *Cache = (trace_cache){ 0 };
+    Cache->Power = calloc(Size, sizeof(cache_power));
+    Cache->Junk = calloc(Size, sizeof(cache_junk));
+    Cache->Mask = Size - 1;
+
+    if (Cache->Power == NULL || Cache->Junk == NULL)
+    {
+        Cache_Free(Cache);
+        return false;
+    }
+
+    return true;
+}
+
+void Cache_Free(trace_cache *Cache)
+{
+    free(Cache->Power);
+    free(Cache->Junk);
+    *Cache = (trace_cache){ 0 };
+}
+
+void Cache_Clear(trace_cache *Cache)
+{
+    for (unsigned int i = 0; i <= Cache->Mask; i++)
+    {
+        Cache->Power[i].Used = false;
+        Cache->Junk[i].Used = false;
+    }
+    Cache->Hits = 0;
+    Cache->Misses = 0;
+}
+
+void Cache_GetTrace(trace_cache *Cache, board *Board, power_board *Powers, trace *Trace)
+{
+    if (Cache == NULL)
+    {
+        *Powers = (power_board){ 0 };
+        ZONE_BEGIN("Board_GetTrace");
+        Board_GetTrace(Board, Powers, Trace);
+        ZONE_END();
+        return;
+    }
+
+    cache_power *Entry = &Cache->Power[Cache_Slot(Cache, Board)];
+
+    if (Cache_Matches(Entry->Hash, Entry->Occupied, Entry->Used, Board))
+    {
+        for (int i = 0; i < BOARD_CELLS; i++)
+        {
+            int Shift = (i & 1)*4;
+            Powers->Incoming[i / BOARD_WIDTH][i % BOARD_WIDTH] = (Entry->Powers[i/2] >> Shift) & 0x0F;
+        }
+        *Trace = Entry->Trace;
+        Cache->Hits++;
+        return;
+    }
+
+    *Powers = (power_board){ 0 };
+    ZONE_BEGIN("Board_GetTrace");
+    Board_GetTrace(Board, Powers, Trace);
+    ZONE_END();
+    Cache->Misses++;
+
+    Entry->Hash = Board->Hash;
+    Entry->Occupied = Board->Occupied;
+    Entry->Used = true;
+    Entry->Trace = *Trace;
+    for (int i = 0; i < CACHE_CELL_BYTES; i++)
+    {
+        Entry->Powers[i] = 0;
+    }
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        int Shift = (i & 1)*4;
+        Entry->Powers[i/2] |= (uint8_t)((Powers->Incoming[i / BOARD_WIDTH][i % BOARD_WIDTH] & 0x0F) << Shift);
+    }
+}
+
+void Cache_GetTraceJunk(trace_cache *Cache, board *Board, trace *Trace)
+{
+    if (Cache_FindTraceJunk(Cache, Board, Trace))
+    {
+        return;
+    }
+
+    ZONE_BEGIN("Board_GetTraceJunk");
+    Board_GetTraceJunk(Board, Trace);
+    ZONE_END();
+    Cache_StoreTraceJunk(Cache, Board, Trace);
+}
+
+bool Cache_FindTraceJunk(trace_cache *Cache, board *Board, trace *Trace)
+{
+    if (Cache == NULL)
+    {
+        return false;
+    }
+
+    cache_junk *Entry = &Cache->Junk[Cache_Slot(Cache, Board)];
+
+    if (!Cache_Matches(Entry->Hash, Entry->Occupied, Entry->Used, Board))
+    {
+        Cache->Misses++;
+        return false;
+    }
+
+    *Trace = Entry->Trace;
+    Cache->Hits++;
+    return true;
+}
+
+void Cache_StoreTraceJunk(trace_cache *Cache, board *Board, trace *Trace)
+{
+    if (Cache == NULL)
+    {
+        return;
+    }
+
+    cache_junk *Entry = &Cache->Junk[Cache_Slot(Cache, Board)];
+    Entry->Hash = Board->Hash;
+    Entry->Occupied = Board->Occupied;
+    Entry->Used = true;
+    Entry->Trace = *Trace;
+}
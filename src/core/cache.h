@@ -0,0 +1,67 @@
+/*******************************************************************************************
+*
+*   Nettis core - memoized board evaluation
+*
+*   A bounded table of Board_GetTrace() and Board_GetTraceJunk() results, keyed by the hash
+*   of the board. Entries are direct-mapped, a new board simply takes the slot of whatever
+*   was there, so a lookup is one probe and the memory never grows. Occupied is kept next to
+*   the hash and both have to match.
+*
+*   Evaluating the same board again, as the bot does across searches and the game does when
+*   it resolves a chain again, becomes a copy. A cache belongs to one thread at a time
+*
+********************************************************************************************/
+
+#ifndef NETTIS_CACHE_H
+#define NETTIS_CACHE_H
+
+#include "trace.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define CACHE_CELL_BYTES ((BOARD_CELLS + 1)/2)
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    uint64_t Hash;
+    bitboard Occupied;
+    uint8_t Powers[CACHE_CELL_BYTES];   // Incoming ends, two cells per byte, the even one low
+    bool Used;
+    trace Trace;
+} cache_power;
+
+typedef struct {
+    uint64_t Hash;
+    bitboard Occupied;
+    bool Used;
+    trace Trace;
+} cache_junk;
+
+typedef struct {
+    cache_power *Power;
+    cache_junk *Junk;
+    unsigned int Mask;                  // Entries per table minus one
+    unsigned long long Hits;
+    unsigned long long Misses;
+} trace_cache;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Cache_Init(trace_cache *Cache, int Capacity);     // Rounded up to a power of two, false if out of memory
+void Cache_Free(trace_cache *Cache);
+void Cache_Clear(trace_cache *Cache);
+
+// Board_GetTrace() and Board_GetTraceJunk() through the cache, Cache may be NULL.
+// Powers is overwritten, it does not have to be cleared first
+void Cache_GetTrace(trace_cache *Cache, board *Board, power_board *Powers, trace *Trace);
+void Cache_GetTraceJunk(trace_cache *Cache, board *Board, trace *Trace);
+
+// For callers that find the trace some other way: a lookup, then a store on a miss
+bool Cache_FindTraceJunk(trace_cache *Cache, board *Board, trace *Trace);
+void Cache_StoreTraceJunk(trace_cache *Cache, board *Board, trace *Trace);
+
+#endif // NETTIS_CACHE_H
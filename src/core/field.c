@@ -0,0 +1,822 @@
+/*******************************************************************************************
+*
+*   Nettis core - boards sized at runtime
+*
+********************************************************************************************/
+
+#include "field.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define FIELD_BIT(x) ((uint64_t)1 << ((x) & 63))
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Field_JournalInit(field_journal *Journal, field *Field);
+static void Field_JournalFree(field_journal *Journal);
+static void Field_JournalTake(field_journal *Journal, field *Field);
+static void Field_Touch(field *Field, int i);
+static void Field_Move(field *Field, int From, int To);
+static unsigned int Field_NextEpoch(field *Field);
+static unsigned int Field_NextMark(field *Field);
+static int Field_CompareCells(const void *a, const void *b);
+static int Field_PowerRegion(field *Field);
+static void Field_FindCircuit(field *Field, int *Sources, int SourceCount, field_trace *Trace);
+static int Field_CountPowered(field *Field, int *Cells, int Count);
+static void Field_TraceFilter(field *Field, field_trace *Trace);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool Field_Init(field *Field, int Width, int Height)
+{
+    *Field = (field){ 0 };
+
+    if (Width < 2 || Width > FIELD_MAX_WIDTH || Height < 2 || Height > FIELD_MAX_HEIGHT)
+    {
+        return false;
+    }
+
+    size_t Cells = (size_t)Width*Height;
+    size_t Rows = (size_t)Height*((Width + 63)/64);
+
+    Field->Width = Width;
+    Field->Height = Height;
+    Field->Words = (Width + 63)/64;
+    Field->Cells = calloc(Cells, 1);
+    Field->Occupied = calloc(Rows, sizeof(uint64_t));
+    Field->Incoming = calloc(Cells, 1);
+    Field->Visit = calloc(Cells, sizeof(unsigned int));
+    Field->Order = malloc(Cells*sizeof(int));
+    Field->Mark = calloc(Cells, sizeof(unsigned int));
+    Field->Region = malloc(Cells*sizeof(int));
+    Field->Circuits = malloc(Cells*sizeof(int));
+    Field->CircuitCells = malloc(Cells*sizeof(int));
+    Field->Falling = malloc(Rows*sizeof(uint64_t));
+
+    bool Ok = Field_JournalInit(&Field->TouchedPower, Field) && Field_JournalInit(&Field->TouchedJunk, Field);
+    if (!Ok || Field->Cells == NULL || Field->Occupied == NULL || Field->Incoming == NULL || Field->Visit == NULL ||
+        Field->Order == NULL || Field->Mark == NULL || Field->Region == NULL || Field->Circuits == NULL ||
+        Field->CircuitCells == NULL || Field->Falling == NULL)
+    {
+        Field_Free(Field);
+        return false;
+    }
+
+    return true;
+}
+
+void Field_Free(field *Field)
+{
+    free(Field->Cells);
+    free(Field->Occupied);
+    free(Field->Incoming);
+    free(Field->Visit);
+    free(Field->Order);
+    free(Field->Mark);
+    free(Field->Region);
+    free(Field->Circuits);
+    free(Field->CircuitCells);
+    free(Field->Falling);
+    Field_JournalFree(&Field->TouchedPower);
+    Field_JournalFree(&Field->TouchedJunk);
+    *Field = (field){ 0 };
+}
+
+// Empties the field as a change, the next evaluations look at all of it
+void Field_Reset(field *Field)
+{
+    memset(Field->Cells, 0, (size_t)Field->Width*Field->Height);
+    memset(Field->Occupied, 0, (size_t)Field->Height*Field->Words*sizeof(uint64_t));
+    Field->Version++;
+
+    Field_JournalTake(&Field->TouchedPower, Field);
+    Field_JournalTake(&Field->TouchedJunk, Field);
+    Field->TouchedPower.All = true;
+    Field->TouchedJunk.All = true;
+}
+
+void Field_CopyBoard(field *Field, board *Board)
+{
+    Field_Reset(Field);
+
+    for (int y = 0; y < Field->Height; y++)
+    {
+        for (int x = 0; x < Field->Width; x++)
+        {
+            Field_SetTile(Field, x, y, Board_GetTile(Board, x % BOARD_WIDTH, y % BOARD_HEIGHT));
+        }
+    }
+}
+
+piece Field_GetTile(field *Field, int x, int y)
+{
+    return (piece)Field->Cells[FIELD_INDEX(Field, x, y)];
+}
+
+// Overwrites a cell inside the field, PIECE_EMPTY clears it
+void Field_SetTile(field *Field, int x, int y, piece Piece)
+{
+    int i = FIELD_INDEX(Field, x, y);
+
+    if (Field->Cells[i] == Piece)
+    {
+        return;
+    }
+
+    Field->Version++;
+    Field_Touch(Field, i);
+    Field->Cells[i] = (unsigned char)Piece;
+
+    uint64_t *Word = &Field->Occupied[y*Field->Words + x/64];
+    if (Piece != PIECE_EMPTY) *Word |= FIELD_BIT(x);
+    else *Word &= ~FIELD_BIT(x);
+}
+
+void Field_PutTileSafe(field *Field, int x, int y, piece Piece)
+{
+    if (Piece != PIECE_EMPTY && !Field_IsOob(Field, x, y))
+    {
+        Field_SetTile(Field, x, y, Piece);
+    }
+}
+
+bool Field_IsOob(field *Field, int x, int y)
+{
+    return x < 0 || x >= Field->Width || y < 0 || y >= Field->Height;
+}
+
+bool Field_IsOccupied(field *Field, int x, int y)
+{
+    if (Field_IsOob(Field, x, y))
+        return true;
+
+    return Field->Cells[FIELD_INDEX(Field, x, y)] != PIECE_EMPTY;
+}
+
+bool Field_ShouldPlaceBrick(field *Field, brick *Brick)
+{
+    int x[2], y[2];
+    Brick_Locations(Brick, x, y);
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (Brick->Pieces[i] != PIECE_EMPTY && Field_IsOccupied(Field, x[i], y[i]))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Moves every unsupported piece one row down, returns false once the field has settled
+bool Field_GravityStep(field *Field)
+{
+    int Words = Field->Words;
+    bool Any = false;
+
+    for (int y = 0; y < Field->Height - 1; y++)
+    {
+        for (int w = 0; w < Words; w++)
+        {
+            uint64_t Falling = Field->Occupied[y*Words + w] & ~Field->Occupied[(y + 1)*Words + w];
+            Field->Falling[y*Words + w] = Falling;
+            if (Falling != 0) Any = true;
+        }
+    }
+
+    if (!Any)
+    {
+        return false;
+    }
+
+    // A piece only ever falls into a cell that was empty, so rows can move in any order
+    for (int y = 0; y < Field->Height - 1; y++)
+    {
+        for (int w = 0; w < Words; w++)
+        {
+            uint64_t Falling = Field->Falling[y*Words + w];
+            Field->Occupied[y*Words + w] &= ~Falling;
+            Field->Occupied[(y + 1)*Words + w] |= Falling;
+
+            for (; Falling != 0; Falling &= Falling - 1)
+            {
+                int i = FIELD_INDEX(Field, w*64 + BB_LowestBit64(Falling), y);
+                Field_Move(Field, i, i + Field->Width);
+            }
+        }
+    }
+    Field->Version++;
+
+    return true;
+}
+
+// Drops every piece as far as it goes, only walking the columns that have something to drop.
+// Returns the number of moved pieces
+int Field_Settle(field *Field)
+{
+    uint64_t Columns[FIELD_MAX_WIDTH/64] = { 0 };
+    int Words = Field->Words;
+    bool Any = false;
+
+    for (int y = 0; y < Field->Height - 1; y++)
+    {
+        for (int w = 0; w < Words; w++)
+        {
+            Columns[w] |= Field->Occupied[y*Words + w] & ~Field->Occupied[(y + 1)*Words + w];
+        }
+    }
+
+    for (int w = 0; w < Words; w++)
+    {
+        if (Columns[w] != 0) Any = true;
+    }
+
+    if (!Any)
+    {
+        return 0;
+    }
+
+    int Count = 0;
+    for (int w = 0; w < Words; w++)
+    {
+        for (uint64_t Bits = Columns[w]; Bits != 0; Bits &= Bits - 1)
+        {
+            int x = w*64 + BB_LowestBit64(Bits);
+            int Floor = Field->Height - 1;
+
+            for (int y = Field->Height - 1; y >= 0; y--)
+            {
+                if (Field->Cells[FIELD_INDEX(Field, x, y)] == PIECE_EMPTY)
+                {
+                    continue;
+                }
+
+                if (y != Floor)
+                {
+                    Field->Occupied[y*Words + w] &= ~FIELD_BIT(x);
+                    Field->Occupied[Floor*Words + w] |= FIELD_BIT(x);
+                    Field_Move(Field, FIELD_INDEX(Field, x, y), FIELD_INDEX(Field, x, Floor));
+                    Count++;
+                }
+
+                Floor--;
+            }
+        }
+    }
+    Field->Version++;
+
+    return Count;
+}
+
+void Field_CleanSurroundings(field *Field, int x, int y)
+{
+    bool Cleaned = false;
+
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int x2 = x + dx, y2 = y + dy;
+
+            if ((dx == 0 && dy == 0) || Field_IsOob(Field, x2, y2) || Field_GetTile(Field, x2, y2) != PIECE_JUNK)
+            {
+                continue;
+            }
+
+            int i = FIELD_INDEX(Field, x2, y2);
+            Field->Cells[i] = PIECE_EMPTY;
+            Field->Occupied[y2*Field->Words + x2/64] &= ~FIELD_BIT(x2);
+            Field_Touch(Field, i);
+            Cleaned = true;
+        }
+    }
+
+    if (Cleaned) Field->Version++;
+}
+
+// FNV-1a over the pieces in cell order, like Board_Checksum()
+unsigned int Field_Checksum(field *Field)
+{
+    unsigned int Hash = 2166136261u;
+    size_t Count = (size_t)Field->Width*Field->Height;
+
+    for (size_t i = 0; i < Count; i++)
+    {
+        Hash ^= (unsigned int)Field->Cells[i];
+        Hash *= 16777619u;
+    }
+
+    return Hash;
+}
+
+bool Field_TraceInit(field_trace *Trace, field *Field)
+{
+    *Trace = (field_trace){ 0 };
+    Trace->Capacity = Field->Width*Field->Height;
+    Trace->Cells = malloc((size_t)Trace->Capacity*sizeof(int));
+
+    return Trace->Cells != NULL;
+}
+
+void Field_TraceFree(field_trace *Trace)
+{
+    free(Trace->Cells);
+    *Trace = (field_trace){ 0 };
+}
+
+void Field_TraceClear(field_trace *Trace)
+{
+    Trace->Count = 0;
+    Trace->OpenConns = 0;
+    Trace->Junk = false;
+}
+
+// Board_TraceNetwork() over a field. Visited cells are stamped with the epoch of the traversal
+// and their position in it, so nothing has to be cleared between traversals. With Powers set,
+// followed edges are recorded in Field->Incoming
+void Field_TraceNetwork(field *Field, int x, int y, trace_edge Edge, bool Powers, field_trace *Trace)
+{
+    // The edge rules keep their counters in a trace, that is all it is used for here
+    trace Counters;
+    Trace_Clear(&Counters);
+
+    unsigned int Epoch = Field_NextEpoch(Field);
+    int Width = Field->Width;
+    int Start = FIELD_INDEX(Field, x, y);
+
+    Field_TraceClear(Trace);
+    Trace->Cells[0] = Start;
+    Trace->Count = 1;
+    Field->Visit[Start] = Epoch;
+    Field->Order[Start] = 0;
+    int LevelEnd = 1;
+
+    for (int Head = 0; Head < Trace->Count; Head++)
+    {
+        if (Head == LevelEnd)
+        {
+            LevelEnd = Trace->Count;
+        }
+
+        int Cell = Trace->Cells[Head];
+        int cx = Cell % Width;
+        int cy = Cell / Width;
+        piece Piece = (piece)Field->Cells[Cell];
+
+        struct {
+            int x, y;
+            orientation Orientation;
+        } Positions[4] = {
+            { cx-1, cy, LEFT },
+            { cx+1, cy, RIGHT },
+            { cx, cy-1, UP },
+            { cx, cy+1, DOWN },
+        };
+
+        for (int i = 0; i < 4; i++)
+        {
+            int nx = Positions[i].x;
+            int ny = Positions[i].y;
+
+            if (Field_IsOob(Field, nx, ny))
+            {
+                Edge(&Counters, Piece, PIECE_EMPTY, Positions[i].Orientation, true);
+                continue;
+            }
+
+            // Cells reached on an earlier level are done, the next level can still be reached
+            // from other cells of this one
+            int Next = FIELD_INDEX(Field, nx, ny);
+            bool Seen = Field->Visit[Next] == Epoch;
+
+            if (Seen && Field->Order[Next] < LevelEnd)
+            {
+                continue;
+            }
+
+            if (!Edge(&Counters, Piece, (piece)Field->Cells[Next], Positions[i].Orientation, false))
+            {
+                continue;
+            }
+
+            if (Powers)
+            {
+                Field->Incoming[Next] |= 1<<Orientation_Flip(Positions[i].Orientation);
+            }
+
+            if (Seen)
+            {
+                continue;
+            }
+
+            Field->Visit[Next] = Epoch;
+            Field->Order[Next] = Trace->Count;
+            Trace->Cells[Trace->Count++] = Next;
+        }
+    }
+
+    Trace->OpenConns = Counters.OpenConns;
+    Trace->Junk = Counters.Junk;
+}
+
+void Field_Trace(field *Field, int x, int y, bool Powers, field_trace *Trace)
+{
+    Field_TraceNetwork(Field, x, y, Trace_PowerEdge, Powers, Trace);
+}
+
+void Field_TraceJunk(field *Field, int x, int y, field_trace *Trace)
+{
+    Field_TraceNetwork(Field, x, y, Trace_JunkEdge, false, Trace);
+}
+
+void Field_TraceFire(field *Field, int x, int y, field_trace *Trace)
+{
+    Field_TraceNetwork(Field, x, y, Trace_FireEdge, false, Trace);
+}
+
+// Board_GetTrace() over the whole field
+void Field_GetTrace(field *Field, field_trace *Trace)
+{
+    Field->TouchedPower.All = true;
+    Field_GetTraceTouched(Field, Trace);
+}
+
+// Board_GetTrace() over the power networks changed since the last call that found nothing:
+// any circuit or burning fire has to be in one of them
+void Field_GetTraceTouched(field *Field, field_trace *Trace)
+{
+    int Count = 0;
+
+    if (Field->TouchedPower.All)
+    {
+        memset(Field->Incoming, 0, (size_t)Field->Width*Field->Height);
+
+        for (int y = 0; y < Field->Height; y++)
+        {
+            for (int w = 0; w < Field->Words; w++)
+            {
+                for (uint64_t Bits = Field->Occupied[y*Field->Words + w]; Bits != 0; Bits &= Bits - 1)
+                {
+                    int i = FIELD_INDEX(Field, w*64 + BB_LowestBit64(Bits), y);
+                    if (Field->Cells[i] == PIECE_DST || Field->Cells[i] == PIECE_FIRE) Field->Region[Count++] = i;
+                }
+            }
+        }
+    }
+    else
+    {
+        Count = Field_PowerRegion(Field);
+    }
+
+    Field_FindCircuit(Field, Field->Region, Count, Trace);
+
+    if (Trace->Count == 0)
+    {
+        Field_JournalTake(&Field->TouchedPower, Field);
+    }
+}
+
+// Board_GetTraceJunk() limited to the wire networks changed since the last time it found
+// nothing, still returning the network of the lowest junk wire
+void Field_GetTraceJunk(field *Field, field_trace *Trace)
+{
+    field_journal *Journal = &Field->TouchedJunk;
+    unsigned int Mark = Field_NextMark(Field);
+    int Width = Field->Width;
+    int First = -1;
+
+    if (Journal->All)
+    {
+        for (int y = 0; y < Field->Height && First < 0; y++)
+        {
+            for (int w = 0; w < Field->Words && First < 0; w++)
+            {
+                for (uint64_t Bits = Field->Occupied[y*Field->Words + w]; Bits != 0; Bits &= Bits - 1)
+                {
+                    int i = FIELD_INDEX(Field, w*64 + BB_LowestBit64(Bits), y);
+                    if (!Piece_IsConnectionType((piece)Field->Cells[i]) || Field->Mark[i] == Mark)
+                    {
+                        continue;
+                    }
+
+                    Field_TraceJunk(Field, i % Width, i / Width, Trace);
+                    if (Trace->Junk)
+                    {
+                        return;
+                    }
+                    for (int c = 0; c < Trace->Count; c++) Field->Mark[Trace->Cells[c]] = Mark;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (int t = 0; t < Journal->Count; t++)
+        {
+            int Touched = Journal->Cells[t];
+            int tx = Touched % Width, ty = Touched / Width;
+            int Around[5][2] = { { tx, ty }, { tx-1, ty }, { tx+1, ty }, { tx, ty-1 }, { tx, ty+1 } };
+
+            for (int a = 0; a < 5; a++)
+            {
+                if (Field_IsOob(Field, Around[a][0], Around[a][1]))
+                {
+                    continue;
+                }
+
+                int i = FIELD_INDEX(Field, Around[a][0], Around[a][1]);
+                if (!Piece_IsConnectionType((piece)Field->Cells[i]) || Field->Mark[i] == Mark)
+                {
+                    continue;
+                }
+
+                Field_TraceJunk(Field, Around[a][0], Around[a][1], Trace);
+                for (int c = 0; c < Trace->Count; c++)
+                {
+                    int Cell = Trace->Cells[c];
+                    Field->Mark[Cell] = Mark;
+                    if (Trace->Junk && (First < 0 || Cell < First)) First = Cell;
+                }
+            }
+        }
+
+        // Traced again from its first wire, for the order junk spreads in
+        if (First >= 0)
+        {
+            Field_TraceJunk(Field, First % Width, First / Width, Trace);
+            return;
+        }
+    }
+
+    Field_TraceClear(Trace);
+    Field_JournalTake(Journal, Field);
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static bool Field_JournalInit(field_journal *Journal, field *Field)
+{
+    *Journal = (field_journal){ 0 };
+    Journal->Cells = malloc((size_t)Field->Width*Field->Height*sizeof(int));
+    Journal->Mask = calloc((size_t)Field->Height*Field->Words, sizeof(uint64_t));
+    Journal->All = true;
+
+    return Journal->Cells != NULL && Journal->Mask != NULL;
+}
+
+static void Field_JournalFree(field_journal *Journal)
+{
+    free(Journal->Cells);
+    free(Journal->Mask);
+    *Journal = (field_journal){ 0 };
+}
+
+// Empties the journal, only the listed cells have a mask bit to clear
+static void Field_JournalTake(field_journal *Journal, field *Field)
+{
+    for (int t = 0; t < Journal->Count; t++)
+    {
+        int x = Journal->Cells[t] % Field->Width, y = Journal->Cells[t] / Field->Width;
+        Journal->Mask[y*Field->Words + x/64] &= ~FIELD_BIT(x);
+    }
+
+    Journal->Count = 0;
+    Journal->All = false;
+}
+
+static void Field_Touch(field *Field, int i)
+{
+    field_journal *Journals[2] = { &Field->TouchedPower, &Field->TouchedJunk };
+    int x = i % Field->Width, y = i / Field->Width;
+
+    for (int j = 0; j < 2; j++)
+    {
+        field_journal *Journal = Journals[j];
+        uint64_t *Word = &Journal->Mask[y*Field->Words + x/64];
+
+        if (Journal->All || (*Word & FIELD_BIT(x)) != 0)
+        {
+            continue;
+        }
+
+        *Word |= FIELD_BIT(x);
+        Journal->Cells[Journal->Count++] = i;
+    }
+}
+
+// Moves a piece into an empty cell, the caller keeps Occupied in step
+static void Field_Move(field *Field, int From, int To)
+{
+    Field->Cells[To] = Field->Cells[From];
+    Field->Cells[From] = PIECE_EMPTY;
+    Field_Touch(Field, From);
+    Field_Touch(Field, To);
+}
+
+static unsigned int Field_NextEpoch(field *Field)
+{
+    if (++Field->Epoch == 0)
+    {
+        memset(Field->Visit, 0, (size_t)Field->Width*Field->Height*sizeof(unsigned int));
+        Field->Epoch = 1;
+    }
+
+    return Field->Epoch;
+}
+
+static unsigned int Field_NextMark(field *Field)
+{
+    if (++Field->MarkEpoch == 0)
+    {
+        memset(Field->Mark, 0, (size_t)Field->Width*Field->Height*sizeof(unsigned int));
+        Field->MarkEpoch = 1;
+    }
+
+    return Field->MarkEpoch;
+}
+
+static int Field_CompareCells(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// Fills Field->Region with the touched cells, their neighbours and every cell of the power
+// networks reaching into those, and clears their power. The nodes and fires among them are
+// then moved to the front in cell order, and their count returned
+static int Field_PowerRegion(field *Field)
+{
+    field_journal *Journal = &Field->TouchedPower;
+    unsigned int Mark = Field_NextMark(Field);
+    int Width = Field->Width;
+    int Count = 0;
+
+    trace Counters;
+    Trace_Clear(&Counters);
+
+    for (int t = 0; t < Journal->Count; t++)
+    {
+        int Touched = Journal->Cells[t];
+        int tx = Touched % Width, ty = Touched / Width;
+        int Around[5][2] = { { tx, ty }, { tx-1, ty }, { tx+1, ty }, { tx, ty-1 }, { tx, ty+1 } };
+
+        for (int a = 0; a < 5; a++)
+        {
+            if (Field_IsOob(Field, Around[a][0], Around[a][1]))
+            {
+                continue;
+            }
+
+            int i = FIELD_INDEX(Field, Around[a][0], Around[a][1]);
+            if (Field->Mark[i] != Mark)
+            {
+                Field->Mark[i] = Mark;
+                Field->Region[Count++] = i;
+            }
+        }
+    }
+
+    for (int Head = 0; Head < Count; Head++)
+    {
+        int Cell = Field->Region[Head];
+        int cx = Cell % Width, cy = Cell / Width;
+        piece Piece = (piece)Field->Cells[Cell];
+
+        struct {
+            int x, y;
+            orientation Orientation;
+        } Positions[4] = {
+            { cx-1, cy, LEFT },
+            { cx+1, cy, RIGHT },
+            { cx, cy-1, UP },
+            { cx, cy+1, DOWN },
+        };
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (Field_IsOob(Field, Positions[i].x, Positions[i].y))
+            {
+                continue;
+            }
+
+            int Next = FIELD_INDEX(Field, Positions[i].x, Positions[i].y);
+            if (Field->Mark[Next] != Mark && Trace_PowerEdge(&Counters, Piece, (piece)Field->Cells[Next], Positions[i].Orientation, false))
+            {
+                Field->Mark[Next] = Mark;
+                Field->Region[Count++] = Next;
+            }
+        }
+    }
+
+    int Sources = 0;
+    for (int r = 0; r < Count; r++)
+    {
+        int i = Field->Region[r];
+        Field->Incoming[i] = 0;
+        if (Field->Cells[i] == PIECE_DST || Field->Cells[i] == PIECE_FIRE) Field->Region[Sources++] = i;
+    }
+
+    qsort(Field->Region, Sources, sizeof(int), Field_CompareCells);
+    return Sources;
+}
+
+// Trace_FindCircuit() over a field, Sources are traced in the order given
+static void Field_FindCircuit(field *Field, int *Sources, int SourceCount, field_trace *Trace)
+{
+    unsigned int Mark = Field_NextMark(Field);
+    int Width = Field->Width;
+    int CircuitCount = 0;
+    int Used = 0;
+
+    for (int s = 0; s < SourceCount; s++)
+    {
+        int i = Sources[s];
+
+        if (Field->Cells[i] == PIECE_FIRE)
+        {
+            Field_TraceFire(Field, i % Width, i / Width, Trace);
+            if (Trace->Count > 1) return;
+            continue;
+        }
+
+        Field_Trace(Field, i % Width, i / Width, true, Trace);
+
+        // Networks are disjoint and each is kept once, so the circuits fit in the field
+        if (Field->Mark[i] != Mark && Trace->Count > 1)
+        {
+            Field->Circuits[CircuitCount*2] = i;
+            Field->Circuits[CircuitCount*2 + 1] = Used;
+            memcpy(Field->CircuitCells + Used, Trace->Cells, (size_t)Trace->Count*sizeof(int));
+            Used += Trace->Count;
+            CircuitCount++;
+        }
+
+        for (int c = 0; c < Trace->Count; c++) Field->Mark[Trace->Cells[c]] = Mark;
+    }
+
+    for (int c = 0; c < CircuitCount; c++)
+    {
+        int Start = Field->Circuits[c*2 + 1];
+        int End = (c + 1 < CircuitCount)? Field->Circuits[c*2 + 3] : Used;
+
+        if (Field_CountPowered(Field, Field->CircuitCells + Start, End - Start) > 1)
+        {
+            int i = Field->Circuits[c*2];
+            Field_Trace(Field, i % Width, i / Width, false, Trace);
+            Field_TraceFilter(Field, Trace);
+            return;
+        }
+    }
+
+    Field_TraceClear(Trace);
+}
+
+static int Field_CountPowered(field *Field, int *Cells, int Count)
+{
+    int Powered = 0;
+
+    for (int c = 0; c < Count; c++)
+    {
+        piece Piece = (piece)Field->Cells[Cells[c]];
+
+        if (Piece_IsConnectionType(Piece))
+        {
+            unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+            if ((Field->Incoming[Cells[c]] & DirFrom) != DirFrom) continue;
+        }
+
+        Powered++;
+    }
+
+    return Powered;
+}
+
+// Drops the wires that are not powered from every end, keeping the order of the rest
+static void Field_TraceFilter(field *Field, field_trace *Trace)
+{
+    int Count = 0;
+
+    for (int c = 0; c < Trace->Count; c++)
+    {
+        int Cell = Trace->Cells[c];
+        piece Piece = (piece)Field->Cells[Cell];
+
+        if (Piece_IsConnectionType(Piece))
+        {
+            unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+            if ((Field->Incoming[Cell] & DirFrom) != DirFrom) continue;
+        }
+
+        Trace->Cells[Count++] = Cell;
+    }
+
+    Trace->Count = Count;
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************************
+*
+*   Nettis core - boards sized at runtime
+*
+*   A field plays by the same rules as a board but its size is picked when it is created,
+*   up to FIELD_MAX_WIDTH x FIELD_MAX_HEIGHT. Everything it needs, traversal scratch included,
+*   is allocated once by Field_Init(), nothing is allocated while a game runs.
+*
+*   The standard BOARD_WIDTH x BOARD_HEIGHT game keeps using board, whose bitboards are much
+*   faster at that size. A field stores one piece per byte plus a bit mask per row, and every
+*   operation is linear in what it visits:
+*     - traces use generation stamps instead of clearing visited sets
+*     - gravity skips the columns that have nothing to drop
+*     - power is only re-evaluated over the networks changed since the last evaluation that
+*       found nothing, the same bound the board gets from network_index
+*
+********************************************************************************************/
+
+#ifndef NETTIS_FIELD_H
+#define NETTIS_FIELD_H
+
+#include "trace.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define FIELD_MAX_WIDTH 256
+#define FIELD_MAX_HEIGHT 1024
+
+#define FIELD_INDEX(Field, x, y) ((y)*(Field)->Width + (x))
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Cells changed since some point, each listed once
+typedef struct {
+    int *Cells;
+    int Count;
+    uint64_t *Mask;                 // Row masks of the listed cells
+    bool All;                       // Every cell counts as changed, nothing is listed
+} field_journal;
+
+typedef struct {
+    int Width;
+    int Height;
+    int Words;                      // 64-bit words in one row of a row mask
+    unsigned char *Cells;           // Piece of every cell, FIELD_INDEX order
+    uint64_t *Occupied;             // Row masks, bit x of row y at word y*Words + x/64
+    unsigned char *Incoming;        // Power reaching each wire, as power_board.Incoming
+    unsigned int Version;
+
+    // Cells changed since the last power, and junk, evaluation that found nothing
+    field_journal TouchedPower;
+    field_journal TouchedJunk;
+
+    // Scratch, sized to the field
+    unsigned int *Visit;            // Epoch a traversal last reached each cell in
+    int *Order;                     // Position of each reached cell in its traversal
+    unsigned int Epoch;
+    unsigned int *Mark;             // Same for the cells a whole evaluation has covered
+    unsigned int MarkEpoch;
+    int *Region;
+    int *Circuits;                  // Node and first cell of each candidate circuit
+    int *CircuitCells;
+    uint64_t *Falling;
+} field;
+
+// Traces are filled in place, their storage comes from Field_TraceInit()
+typedef struct {
+    int *Cells;                     // Cell indices (FIELD_INDEX) in traversal order
+    int Count;
+    int Capacity;
+    int OpenConns;
+    bool Junk;
+} field_trace;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Field_Init(field *Field, int Width, int Height);      // False on a bad size or out of memory
+void Field_Free(field *Field);
+void Field_Reset(field *Field);
+void Field_CopyBoard(field *Field, board *Board);           // Tiles the board over the whole field
+piece Field_GetTile(field *Field, int x, int y);
+void Field_SetTile(field *Field, int x, int y, piece Piece);
+void Field_PutTileSafe(field *Field, int x, int y, piece Piece);
+bool Field_IsOob(field *Field, int x, int y);
+bool Field_IsOccupied(field *Field, int x, int y);
+bool Field_ShouldPlaceBrick(field *Field, brick *Brick);
+bool Field_GravityStep(field *Field);
+int Field_Settle(field *Field);
+void Field_CleanSurroundings(field *Field, int x, int y);
+unsigned int Field_Checksum(field *Field);                 // Board_Checksum() of the same pieces
+
+bool Field_TraceInit(field_trace *Trace, field *Field);
+void Field_TraceFree(field_trace *Trace);
+void Field_TraceClear(field_trace *Trace);
+void Field_TraceNetwork(field *Field, int x, int y, trace_edge Edge, bool Powers, field_trace *Trace);
+void Field_Trace(field *Field, int x, int y, bool Powers, field_trace *Trace);
+void Field_TraceJunk(field *Field, int x, int y, field_trace *Trace);
+void Field_TraceFire(field *Field, int x, int y, field_trace *Trace);
+void Field_GetTrace(field *Field, field_trace *Trace);
+void Field_GetTraceTouched(field *Field, field_trace *Trace);
+void Field_GetTraceJunk(field *Field, field_trace *Trace);
+
+#endif // NETTIS_FIELD_H
@@ -0,0 +1,866 @@
+/*******************************************************************************************
+*
+*   Nettis core - gameplay rules
+*
+********************************************************************************************/
+
+#include "gameplay.h"
+#include "zone.h"
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define GP_CASCADE_TICK_EVENTS (BOARD_CELLS + 16)     // Most events one tick can record
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool GP_Resolve(gameplay *Gameplay, unsigned int Now);
+static void GP_Move(gameplay *Gameplay, unsigned int Input, unsigned int Now);
+static void GP_Settle(gameplay *Gameplay);
+static void GP_BuildCascade(gameplay *Gameplay, unsigned int Now);
+static bool GP_StepCascade(gameplay *Gameplay, gp_cascade *Cascade, unsigned int Tick);
+static void GP_Record(gp_cascade *Cascade, unsigned int Tick, gp_event_kind Kind, int Cell, int Value);
+static bool GP_PlayCascade(gameplay *Gameplay, unsigned int Now);
+static bool GP_PlayEvents(gameplay *Gameplay, unsigned int Now);
+static void GP_CatchUp(gameplay *Gameplay, unsigned int Now);
+static void GP_Save(gameplay *Gameplay, gp_resolution *Resolution);
+static void GP_Load(gameplay *Gameplay, gp_resolution *Resolution);
+static void GP_SaveQuiet(gameplay *Gameplay, gp_quiet *Quiet, unsigned int Tick);
+static void GP_LoadQuiet(gameplay *Gameplay, gp_quiet *Quiet);
+static void GP_KeepVersion(gameplay *Gameplay, unsigned int Shown);
+static void GP_PlaceBrick(gameplay *Gameplay);
+static void GP_DropJunk(gameplay *Gameplay);
+static void GP_EvaluatePower(gameplay *Gameplay);
+static void GP_EvaluateJunk(gameplay *Gameplay);
+static brick GP_NextBrick(gameplay *Gameplay);
+static unsigned int GP_Version(gameplay *Gameplay);
+static double GP_Clock(gameplay *Gameplay);
+static void GP_AddTime(gameplay *Gameplay, gp_phase Phase, double Start);
+static int GP_TraceCount(gameplay *Gameplay, bool Junk);
+static int GP_TraceCell(gameplay *Gameplay, bool Junk, int Index);
+static void GP_SetTile(gameplay *Gameplay, int x, int y, piece Piece);
+static bool GP_ShouldPlaceBrick(gameplay *Gameplay, brick *Brick);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+timer Timer_Make(unsigned int Now, unsigned int Duration)
+{
+    timer NewTimer;
+    NewTimer.Start = Now;
+    NewTimer.Duration = Duration;
+    return NewTimer;
+}
+
+bool Timer_IsExpired(timer *Timer, unsigned int Now)
+{
+    return Now - Timer->Start >= Timer->Duration;
+}
+
+// Scores one piece of a circuit being cleared, the chains grow with every piece
+int Scoring_AddCleared(scoring *Scoring, piece Piece)
+{
+    if (Piece == PIECE_DST)
+    {
+        Scoring->NodeChain += 1;
+    }
+    Scoring->WireChain += 1;
+
+    int Points = 10*Scoring->Multiplier*(Scoring->NodeChain+1)*(Scoring->WireChain+1);
+    Scoring->Score += Points;
+    return Points;
+}
+
+gp_rules GP_DefaultRules(void)
+{
+    gp_rules Rules;
+    Rules.GravityTicks = GP_SECONDS_TO_TICKS(GP_GRAVITY_SECONDS);
+    Rules.TraceTicks = GP_SECONDS_TO_TICKS(GP_TRACE_SECONDS);
+    Rules.Bricks = Brick_DefaultTable();
+    Rules.Width = BOARD_WIDTH;
+    Rules.Height = BOARD_HEIGHT;
+    return Rules;
+}
+
+void GP_Init(gameplay *Gameplay, uint64_t Seed)
+{
+    gp_rules Rules = GP_DefaultRules();
+    GP_InitRules(Gameplay, Seed, &Rules);
+}
+
+// A gameplay still holding a field has to be released with GP_Free() first
+bool GP_InitRules(gameplay *Gameplay, uint64_t Seed, const gp_rules *Rules)
+{
+    *Gameplay = (gameplay){ 0 };
+    Gameplay->Rules = *Rules;
+
+    if (Rules->Width != BOARD_WIDTH || Rules->Height != BOARD_HEIGHT)
+    {
+        // All the storage of the game, allocated once
+        if (!Field_Init(&Gameplay->Field, Rules->Width, Rules->Height) ||
+            !Field_TraceInit(&Gameplay->FieldTrace, &Gameplay->Field) ||
+            !Field_TraceInit(&Gameplay->FieldTraceJunk, &Gameplay->Field))
+        {
+            GP_Free(Gameplay);
+            return false;
+        }
+    }
+
+    Brick_QueueInit(&Gameplay->Queue, Seed, Rules->Bricks);
+    Gameplay->Brick = GP_NextBrick(Gameplay);
+    return true;
+}
+
+void GP_Free(gameplay *Gameplay)
+{
+    Field_TraceFree(&Gameplay->FieldTrace);
+    Field_TraceFree(&Gameplay->FieldTraceJunk);
+    Field_Free(&Gameplay->Field);
+}
+
+// Bricks only move on quiet ticks, when no circuit is being cleared and no junk is spreading.
+// What a lock sets off on the standard board is resolved at once and played back from there
+void GP_Update(gameplay *Gameplay, unsigned int Input)
+{
+    ZONE_BEGIN("GP_Update");
+    unsigned int Now = Gameplay->Tick++;
+
+    bool Quiet = Gameplay->Cascade.Active? GP_PlayCascade(Gameplay, Now) : GP_Resolve(Gameplay, Now);
+    if (Quiet)
+    {
+        GP_Move(Gameplay, Input, Now);
+
+        if (Gameplay->Cascade.Active)
+        {
+            Gameplay->Falls.Count = 0;
+            GP_PlayEvents(Gameplay, Now);
+        }
+        else
+        {
+            GP_Settle(Gameplay);
+        }
+    }
+
+    if (!Gameplay->Cascade.Active && !GP_IsField(Gameplay) && !GP_IsIdle(Gameplay))
+    {
+        GP_BuildCascade(Gameplay, Now);
+    }
+    ZONE_END();
+}
+
+// Same as the bot waits for before it plans the next brick
+bool GP_IsIdle(gameplay *Gameplay)
+{
+    if (Gameplay->Cascade.Active)
+    {
+        return Gameplay->Cascade.Idle;
+    }
+
+    unsigned int Version = GP_Version(Gameplay);
+    return Gameplay->PowerVersion == Version && Gameplay->JunkVersion == Version &&
+        GP_TraceCount(Gameplay, false) == 0 && GP_TraceCount(Gameplay, true) == 0;
+}
+
+void GP_AddJunk(gameplay *Gameplay, int Count)
+{
+    if (Count > 0) Gameplay->JunkPending += Count;
+}
+
+// The game holds the resolution state a chain started from, the one at the end of the tick
+// before Start, and everything else as of now. Resolves the chain again unless Cascade still
+// holds it, then plays it up to now
+void GP_ResumeCascade(gameplay *Gameplay, unsigned int Start, bool Resolved)
+{
+    if (Resolved)
+    {
+        Gameplay->Cascade.Cursor = 0;
+        Gameplay->Cascade.Idle = false;
+        Gameplay->Cascade.Active = true;
+    }
+    else
+    {
+        GP_BuildCascade(Gameplay, Start - 1);
+    }
+
+    for (unsigned int Tick = Start; Tick < Gameplay->Tick; Tick++)
+    {
+        if (GP_PlayEvents(Gameplay, Tick))
+        {
+            Gameplay->Scoring.NodeChain = 0;
+            Gameplay->Scoring.WireChain = 0;
+            Gameplay->Scoring.Multiplier = 0;
+            Gameplay->Falls.Count = 0;
+            GP_PlayEvents(Gameplay, Tick);
+        }
+    }
+}
+
+bool GP_IsField(gameplay *Gameplay)
+{
+    return Gameplay->Field.Cells != NULL;
+}
+
+int GP_Width(gameplay *Gameplay)
+{
+    return GP_IsField(Gameplay)? Gameplay->Field.Width : BOARD_WIDTH;
+}
+
+int GP_Height(gameplay *Gameplay)
+{
+    return GP_IsField(Gameplay)? Gameplay->Field.Height : BOARD_HEIGHT;
+}
+
+piece GP_GetTile(gameplay *Gameplay, int x, int y)
+{
+    return GP_IsField(Gameplay)? Field_GetTile(&Gameplay->Field, x, y) : Board_GetTile(&Gameplay->Board, x, y);
+}
+
+unsigned int GP_Checksum(gameplay *Gameplay)
+{
+    return GP_IsField(Gameplay)? Field_Checksum(&Gameplay->Field) : Board_Checksum(&Gameplay->Board);
+}
+
+// Two games that hash alike are in step. The board part is kept up to date by the board
+// itself, so this is a handful of multiplies; a field is still walked by Field_Checksum()
+uint64_t GP_Hash(gameplay *Gameplay)
+{
+    brick *Brick = &Gameplay->Brick;
+    uint64_t Hash = GP_IsField(Gameplay)? Field_Checksum(&Gameplay->Field) : Gameplay->Board.Hash;
+    uint64_t Fields[] = {
+        (uint64_t)(unsigned int)Gameplay->Scoring.Score,
+        Gameplay->Tick,
+        (uint64_t)((Brick->x & 0xFF) | (Brick->y & 0xFF) << 8 | Brick->Orientation << 16),
+        (uint64_t)(Brick->Pieces[0] | Brick->Pieces[1] << 8),
+        (uint64_t)(unsigned int)Gameplay->JunkPending,
+    };
+
+    for (int i = 0; i < (int)(sizeof(Fields)/sizeof(Fields[0])); i++)
+    {
+        Hash = (Hash ^ Fields[i])*0x100000001B3ULL;
+        Hash ^= Hash >> 29;
+    }
+
+    return Hash;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// One tick of clearing circuits and spreading junk, true when it is a quiet tick
+static bool GP_Resolve(gameplay *Gameplay, unsigned int Now)
+{
+    int Width = GP_Width(Gameplay);
+
+    if (Gameplay->TraceIndex >= GP_TraceCount(Gameplay, false))
+    {
+        Gameplay->Scoring.Multiplier += 1;
+        Gameplay->TraceIndex = 0;
+
+        // Clearing a circuit changes the board, so an evaluation still matching the board
+        // found nothing and there is nothing to redo
+        if (Gameplay->PowerVersion != GP_Version(Gameplay))
+        {
+            double Start = GP_Clock(Gameplay);
+            GP_EvaluatePower(Gameplay);
+            GP_AddTime(Gameplay, GP_PHASE_POWER, Start);
+        }
+    }
+    else
+    {
+        if (Timer_IsExpired(&Gameplay->TimerTrace, Now))
+        {
+            int Cell = GP_TraceCell(Gameplay, false, Gameplay->TraceIndex);
+            int x = Cell % Width, y = Cell / Width;
+            Scoring_AddCleared(&Gameplay->Scoring, GP_GetTile(Gameplay, x, y));
+            GP_SetTile(Gameplay, x, y, PIECE_EMPTY);
+            ZONE_BEGIN("CleanSurroundings");
+            if (GP_IsField(Gameplay)) Field_CleanSurroundings(&Gameplay->Field, x, y);
+            else Board_CleanSurroundings(&Gameplay->Board, x, y);
+            ZONE_END();
+            Gameplay->TimerTrace = Timer_Make(Now, Gameplay->Rules.TraceTicks);
+            Gameplay->TraceIndex = (Gameplay->TraceIndex + 1);
+        }
+        return false;
+    }
+
+    if (Gameplay->TraceJunkIndex >= GP_TraceCount(Gameplay, true))
+    {
+        Gameplay->Scoring.Multiplier += 1;
+        Gameplay->TraceJunkIndex = 0;
+        if (Gameplay->JunkVersion != GP_Version(Gameplay))
+        {
+            double Start = GP_Clock(Gameplay);
+            GP_EvaluateJunk(Gameplay);
+            GP_AddTime(Gameplay, GP_PHASE_JUNK, Start);
+        }
+    }
+    else
+    {
+        if (Timer_IsExpired(&Gameplay->TimerJunk, Now))
+        {
+            int Cell = GP_TraceCell(Gameplay, true, Gameplay->TraceJunkIndex);
+            int x = Cell % Width, y = Cell / Width;
+            GP_SetTile(Gameplay, x, y, PIECE_JUNK);
+            Gameplay->TimerJunk = Timer_Make(Now, Gameplay->Rules.TraceTicks);
+            Gameplay->TraceJunkIndex = (Gameplay->TraceJunkIndex + 1);
+        }
+        return false;
+    }
+
+    return GP_TraceCount(Gameplay, true) == 0 && GP_TraceCount(Gameplay, false) == 0;
+}
+
+// Chains start over, then input and gravity move the brick, which may lock
+static void GP_Move(gameplay *Gameplay, unsigned int Input, unsigned int Now)
+{
+    Gameplay->Scoring.NodeChain = 0;
+    Gameplay->Scoring.WireChain = 0;
+    Gameplay->Scoring.Multiplier = 0;
+
+    // Every action of the tick is applied: the rotation first, then one move that sums the
+    // shifts, the soft drop and gravity. Left and right together cancel out
+    brick NewBrick = Gameplay->Brick;
+    if (Input & GP_INPUT_ROTATE)
+    {
+        NewBrick = Brick_Rotate(&Gameplay->Brick);
+        if (GP_ShouldPlaceBrick(Gameplay, &NewBrick)) {
+            NewBrick = Gameplay->Brick;
+        }
+
+        Gameplay->Brick = NewBrick;
+    }
+
+    int dx = ((Input & GP_INPUT_RIGHT) != 0) - ((Input & GP_INPUT_LEFT) != 0);
+    int dy = (Input & GP_INPUT_DOWN) != 0;
+
+    if (Timer_IsExpired(&Gameplay->TimerGravity, Now))
+    {
+        Gameplay->TimerGravity = Timer_Make(Now, Gameplay->Rules.GravityTicks);
+        dy += 1;
+    }
+
+    if (dx != 0 || dy != 0)
+    {
+        NewBrick = Brick_Move(&Gameplay->Brick, dx, dy);
+        if (GP_ShouldPlaceBrick(Gameplay, &NewBrick))
+        {
+            if (dy != 0)
+            {
+                if (Gameplay->Cascade.Active) GP_CatchUp(Gameplay, Now);
+                GP_PlaceBrick(Gameplay);
+                GP_DropJunk(Gameplay);
+                Gameplay->Brick = GP_NextBrick(Gameplay);
+                if (GP_ShouldPlaceBrick(Gameplay, &Gameplay->Brick))
+                {
+                    Gameplay->Scoring = (scoring){ 0 };
+                    Gameplay->JunkPending = 0;
+                    if (GP_IsField(Gameplay)) Field_Reset(&Gameplay->Field);
+                    else Board_Reset(&Gameplay->Board);
+                }
+            }
+        }
+        else
+        {
+            Gameplay->Brick = NewBrick;
+        }
+    }
+}
+
+static void GP_Settle(gameplay *Gameplay)
+{
+    ZONE_BEGIN("GP_Settle");
+    double Start = GP_Clock(Gameplay);
+    if (GP_IsField(Gameplay))
+    {
+        // Too many pieces can fall at once to keep each of them for animation
+        Field_Settle(&Gameplay->Field);
+        Gameplay->Falls.Count = 0;
+    }
+    else
+    {
+        Board_Settle(&Gameplay->Board, &Gameplay->Falls);
+    }
+    GP_AddTime(Gameplay, GP_PHASE_SETTLE, Start);
+    ZONE_END();
+}
+
+// Resolves everything from the next tick until the game is idle, and records what the board,
+// Powers and the score go through. Resolving only touches the state a gp_resolution holds, so
+// the chain is resolved on the game itself and the game is put back to Origin afterwards
+static void GP_BuildCascade(gameplay *Gameplay, unsigned int Now)
+{
+    ZONE_BEGIN("GP_BuildCascade");
+    gp_cascade *Cascade = &Gameplay->Cascade;
+
+    Cascade->Active = false;
+    Cascade->Start = Now + 1;
+    Cascade->Cursor = 0;
+    Cascade->Count = 0;
+    Cascade->PowerCount = 0;
+    Cascade->QuietCount = 0;
+    Cascade->Idle = false;
+    GP_Save(Gameplay, &Cascade->Origin);
+
+    // A timeline that could fill up on the next tick ends before it, the chain goes on being
+    // resolved for the outcome only
+    gp_cascade *Record = Cascade;
+    unsigned int Tick = Cascade->Start;
+    for (bool Idle = GP_IsIdle(Gameplay); !Idle; Tick++)
+    {
+        if (Record != NULL && (Cascade->Count + GP_CASCADE_TICK_EVENTS > GP_CASCADE_EVENTS ||
+            Cascade->PowerCount == GP_CASCADE_POWERS || Tick - Cascade->Start > USHRT_MAX))
+        {
+            GP_Save(Gameplay, &Cascade->Final);
+            Cascade->End = Tick;
+            Record = NULL;
+        }
+        Idle = GP_StepCascade(Gameplay, Record, Tick);
+    }
+
+    if (Record != NULL)
+    {
+        GP_Save(Gameplay, &Cascade->Final);
+        Cascade->End = Tick;
+    }
+    Cascade->Outcome = Gameplay->Board;
+    Cascade->OutcomeScore = Gameplay->Scoring.Score;
+
+    GP_Load(Gameplay, &Cascade->Origin);
+    Cascade->Active = true;
+    ZONE_END();
+}
+
+// Runs one tick of a game that is not idle the way GP_Update() would without input, recording
+// into Cascade unless it is NULL. Returns whether the game is idle after it
+static bool GP_StepCascade(gameplay *Gameplay, gp_cascade *Cascade, unsigned int Tick)
+{
+    board Board = Gameplay->Board;
+    scoring Scoring = Gameplay->Scoring;
+    unsigned int PowerVersion = Gameplay->PowerVersion;
+
+    bool Quiet = GP_Resolve(Gameplay, Tick);
+
+    if (Cascade != NULL)
+    {
+        // A tick changes a cell or two, the planes tell which
+        bitboard Changed = { 0 };
+        for (int Piece = PIECE_EMPTY + 1; Piece < PIECE_PALLETE_SIZE; Piece++)
+        {
+            Changed = BB_Or(Changed, BB_Xor(Board.Planes[Piece], Gameplay->Board.Planes[Piece]));
+        }
+
+        while (!BB_IsEmpty(Changed))
+        {
+            int i = BB_Lowest(Changed);
+            Changed = BB_AndNot(Changed, BB_Cell(i));
+
+            piece Old = Board_GetTile(&Board, i % BOARD_WIDTH, i / BOARD_WIDTH);
+            piece New = Board_GetTile(&Gameplay->Board, i % BOARD_WIDTH, i / BOARD_WIDTH);
+            if (New == PIECE_EMPTY) GP_Record(Cascade, Tick, GP_EVENT_CLEAR, i, Old);
+            else if (New == PIECE_JUNK) GP_Record(Cascade, Tick, GP_EVENT_JUNK, i, Old);
+            else GP_Record(Cascade, Tick, GP_EVENT_SET, i, New);
+        }
+
+        if (Scoring.Score != Gameplay->Scoring.Score)
+        {
+            GP_Record(Cascade, Tick, GP_EVENT_SCORE, 0, Gameplay->Scoring.Score);
+        }
+        if (Scoring.NodeChain != Gameplay->Scoring.NodeChain || Scoring.WireChain != Gameplay->Scoring.WireChain)
+        {
+            GP_Record(Cascade, Tick, GP_EVENT_CHAIN, 0, Gameplay->Scoring.NodeChain<<16 | (Gameplay->Scoring.WireChain & 0xffff));
+        }
+
+        // Most evaluations find the powers as they were
+        power_board *Last = (Cascade->PowerCount > 0)? &Cascade->Powers[Cascade->PowerCount - 1] : &Cascade->Origin.Powers;
+        if (PowerVersion != Gameplay->PowerVersion && memcmp(Last, &Gameplay->Powers, sizeof(power_board)) != 0)
+        {
+            Cascade->Powers[Cascade->PowerCount] = Gameplay->Powers;
+            GP_Record(Cascade, Tick, GP_EVENT_POWER, 0, Cascade->PowerCount++);
+        }
+    }
+
+    if (Quiet)
+    {
+        if (Cascade != NULL && Cascade->QuietCount < GP_CASCADE_QUIETS)
+        {
+            GP_SaveQuiet(Gameplay, &Cascade->Quiets[Cascade->QuietCount++], Tick);
+        }
+
+        Gameplay->Scoring.NodeChain = 0;
+        Gameplay->Scoring.WireChain = 0;
+        Gameplay->Scoring.Multiplier = 0;
+        GP_Settle(Gameplay);
+
+        if (Cascade != NULL)
+        {
+            GP_Record(Cascade, Tick, GP_EVENT_QUIET, 0, 0);
+            for (int i = 0; i < Gameplay->Falls.Count; i++)
+            {
+                board_fall *Fall = &Gameplay->Falls.Falls[i];
+                GP_Record(Cascade, Tick, GP_EVENT_FALL, BOARD_INDEX(Fall->x, Fall->FromY), BOARD_INDEX(Fall->x, Fall->ToY));
+            }
+        }
+    }
+
+    bool Idle = GP_IsIdle(Gameplay);
+    if (Cascade != NULL && Idle)
+    {
+        GP_Record(Cascade, Tick, GP_EVENT_IDLE, 0, 1);
+    }
+
+    return Idle;
+}
+
+static void GP_Record(gp_cascade *Cascade, unsigned int Tick, gp_event_kind Kind, int Cell, int Value)
+{
+    gp_event *Event = &Cascade->Events[Cascade->Count++];
+    Event->Tick = (unsigned short)(Tick - Cascade->Start);
+    Event->Kind = (unsigned char)Kind;
+    Event->Cell = (unsigned char)Cell;
+    Event->Value = Value;
+}
+
+// Plays the start of a tick, up to the brick moving on a quiet one
+static bool GP_PlayCascade(gameplay *Gameplay, unsigned int Now)
+{
+    gp_cascade *Cascade = &Gameplay->Cascade;
+
+    if (Now == Cascade->End)
+    {
+        unsigned int Version = Gameplay->Board.Version;
+        GP_Load(Gameplay, &Cascade->Final);
+        GP_KeepVersion(Gameplay, Version);
+        Cascade->Active = false;
+        return GP_Resolve(Gameplay, Now);
+    }
+
+    return GP_PlayEvents(Gameplay, Now);
+}
+
+// Plays the events of the tick up to its GP_EVENT_QUIET, true when there was one
+static bool GP_PlayEvents(gameplay *Gameplay, unsigned int Now)
+{
+    gp_cascade *Cascade = &Gameplay->Cascade;
+
+    while (Cascade->Cursor < Cascade->Count && Cascade->Start + Cascade->Events[Cascade->Cursor].Tick == Now)
+    {
+        gp_event *Event = &Cascade->Events[Cascade->Cursor++];
+        int x = Event->Cell % BOARD_WIDTH, y = Event->Cell / BOARD_WIDTH;
+
+        switch (Event->Kind)
+        {
+            case GP_EVENT_CLEAR:
+                Board_SetTile(&Gameplay->Board, x, y, PIECE_EMPTY);
+                break;
+            case GP_EVENT_JUNK:
+                Board_SetTile(&Gameplay->Board, x, y, PIECE_JUNK);
+                break;
+            case GP_EVENT_SET:
+                Board_SetTile(&Gameplay->Board, x, y, (piece)Event->Value);
+                break;
+            case GP_EVENT_SCORE:
+                Gameplay->Scoring.Score = Event->Value;
+                break;
+            case GP_EVENT_CHAIN:
+                Gameplay->Scoring.NodeChain = Event->Value >> 16;
+                Gameplay->Scoring.WireChain = Event->Value & 0xffff;
+                break;
+            case GP_EVENT_POWER:
+                Gameplay->Powers = Cascade->Powers[Event->Value];
+                Gameplay->PowerVersion = Gameplay->Board.Version;
+                break;
+            case GP_EVENT_QUIET:
+                return true;
+            case GP_EVENT_FALL:
+            {
+                piece Piece = Board_GetTile(&Gameplay->Board, x, y);
+                int ToY = Event->Value / BOARD_WIDTH;
+                Board_SetTile(&Gameplay->Board, x, y, PIECE_EMPTY);
+                Board_SetTile(&Gameplay->Board, x, ToY, Piece);
+                Gameplay->Falls.Falls[Gameplay->Falls.Count++] = (board_fall){ x, y, ToY };
+            } break;
+            case GP_EVENT_IDLE:
+                Cascade->Idle = Event->Value != 0;
+                break;
+        }
+    }
+
+    return false;
+}
+
+// The brick locks before the timeline ends, the rest of the chain has to be resolved again
+// with the new pieces. Takes the state the timeline kept for this quiet tick, or resolves up
+// to it from where the timeline started
+static void GP_CatchUp(gameplay *Gameplay, unsigned int Now)
+{
+    gp_cascade *Cascade = &Gameplay->Cascade;
+    unsigned int Version = Gameplay->Board.Version;
+
+    int Quiet = 0;
+    while (Quiet < Cascade->QuietCount && Cascade->Quiets[Quiet].Tick != Now) Quiet++;
+
+    if (Quiet < Cascade->QuietCount)
+    {
+        GP_LoadQuiet(Gameplay, &Cascade->Quiets[Quiet]);
+        Gameplay->Scoring.NodeChain = 0;
+        Gameplay->Scoring.WireChain = 0;
+        Gameplay->Scoring.Multiplier = 0;
+    }
+    else
+    {
+        GP_Load(Gameplay, &Cascade->Origin);
+        for (unsigned int Tick = Cascade->Start; Tick <= Now; Tick++)
+        {
+            if (GP_Resolve(Gameplay, Tick))
+            {
+                Gameplay->Scoring.NodeChain = 0;
+                Gameplay->Scoring.WireChain = 0;
+                Gameplay->Scoring.Multiplier = 0;
+                if (Tick < Now) GP_Settle(Gameplay);
+            }
+        }
+    }
+
+    GP_KeepVersion(Gameplay, Version);
+    Cascade->Active = false;
+}
+
+static void GP_Save(gameplay *Gameplay, gp_resolution *Resolution)
+{
+    Resolution->Powers = Gameplay->Powers;
+    Resolution->PowerVersion = Gameplay->PowerVersion;
+    Resolution->JunkVersion = Gameplay->JunkVersion;
+    Resolution->Board = Gameplay->Board;
+    Resolution->Networks = Gameplay->Networks;
+    Resolution->Trace = Gameplay->Trace;
+    Resolution->TraceJunk = Gameplay->TraceJunk;
+    Resolution->TimerTrace = Gameplay->TimerTrace;
+    Resolution->TraceIndex = Gameplay->TraceIndex;
+    Resolution->TimerJunk = Gameplay->TimerJunk;
+    Resolution->TraceJunkIndex = Gameplay->TraceJunkIndex;
+    Resolution->Scoring = Gameplay->Scoring;
+    Resolution->Falls = Gameplay->Falls;
+}
+
+static void GP_Load(gameplay *Gameplay, gp_resolution *Resolution)
+{
+    Gameplay->Powers = Resolution->Powers;
+    Gameplay->PowerVersion = Resolution->PowerVersion;
+    Gameplay->JunkVersion = Resolution->JunkVersion;
+    Gameplay->Board = Resolution->Board;
+    Gameplay->Networks = Resolution->Networks;
+    Gameplay->Trace = Resolution->Trace;
+    Gameplay->TraceJunk = Resolution->TraceJunk;
+    Gameplay->TimerTrace = Resolution->TimerTrace;
+    Gameplay->TraceIndex = Resolution->TraceIndex;
+    Gameplay->TimerJunk = Resolution->TimerJunk;
+    Gameplay->TraceJunkIndex = Resolution->TraceJunkIndex;
+    Gameplay->Scoring = Resolution->Scoring;
+    Gameplay->Falls = Resolution->Falls;
+}
+
+static void GP_SaveQuiet(gameplay *Gameplay, gp_quiet *Quiet, unsigned int Tick)
+{
+    Quiet->Tick = Tick;
+    Quiet->PowerCurrent = Gameplay->PowerVersion == Gameplay->Board.Version;
+    Quiet->JunkCurrent = Gameplay->JunkVersion == Gameplay->Board.Version;
+    Quiet->Touched = Gameplay->Board.Touched;
+    Quiet->Trace = Gameplay->Trace;
+    Quiet->TraceJunk = Gameplay->TraceJunk;
+    Quiet->TimerTrace = Gameplay->TimerTrace;
+    Quiet->TraceIndex = Gameplay->TraceIndex;
+    Quiet->TimerJunk = Gameplay->TimerJunk;
+    Quiet->TraceJunkIndex = Gameplay->TraceJunkIndex;
+}
+
+// Onto the game played back to the quiet tick, its board only differs in version
+static void GP_LoadQuiet(gameplay *Gameplay, gp_quiet *Quiet)
+{
+    unsigned int Version = Gameplay->Board.Version;
+    Gameplay->PowerVersion = Quiet->PowerCurrent? Version : Version - 1;
+    Gameplay->JunkVersion = Quiet->JunkCurrent? Version : Version - 1;
+    Gameplay->Board.Touched = Quiet->Touched;
+    Gameplay->Networks = (network_index){ 0 };
+    Gameplay->Trace = Quiet->Trace;
+    Gameplay->TraceJunk = Quiet->TraceJunk;
+    Gameplay->TimerTrace = Quiet->TimerTrace;
+    Gameplay->TraceIndex = Quiet->TraceIndex;
+    Gameplay->TimerJunk = Quiet->TimerJunk;
+    Gameplay->TraceJunkIndex = Quiet->TraceJunkIndex;
+}
+
+// Board versions are cache keys, a loaded board must not reuse one the game already showed.
+// Every version kept is shifted alike, so what matched the board still does
+static void GP_KeepVersion(gameplay *Gameplay, unsigned int Shown)
+{
+    if (Gameplay->Board.Version > Shown)
+    {
+        return;
+    }
+
+    unsigned int Shift = Shown + 1 - Gameplay->Board.Version;
+    Gameplay->Board.Version += Shift;
+    Gameplay->PowerVersion += Shift;
+    Gameplay->JunkVersion += Shift;
+    Gameplay->Networks.Version += Shift;
+}
+
+// Locks the falling brick into the board one piece at a time, merging each piece into the
+// network index as it lands
+static void GP_PlaceBrick(gameplay *Gameplay)
+{
+    brick *Brick = &Gameplay->Brick;
+    int x[2], y[2];
+    Brick_Locations(Brick, x, y);
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (GP_IsField(Gameplay))
+        {
+            Field_PutTileSafe(&Gameplay->Field, x[i], y[i], Brick->Pieces[i]);
+            continue;
+        }
+
+        if (Brick->Pieces[i] == PIECE_EMPTY || Board_IsOob(&Gameplay->Board, x[i], y[i]))
+        {
+            continue;
+        }
+
+        Board_PutTileSafe(&Gameplay->Board, x[i], y[i], Brick->Pieces[i]);
+        Network_Add(&Gameplay->Networks, &Gameplay->Board, x[i], y[i]);
+    }
+}
+
+// Pending junk lands on top of the stacks, a piece per column starting from one that moves
+// with the tick. A full column loses its piece
+static void GP_DropJunk(gameplay *Gameplay)
+{
+    int Width = GP_Width(Gameplay), Height = GP_Height(Gameplay);
+    int Count = (Gameplay->JunkPending < GP_JUNK_PER_LOCK)? Gameplay->JunkPending : GP_JUNK_PER_LOCK;
+    if (Count > Width) Count = Width;
+    Gameplay->JunkPending -= Count;
+
+    for (int i = 0; i < Count; i++)
+    {
+        int x = (int)((Gameplay->Tick + i) % (unsigned int)Width);
+        int y = 0;
+        while (y < Height && GP_GetTile(Gameplay, x, y) == PIECE_EMPTY) y++;
+        if (y == 0) continue;
+
+        if (GP_IsField(Gameplay))
+        {
+            Field_PutTileSafe(&Gameplay->Field, x, y - 1, PIECE_JUNK);
+            continue;
+        }
+
+        Board_PutTileSafe(&Gameplay->Board, x, y - 1, PIECE_JUNK);
+        Network_Add(&Gameplay->Networks, &Gameplay->Board, x, y - 1);
+    }
+}
+
+// Brings Powers and Trace up to date with the board. After a quiet evaluation only the power
+// networks around the changed cells can differ, everything else is kept as it was
+static void GP_EvaluatePower(gameplay *Gameplay)
+{
+    if (GP_IsField(Gameplay))
+    {
+        // The field keeps its own journal of the changed cells
+        ZONE_BEGIN("Field_GetTraceTouched");
+        Field_GetTraceTouched(&Gameplay->Field, &Gameplay->FieldTrace);
+        ZONE_END();
+        Gameplay->PowerVersion = Gameplay->Field.Version;
+        return;
+    }
+
+    bitboard Touched = Board_TakeTouched(&Gameplay->Board);
+
+    if (Gameplay->Trace.Count > 0)
+    {
+        // A circuit was just cleared, others found with it may still be waiting anywhere
+        ZONE_BEGIN("Cache_GetTrace");
+        Cache_GetTrace(Gameplay->Cache, &Gameplay->Board, &Gameplay->Powers, &Gameplay->Trace);
+        ZONE_END();
+    }
+    else
+    {
+        bitboard Region = Board_Dilate(Touched);
+        Region = BB_Or(Region, Network_PowerCells(&Gameplay->Networks, &Gameplay->Board, Region));
+        ZONE_BEGIN("Board_GetTraceIn");
+        Board_GetTraceIn(&Gameplay->Board, &Gameplay->Powers, Region, &Gameplay->Trace);
+        ZONE_END();
+    }
+
+    Gameplay->PowerVersion = Gameplay->Board.Version;
+}
+
+static void GP_EvaluateJunk(gameplay *Gameplay)
+{
+    if (GP_IsField(Gameplay))
+    {
+        ZONE_BEGIN("Field_GetTraceJunk");
+        Field_GetTraceJunk(&Gameplay->Field, &Gameplay->FieldTraceJunk);
+        ZONE_END();
+    }
+    else if (!Cache_FindTraceJunk(Gameplay->Cache, &Gameplay->Board, &Gameplay->TraceJunk))
+    {
+        int i = Network_FirstDangling(&Gameplay->Networks, &Gameplay->Board);
+        ZONE_BEGIN("Board_TraceJunk");
+        if (i >= 0) Board_TraceJunk(&Gameplay->Board, i % BOARD_WIDTH, i / BOARD_WIDTH, &Gameplay->TraceJunk);
+        else Trace_Clear(&Gameplay->TraceJunk);
+        ZONE_END();
+        Cache_StoreTraceJunk(Gameplay->Cache, &Gameplay->Board, &Gameplay->TraceJunk);
+    }
+
+    Gameplay->JunkVersion = GP_Version(Gameplay);
+}
+
+// Takes the next brick of the queue and centres it on the board
+static brick GP_NextBrick(gameplay *Gameplay)
+{
+    brick Brick = Brick_QueueNext(&Gameplay->Queue);
+    Brick.x = GP_Width(Gameplay)/2 - 1;
+    return Brick;
+}
+
+static double GP_Clock(gameplay *Gameplay)
+{
+    return (Gameplay->Timing.Clock != NULL)? Gameplay->Timing.Clock() : 0.0;
+}
+
+static void GP_AddTime(gameplay *Gameplay, gp_phase Phase, double Start)
+{
+    if (Gameplay->Timing.Clock != NULL) Gameplay->Timing.Seconds[Phase] += Gameplay->Timing.Clock() - Start;
+}
+
+static unsigned int GP_Version(gameplay *Gameplay)
+{
+    return GP_IsField(Gameplay)? Gameplay->Field.Version : Gameplay->Board.Version;
+}
+
+static int GP_TraceCount(gameplay *Gameplay, bool Junk)
+{
+    if (GP_IsField(Gameplay)) return Junk? Gameplay->FieldTraceJunk.Count : Gameplay->FieldTrace.Count;
+    return Junk? Gameplay->TraceJunk.Count : Gameplay->Trace.Count;
+}
+
+static int GP_TraceCell(gameplay *Gameplay, bool Junk, int Index)
+{
+    if (GP_IsField(Gameplay)) return Junk? Gameplay->FieldTraceJunk.Cells[Index] : Gameplay->FieldTrace.Cells[Index];
+    return Junk? Gameplay->TraceJunk.Cells[Index] : Gameplay->Trace.Cells[Index];
+}
+
+static void GP_SetTile(gameplay *Gameplay, int x, int y, piece Piece)
+{
+    if (GP_IsField(Gameplay)) Field_SetTile(&Gameplay->Field, x, y, Piece);
+    else Board_SetTile(&Gameplay->Board, x, y, Piece);
+}
+
+static bool GP_ShouldPlaceBrick(gameplay *Gameplay, brick *Brick)
+{
+    return GP_IsField(Gameplay)? Field_ShouldPlaceBrick(&Gameplay->Field, Brick) : Board_ShouldPlaceBrick(&Gameplay->Board, Brick);
+}
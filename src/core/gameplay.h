@@ -0,0 +1,213 @@
+/*******************************************************************************************
+*
+*   Nettis core - gameplay rules
+*
+*   The simulation is stepped one tick at a time by GP_Update(). Input is injected by the
+*   caller as a set of GP_INPUT_* flags, every one of them applied in that tick, and all
+*   timers count ticks, so the rules run the same with or without a window, at any speed
+*   the caller wants.
+*
+*   On the standard board, everything a lock sets off is resolved the moment it locks and
+*   played back from a gp_cascade over the following ticks. Cascade.Outcome has the board
+*   the chain ends with long before the game gets there
+*
+********************************************************************************************/
+
+#ifndef NETTIS_GAMEPLAY_H
+#define NETTIS_GAMEPLAY_H
+
+#include "piece.h"
+#include "brick.h"
+#include "board.h"
+#include "trace.h"
+#include "network.h"
+#include "field.h"
+#include "cache.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define GP_TICKS_PER_SECOND 60
+
+// Converts a duration in seconds into simulation ticks
+#define GP_SECONDS_TO_TICKS(seconds) ((unsigned int)((seconds)*GP_TICKS_PER_SECOND + 0.5f))
+
+#define GP_GRAVITY_SECONDS 0.75f    // Falling brick steps down
+#define GP_TRACE_SECONDS 0.15f      // Circuit clears, or junk spreads, one piece
+
+#define GP_JUNK_PER_LOCK BOARD_WIDTH      // Most junk one lock drops, the rest waits for the next
+
+#define GP_CASCADE_EVENTS 512       // Longer chains are played as several timelines
+#define GP_CASCADE_POWERS 8
+#define GP_CASCADE_QUIETS 4         // Quiet ticks a brick can lock on without resolving again
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum {
+    GP_INPUT_DOWN   = 1<<0,
+    GP_INPUT_LEFT   = 1<<1,
+    GP_INPUT_RIGHT  = 1<<2,
+    GP_INPUT_ROTATE = 1<<3,
+} gp_input;
+
+typedef struct {
+    unsigned int Start;
+    unsigned int Duration;
+} timer;
+
+// Tunable rules of a game, GP_DefaultRules() gives the standard ones
+typedef struct {
+    unsigned int GravityTicks;
+    unsigned int TraceTicks;
+    const brick_table *Bricks;  // Not owned, has to outlive the game
+    int Width;                  // Board size, any other than BOARD_WIDTH x BOARD_HEIGHT is
+    int Height;                 // played on a field, up to FIELD_MAX_WIDTH x FIELD_MAX_HEIGHT
+} gp_rules;
+
+// Parts of GP_Update() that can be timed
+typedef enum {
+    GP_PHASE_POWER = 0,         // Circuit discovery
+    GP_PHASE_JUNK,              // Junk discovery
+    GP_PHASE_SETTLE,            // Gravity on the pieces left floating
+    GP_PHASE_COUNT
+} gp_phase;
+
+// Only measured when Clock is set, the caller reads and resets Seconds as it likes
+typedef struct {
+    double (*Clock)(void);      // Seconds from any fixed point
+    double Seconds[GP_PHASE_COUNT];
+} gp_timing;
+
+typedef struct {
+    int Score;
+    int NodeChain;
+    int WireChain;
+    int Multiplier;
+} scoring;
+
+// Everything clearing circuits and spreading junk reads and writes
+typedef struct {
+    power_board Powers;
+    unsigned int PowerVersion;
+    unsigned int JunkVersion;
+    board Board;
+    network_index Networks;
+    trace Trace;
+    trace TraceJunk;
+    timer TimerTrace;
+    int   TraceIndex;
+    timer TimerJunk;
+    int   TraceJunkIndex;
+    scoring Scoring;
+    board_falls Falls;
+} gp_resolution;
+
+typedef enum {
+    GP_EVENT_CLEAR = 0,         // Piece Value of a circuit removed from Cell
+    GP_EVENT_JUNK,              // Piece at Cell turned into junk
+    GP_EVENT_SET,               // Piece at Cell becomes Value, wires cut around a clear
+    GP_EVENT_SCORE,             // Score becomes Value
+    GP_EVENT_CHAIN,             // Node chain becomes Value>>16, wire chain Value&0xffff
+    GP_EVENT_POWER,             // Powers become the cascade Powers[Value]
+    GP_EVENT_QUIET,             // The brick moves on this tick, the events after it settle
+    GP_EVENT_FALL,              // Piece at Cell falls to cell Value
+    GP_EVENT_IDLE,              // GP_IsIdle() becomes Value
+} gp_event_kind;
+
+typedef struct {
+    unsigned short Tick;        // Ticks after the cascade Start
+    unsigned char Kind;
+    unsigned char Cell;         // BOARD_INDEX
+    int Value;
+} gp_event;
+
+// What a lock on a quiet tick needs on top of the board, Powers and score played back to it
+typedef struct {
+    unsigned int Tick;
+    bool PowerCurrent;          // Powers matched the board
+    bool JunkCurrent;           // TraceJunk matched the board
+    bitboard Touched;
+    trace Trace;
+    trace TraceJunk;
+    timer TimerTrace;
+    int   TraceIndex;
+    timer TimerJunk;
+    int   TraceJunkIndex;
+} gp_quiet;
+
+// The whole chain set off by a lock, resolved at once and played back tick by tick. Only
+// the board, Powers, Falls, the score and the chains follow the events; the rest of the
+// resolution state jumps from Origin to Final when the timeline ends. If the brick locks on
+// a quiet tick before that, it jumps to the state kept for that tick, or past the first
+// GP_CASCADE_QUIETS of them is resolved again from Origin
+typedef struct {
+    bool Active;
+    bool Idle;
+    unsigned int Start;         // Tick of the first event
+    unsigned int End;           // Tick Final is taken on, before it runs
+    int Cursor;                 // Next event to play
+    int Count;
+    gp_event Events[GP_CASCADE_EVENTS];
+    int PowerCount;
+    power_board Powers[GP_CASCADE_POWERS];
+    gp_resolution Origin;       // At the end of the tick before Start
+    gp_resolution Final;        // At the end of the tick before End
+    int QuietCount;
+    gp_quiet Quiets[GP_CASCADE_QUIETS];     // Right after the resolution of each quiet tick
+    board Outcome;              // Once everything is cleared, spread and settled, even past
+    int OutcomeScore;           // a timeline cut short
+} gp_cascade;
+
+typedef struct {
+    gp_rules Rules;
+    power_board Powers;         // Power reaching each wire, kept until the board changes
+    unsigned int PowerVersion;  // Board version Powers and Trace were evaluated for
+    unsigned int JunkVersion;   // Board version TraceJunk was evaluated for
+    board Board;
+    network_index Networks;
+    brick Brick;
+    brick_queue Queue;          // Upcoming bricks, from the seed given to GP_Init()
+    trace Trace;
+    trace TraceJunk;
+    timer TimerGravity;
+    timer TimerTrace;
+    int   TraceIndex;
+    timer TimerJunk;
+    int   TraceJunkIndex;
+    scoring Scoring;
+    board_falls Falls;          // Pieces moved by the last settle, for animation
+    unsigned int Tick;
+    int JunkPending;            // Sent by an opponent, dropped when the next brick locks
+    field Field;                // Used instead of Board, Trace and TraceJunk when the rules
+    field_trace FieldTrace;     // ask for a size other than the standard one
+    field_trace FieldTraceJunk;
+    gp_timing Timing;
+    trace_cache *Cache;         // Optional and not owned, set after GP_Init()
+    gp_cascade Cascade;         // Only on the standard board, fields resolve tick by tick
+} gameplay;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+timer Timer_Make(unsigned int Now, unsigned int Duration);
+bool Timer_IsExpired(timer *Timer, unsigned int Now);
+int Scoring_AddCleared(scoring *Scoring, piece Piece);     // Returns the points added
+
+gp_rules GP_DefaultRules(void);
+void GP_Init(gameplay *Gameplay, uint64_t Seed);      // The same seed replays the same bricks
+bool GP_InitRules(gameplay *Gameplay, uint64_t Seed, const gp_rules *Rules);     // False on a bad size or out of memory
+void GP_Free(gameplay *Gameplay);                            // Releases the field of a game that has one
+void GP_Update(gameplay *Gameplay, unsigned int Input);     // Advance the simulation by one tick
+bool GP_IsIdle(gameplay *Gameplay);                          // Nothing left to clear, spread or settle
+void GP_AddJunk(gameplay *Gameplay, int Count);              // Junk from an opponent, see JunkPending
+void GP_ResumeCascade(gameplay *Gameplay, unsigned int Start, bool Resolved);  // Resolved: Cascade already holds the chain
+
+bool GP_IsField(gameplay *Gameplay);
+int GP_Width(gameplay *Gameplay);
+int GP_Height(gameplay *Gameplay);
+piece GP_GetTile(gameplay *Gameplay, int x, int y);
+unsigned int GP_Checksum(gameplay *Gameplay);
+uint64_t GP_Hash(gameplay *Gameplay);                       // Board, brick, score and tick, cheap enough for every tick
+
+#endif // NETTIS_GAMEPLAY_H
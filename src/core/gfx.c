@@ -0,0 +1,194 @@
+/*******************************************************************************************
+*
+*   Nettis core - drawing
+*
+********************************************************************************************/
+
+#include "gfx.h"
+#include "zone.h"
+
+#include <stdio.h>
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static void GFX_Rect(gfx *Gfx, int x, int y, int Width, int Height, gfx_color Color);
+static void GFX_Line(gfx *Gfx, float x0, float y0, float x1, float y1, float Thickness, gfx_color Color);
+static void GFX_Text(gfx *Gfx, const char *Text, int x, int y, int Size, gfx_color Color);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+// One pixel wide, inside the rectangle
+void GFX_DrawRectLines(gfx *Gfx, int x, int y, int Width, int Height, gfx_color Color)
+{
+    GFX_Rect(Gfx, x, y, Width, 1, Color);
+    GFX_Rect(Gfx, x, y + Height - 1, Width, 1, Color);
+    GFX_Rect(Gfx, x, y + 1, 1, Height - 2, Color);
+    GFX_Rect(Gfx, x + Width - 1, y + 1, 1, Height - 2, Color);
+}
+
+void GFX_DrawCellLines(gfx *Gfx, unsigned int Parts, gfx_color Color, int x, int y, int Thickness)
+{
+    const int sz = GFX_CELL_SIZE-1;
+    const int Half = GFX_CELL_SIZE/2;
+    const float offs = Thickness / 2.0f;
+
+    if (Parts & 1<<RIGHT) GFX_Line(Gfx, x*sz+Half-offs, y*sz+Half, x*sz+GFX_CELL_SIZE, y*sz+Half, Thickness, Color);
+    if (Parts & 1<<LEFT)  GFX_Line(Gfx, x*sz, y*sz+Half, x*sz+Half+offs, y*sz+Half, Thickness, Color);
+    if (Parts & 1<<DOWN)  GFX_Line(Gfx, x*sz+Half, y*sz+Half-offs, x*sz+Half, y*sz+GFX_CELL_SIZE, Thickness, Color);
+    if (Parts & 1<<UP)    GFX_Line(Gfx, x*sz+Half, y*sz, x*sz+Half, y*sz+Half+offs, Thickness, Color);
+}
+
+void GFX_DrawPiece(gfx *Gfx, piece Piece, int x, int y)
+{
+    const gfx_color PIECE_PALLETE[PIECE_PALLETE_SIZE] = {
+        GFX_BLACK,
+        GFX_WHITE,
+        GFX_WHITE,
+        GFX_WHITE,
+        GFX_WHITE,
+        GFX_WHITE,
+        GFX_WHITE,
+        GFX_BLUE,
+        GFX_DARKGRAY,
+        GFX_ORANGE
+    };
+
+    int parts = Piece_OutgoingOrientations(Piece);
+    const int sz = GFX_CELL_SIZE-1;
+
+    if (Piece_IsConnectionType(Piece)) {
+        GFX_DrawCellLines(Gfx, parts, PIECE_PALLETE[Piece], x, y, 1);
+    }
+
+    switch (Piece)
+    {
+        case PIECE_DST:
+        case PIECE_JUNK:
+        case PIECE_FIRE:
+            GFX_Rect(Gfx, x*sz, y*sz, GFX_CELL_SIZE-1, GFX_CELL_SIZE-1, PIECE_PALLETE[Piece]);
+            break;
+        default:
+            break;
+    }
+
+    switch (Piece)
+    {
+        case PIECE_DST:
+            GFX_Rect(Gfx, x*sz+1, y*sz+1, GFX_CELL_SIZE-3, GFX_CELL_SIZE-3, GFX_BLACK);
+            GFX_Rect(Gfx, x*sz+2, y*sz+2, GFX_CELL_SIZE-5, GFX_CELL_SIZE-5, GFX_BLUE);
+            break;
+        case PIECE_JUNK:
+            GFX_Rect(Gfx, x*sz+1, y*sz+1, GFX_CELL_SIZE-3, GFX_CELL_SIZE-3, GFX_DARKGRAY);
+            break;
+        case PIECE_FIRE:
+            GFX_Rect(Gfx, x*sz+1, y*sz+1, GFX_CELL_SIZE-3, GFX_CELL_SIZE-3, GFX_BLACK);
+            GFX_Rect(Gfx, x*sz+2, y*sz+2, GFX_CELL_SIZE-5, GFX_CELL_SIZE-5, GFX_WHITE);
+        default:
+            break;
+    }
+}
+
+void GFX_DrawCell(gfx *Gfx, piece Piece, bool Powered, int x, int y)
+{
+    const int sz = GFX_CELL_SIZE-1;
+
+    if (Powered && Piece_IsConnectionType(Piece))
+    {
+        GFX_DrawCellLines(Gfx, Piece_OutgoingOrientations(Piece), GFX_BLUE, x, y, 3);
+    }
+    GFX_DrawRectLines(Gfx, x*sz, y*sz, sz, sz, GFX_DARKGRAY);
+    GFX_DrawPiece(Gfx, Piece, x, y);
+}
+
+// Draws every cell, the falling brick on top and the outline
+void GFX_DrawBoard(gfx *Gfx, power_board *Powers, board *Board, brick *Brick)
+{
+    ZONE_BEGIN("GFX_DrawBoard");
+    const int sz = GFX_CELL_SIZE-1;
+
+    for (int y = 0; y < BOARD_HEIGHT; y++)
+    {
+        for (int x = 0; x < BOARD_WIDTH; x++)
+        {
+            GFX_DrawCell(Gfx, Board_GetTile(Board, x, y), Powers->Incoming[y][x] != 0, x, y);
+        }
+    }
+
+    int px[2], py[2];
+    Brick_Locations(Brick, px, py);
+    for (int i = 0; i < 2; i++)
+    {
+        if (!Board_IsOob(Board, px[i], py[i])) GFX_DrawPiece(Gfx, Brick->Pieces[i], px[i], py[i]);
+    }
+
+    GFX_DrawRectLines(Gfx, -1, -1, sz*BOARD_WIDTH+2, sz*BOARD_HEIGHT+2, GFX_GRAY);
+    ZONE_END();
+}
+
+void GFX_DrawNextBrick(gfx *Gfx, brick *Brick, int x, int y)
+{
+    brick Preview = *Brick;
+    Preview.x = x;
+    Preview.y = y;
+
+    int px[2], py[2];
+    Brick_Locations(&Preview, px, py);
+    GFX_DrawPiece(Gfx, Preview.Pieces[0], px[0], py[0]);
+    GFX_DrawPiece(Gfx, Preview.Pieces[1], px[1], py[1]);
+}
+
+void GFX_DrawHud(gfx *Gfx, gameplay *Gameplay)
+{
+    ZONE_BEGIN("GFX_DrawHud");
+    char Score[32];
+    snprintf(Score, sizeof(Score), "Score: %i", Gameplay->Scoring.Score);
+
+    GFX_Text(Gfx, Score, 90, 10, 10, GFX_WHITE);
+    GFX_DrawNextBrick(Gfx, Brick_QueuePeek(&Gameplay->Queue, 0), 6, 2);
+    GFX_DrawPiece(Gfx, PIECE_DST, 6, 4);
+    GFX_Text(Gfx, "Nodes", 110, 62, 10, GFX_DARKGRAY);
+    GFX_DrawPiece(Gfx, PIECE_HCONN, 6, 6);
+    GFX_Text(Gfx, "Connections", 110, 62+30, 10, GFX_DARKGRAY);
+    GFX_DrawPiece(Gfx, PIECE_FIRE, 6, 8);
+    GFX_Text(Gfx, "Fire", 110, 62+30+30, 10, GFX_DARKGRAY);
+    GFX_DrawPiece(Gfx, PIECE_JUNK, 6, 10);
+    GFX_Text(Gfx, "Junk", 110, 62+30+30+30, 10, GFX_DARKGRAY);
+    ZONE_END();
+}
+
+void GFX_DrawGame(gfx *Gfx, gameplay *Gameplay)
+{
+    ZONE_BEGIN("GFX_DrawGame");
+    gfx Board = *Gfx;
+    Board.x += GFX_BOARD_X;
+    Board.y += GFX_BOARD_Y;
+
+    gfx Hud = *Gfx;
+    Hud.x += GFX_HUD_X;
+    Hud.y += GFX_HUD_Y;
+
+    Gfx->Backend->Clear(Gfx->User, GFX_BLACK);
+    GFX_DrawBoard(&Board, &Gameplay->Powers, &Gameplay->Board, &Gameplay->Brick);
+    GFX_DrawHud(&Hud, Gameplay);
+    ZONE_END();
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static void GFX_Rect(gfx *Gfx, int x, int y, int Width, int Height, gfx_color Color)
+{
+    Gfx->Backend->Rect(Gfx->User, Gfx->x + x, Gfx->y + y, Width, Height, Color);
+}
+
+static void GFX_Line(gfx *Gfx, float x0, float y0, float x1, float y1, float Thickness, gfx_color Color)
+{
+    Gfx->Backend->Line(Gfx->User, Gfx->x + x0, Gfx->y + y0, Gfx->x + x1, Gfx->y + y1, Thickness, Color);
+}
+
+static void GFX_Text(gfx *Gfx, const char *Text, int x, int y, int Size, gfx_color Color)
+{
+    Gfx->Backend->Text(Gfx->User, Text, Gfx->x + x, Gfx->y + y, Size, Color);
+}
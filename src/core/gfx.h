@@ -0,0 +1,85 @@
+/*******************************************************************************************
+*
+*   Nettis core - drawing
+*
+*   Pieces, boards and the HUD are drawn through a gfx_backend that only has to fill
+*   rectangles, draw thick lines and print text. The game implements it over raylib. The
+*   software backend (GFX_Soft) rasterizes into an RGBA framebuffer in memory, with no window
+*   and no GPU, so frames can be rendered headless for golden images and video export.
+*
+*   Coordinates are in logical pixels, the 224x256 screen the game scales up 3 times.
+*   GFX_DrawGame() lays a whole frame out on that screen for the standard board, boards sized
+*   at runtime are only drawn by the game
+*
+********************************************************************************************/
+
+#ifndef NETTIS_GFX_H
+#define NETTIS_GFX_H
+
+#include "gameplay.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define GFX_SCREEN_WIDTH 224
+#define GFX_SCREEN_HEIGHT 256
+#define GFX_CELL_SIZE 16                // Cells are CELL_SIZE-1 apart, neighbours share their border
+
+#define GFX_BOARD_X 33                  // Where GFX_DrawGame() puts the board and the HUD
+#define GFX_BOARD_Y 33
+#define GFX_HUD_X 40
+#define GFX_HUD_Y 33
+
+// Same values as the raylib colors of the same name
+#define GFX_BLANK    (gfx_color){ 0, 0, 0, 0 }
+#define GFX_BLACK    (gfx_color){ 0, 0, 0, 255 }
+#define GFX_WHITE    (gfx_color){ 255, 255, 255, 255 }
+#define GFX_GRAY     (gfx_color){ 130, 130, 130, 255 }
+#define GFX_DARKGRAY (gfx_color){ 80, 80, 80, 255 }
+#define GFX_BLUE     (gfx_color){ 0, 121, 241, 255 }
+#define GFX_ORANGE   (gfx_color){ 255, 161, 0, 255 }
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    unsigned char r, g, b, a;
+} gfx_color;
+
+typedef struct {
+    void (*Clear)(void *User, gfx_color Color);
+    void (*Rect)(void *User, int x, int y, int Width, int Height, gfx_color Color);
+    void (*Line)(void *User, float x0, float y0, float x1, float y1, float Thickness, gfx_color Color);
+    void (*Text)(void *User, const char *Text, int x, int y, int Size, gfx_color Color);
+} gfx_backend;
+
+typedef struct {
+    const gfx_backend *Backend;
+    void *User;                     // Given back to every backend call
+    int x, y;                       // Origin, added to every coordinate
+} gfx;
+
+// Target of the software backend
+typedef struct {
+    int Width;
+    int Height;
+    uint32_t *Pixels;               // RGBA bytes in memory order, row after row
+} gfx_framebuffer;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void GFX_DrawRectLines(gfx *Gfx, int x, int y, int Width, int Height, gfx_color Color);
+void GFX_DrawCellLines(gfx *Gfx, unsigned int Parts, gfx_color Color, int x, int y, int Thickness);
+void GFX_DrawPiece(gfx *Gfx, piece Piece, int x, int y);
+void GFX_DrawCell(gfx *Gfx, piece Piece, bool Powered, int x, int y);     // Grid square, power and piece
+void GFX_DrawBoard(gfx *Gfx, power_board *Powers, board *Board, brick *Brick);
+void GFX_DrawNextBrick(gfx *Gfx, brick *Brick, int x, int y);
+void GFX_DrawHud(gfx *Gfx, gameplay *Gameplay);
+void GFX_DrawGame(gfx *Gfx, gameplay *Gameplay);                           // The whole screen
+
+bool GFX_SoftInit(gfx_framebuffer *Framebuffer, int Width, int Height);
+void GFX_SoftFree(gfx_framebuffer *Framebuffer);
+gfx GFX_Soft(gfx_framebuffer *Framebuffer);                                 // Draws into the framebuffer
+
+#endif // NETTIS_GFX_H
@@ -0,0 +1,307 @@
+/*******************************************************************************************
+*
+*   Nettis core - software rasterizer
+*
+*   A gfx_backend drawing into a gfx_framebuffer. Shapes cover the pixels whose centers they
+*   contain, the same rule GPUs follow, so frames look like the game's. Text uses a built-in
+*   5x7 font, scaled by whole steps of 10 pixels like raylib's default font
+*
+********************************************************************************************/
+
+#include "gfx.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define SOFT_GLYPH_WIDTH 5
+#define SOFT_GLYPH_HEIGHT 7
+#define SOFT_FONT_FIRST ' '
+#define SOFT_FONT_LAST '~'
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+// One byte per row, bit 4 is the leftmost column
+static const unsigned char SOFT_FONT[SOFT_FONT_LAST - SOFT_FONT_FIRST + 1][SOFT_GLYPH_HEIGHT] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },   // ' '
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },   // '!'
+    { 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 },   // '"'
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A },   // '#'
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 },   // '$'
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },   // '%'
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D },   // '&'
+    { 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 },   // '''
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },   // '('
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },   // ')'
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 },   // '*'
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 },   // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 },   // ','
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },   // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },   // '.'
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },   // '/'
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },   // '0'
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },   // '1'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },   // '2'
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },   // '3'
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },   // '4'
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },   // '5'
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },   // '6'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },   // '7'
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },   // '8'
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },   // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },   // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 },   // ';'
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 },   // '<'
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 },   // '='
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 },   // '>'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },   // '?'
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E },   // '@'
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // 'A'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },   // 'B'
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },   // 'C'
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },   // 'D'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },   // 'E'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },   // 'F'
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },   // 'G'
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },   // 'H'
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },   // 'I'
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },   // 'J'
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },   // 'K'
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },   // 'L'
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },   // 'M'
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },   // 'N'
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // 'O'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },   // 'P'
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },   // 'Q'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },   // 'R'
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },   // 'S'
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },   // 'T'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },   // 'U'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },   // 'V'
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },   // 'W'
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },   // 'X'
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },   // 'Y'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },   // 'Z'
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E },   // '['
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },   // backslash
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E },   // ']'
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 },   // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F },   // '_'
+    { 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00 },   // '`'
+    { 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F },   // 'a'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E },   // 'b'
+    { 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E },   // 'c'
+    { 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F },   // 'd'
+    { 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E },   // 'e'
+    { 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08 },   // 'f'
+    { 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E },   // 'g'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11 },   // 'h'
+    { 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E },   // 'i'
+    { 0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C },   // 'j'
+    { 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12 },   // 'k'
+    { 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },   // 'l'
+    { 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11 },   // 'm'
+    { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11 },   // 'n'
+    { 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E },   // 'o'
+    { 0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10 },   // 'p'
+    { 0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01 },   // 'q'
+    { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10 },   // 'r'
+    { 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E },   // 's'
+    { 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06 },   // 't'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D },   // 'u'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04 },   // 'v'
+    { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A },   // 'w'
+    { 0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11 },   // 'x'
+    { 0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E },   // 'y'
+    { 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F },   // 'z'
+    { 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02 },   // '{'
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },   // '|'
+    { 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08 },   // '}'
+    { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00 },   // '~'
+};
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static void Soft_Clear(void *User, gfx_color Color);
+static void Soft_Rect(void *User, int x, int y, int Width, int Height, gfx_color Color);
+static void Soft_Line(void *User, float x0, float y0, float x1, float y1, float Thickness, gfx_color Color);
+static void Soft_Text(void *User, const char *Text, int x, int y, int Size, gfx_color Color);
+static void Soft_Fill(gfx_framebuffer *Framebuffer, int x0, int y0, int x1, int y1, gfx_color Color);
+static uint32_t Soft_Pack(gfx_color Color);
+static uint32_t Soft_Blend(uint32_t Pixel, gfx_color Color);
+
+static const gfx_backend SOFT_BACKEND = { Soft_Clear, Soft_Rect, Soft_Line, Soft_Text };
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool GFX_SoftInit(gfx_framebuffer *Framebuffer, int Width, int Height)
+{
+    *Framebuffer = (gfx_framebuffer){ 0 };
+    if (Width <= 0 || Height <= 0) return false;
+
+    Framebuffer->Pixels = calloc((size_t)Width*Height, sizeof(uint32_t));
+    if (Framebuffer->Pixels == NULL) return false;
+
+    Framebuffer->Width = Width;
+    Framebuffer->Height = Height;
+    return true;
+}
+
+void GFX_SoftFree(gfx_framebuffer *Framebuffer)
+{
+    free(Framebuffer->Pixels);
+    *Framebuffer = (gfx_framebuffer){ 0 };
+}
+
+gfx GFX_Soft(gfx_framebuffer *Framebuffer)
+{
+    return (gfx){ &SOFT_BACKEND, Framebuffer, 0, 0 };
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static void Soft_Clear(void *User, gfx_color Color)
+{
+    gfx_framebuffer *Framebuffer = User;
+    uint32_t Packed = Soft_Pack(Color);
+    size_t Count = (size_t)Framebuffer->Width*Framebuffer->Height;
+
+    for (size_t i = 0; i < Count; i++) Framebuffer->Pixels[i] = Packed;
+}
+
+static void Soft_Rect(void *User, int x, int y, int Width, int Height, gfx_color Color)
+{
+    Soft_Fill(User, x, y, x + Width, y + Height, Color);
+}
+
+// A line is the rectangle of its thickness around the segment, like the quad DrawLineEx() emits
+static void Soft_Line(void *User, float x0, float y0, float x1, float y1, float Thickness, gfx_color Color)
+{
+    gfx_framebuffer *Framebuffer = User;
+    float Half = Thickness/2.0f;
+
+    // Every line the game draws is horizontal or vertical, those are plain rectangles
+    if (y0 == y1 || x0 == x1)
+    {
+        float Left = fminf(x0, x1), Right = fmaxf(x0, x1);
+        float Top = fminf(y0, y1), Bottom = fmaxf(y0, y1);
+        if (y0 == y1) { Top -= Half; Bottom += Half; }
+        else { Left -= Half; Right += Half; }
+
+        Soft_Fill(Framebuffer, (int)ceilf(Left - 0.5f), (int)ceilf(Top - 0.5f), (int)ceilf(Right - 0.5f), (int)ceilf(Bottom - 0.5f), Color);
+        return;
+    }
+
+    float dx = x1 - x0, dy = y1 - y0;
+    float Length = sqrtf(dx*dx + dy*dy);
+    dx /= Length;
+    dy /= Length;
+
+    int Left = (int)floorf(fminf(x0, x1) - Half), Right = (int)ceilf(fmaxf(x0, x1) + Half);
+    int Top = (int)floorf(fminf(y0, y1) - Half), Bottom = (int)ceilf(fmaxf(y0, y1) + Half);
+    if (Left < 0) Left = 0;
+    if (Top < 0) Top = 0;
+    if (Right > Framebuffer->Width) Right = Framebuffer->Width;
+    if (Bottom > Framebuffer->Height) Bottom = Framebuffer->Height;
+
+    for (int y = Top; y < Bottom; y++)
+    {
+        for (int x = Left; x < Right; x++)
+        {
+            float px = x + 0.5f - x0, py = y + 0.5f - y0;
+            float Along = px*dx + py*dy;
+            float Across = px*dy - py*dx;
+            if (Along < 0.0f || Along >= Length || fabsf(Across) > Half) continue;
+
+            uint32_t *Pixel = &Framebuffer->Pixels[(size_t)y*Framebuffer->Width + x];
+            *Pixel = Soft_Blend(*Pixel, Color);
+        }
+    }
+}
+
+static void Soft_Text(void *User, const char *Text, int x, int y, int Size, gfx_color Color)
+{
+    int Scale = (Size < 10)? 1 : Size/10;
+    int Left = x;
+
+    for (; *Text != '\0'; Text++)
+    {
+        unsigned char c = (unsigned char)*Text;
+        if (c == '\n')
+        {
+            x = Left;
+            y += Size + Size/2;
+            continue;
+        }
+
+        if (c >= SOFT_FONT_FIRST && c <= SOFT_FONT_LAST)
+        {
+            const unsigned char *Glyph = SOFT_FONT[c - SOFT_FONT_FIRST];
+            for (int Row = 0; Row < SOFT_GLYPH_HEIGHT; Row++)
+            {
+                for (int Column = 0; Column < SOFT_GLYPH_WIDTH; Column++)
+                {
+                    if ((Glyph[Row] & (1 << (SOFT_GLYPH_WIDTH - 1 - Column))) == 0) continue;
+
+                    int px = x + Column*Scale, py = y + (Row + 1)*Scale;
+                    Soft_Fill(User, px, py, px + Scale, py + Scale, Color);
+                }
+            }
+        }
+        x += (SOFT_GLYPH_WIDTH + 1)*Scale;
+    }
+}
+
+// Fills [x0, x1) x [y0, y1), clipped to the framebuffer
+static void Soft_Fill(gfx_framebuffer *Framebuffer, int x0, int y0, int x1, int y1, gfx_color Color)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > Framebuffer->Width) x1 = Framebuffer->Width;
+    if (y1 > Framebuffer->Height) y1 = Framebuffer->Height;
+    if (x0 >= x1 || y0 >= y1 || Color.a == 0) return;
+
+    uint32_t Packed = Soft_Pack(Color);
+    for (int y = y0; y < y1; y++)
+    {
+        uint32_t *Row = &Framebuffer->Pixels[(size_t)y*Framebuffer->Width];
+        if (Color.a == 255)
+        {
+            for (int x = x0; x < x1; x++) Row[x] = Packed;
+        }
+        else
+        {
+            for (int x = x0; x < x1; x++) Row[x] = Soft_Blend(Row[x], Color);
+        }
+    }
+}
+
+static uint32_t Soft_Pack(gfx_color Color)
+{
+    uint32_t Packed;
+    memcpy(&Packed, &Color, sizeof(Packed));
+    return Packed;
+}
+
+// Source over, the blending raylib uses by default
+static uint32_t Soft_Blend(uint32_t Pixel, gfx_color Color)
+{
+    if (Color.a == 255) return Soft_Pack(Color);
+
+    gfx_color Dst;
+    memcpy(&Dst, &Pixel, sizeof(Dst));
+
+    int a = Color.a;
+    Dst.r = (unsigned char)((Color.r*a + Dst.r*(255 - a))/255);
+    Dst.g = (unsigned char)((Color.g*a + Dst.g*(255 - a))/255);
+    Dst.b = (unsigned char)((Color.b*a + Dst.b*(255 - a))/255);
+    Dst.a = (unsigned char)(a + Dst.a*(255 - a)/255);
+    return Soft_Pack(Dst);
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************************
+*
+*   Nettis core - timestamped input
+*
+********************************************************************************************/
+
+#include "input.h"
+#include "gameplay.h"
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Input_Push(input_queue *Queue, unsigned int Flag, bool Down, double Time);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+input_config Input_DefaultConfig(void)
+{
+    input_config Config;
+    Config.Das = INPUT_DAS_SECONDS;
+    Config.Arr = INPUT_ARR_SECONDS;
+    Config.Repeats = GP_INPUT_DOWN | GP_INPUT_LEFT | GP_INPUT_RIGHT;
+    return Config;
+}
+
+void Input_Init(input_queue *Queue, const input_config *Config)
+{
+    *Queue = (input_queue){ 0 };
+    Queue->Config = *Config;
+}
+
+bool Input_Press(input_queue *Queue, unsigned int Flag, double Time)
+{
+    if (!Input_Push(Queue, Flag, true, Time)) return false;
+
+    Queue->Pressed |= Flag;
+    return true;
+}
+
+// Stays pressed when the queue is full, so calling it again on the next poll tries again
+bool Input_Release(input_queue *Queue, unsigned int Flag, double Time)
+{
+    if ((Queue->Pressed & Flag) == 0) return true;
+    if (!Input_Push(Queue, Flag, false, Time)) return false;
+
+    Queue->Pressed &= ~Flag;
+    return true;
+}
+
+// Goes through the queued events and the repeats of held keys in time order, up to Until or
+// to the first action Input already has, and adds them to Input
+unsigned int Input_Take(input_queue *Queue, double Until, unsigned int Input)
+{
+    for (;;)
+    {
+        int Repeat = -1;
+        double RepeatTime = Until;
+        for (int Action = 0; Action < INPUT_ACTIONS; Action++)
+        {
+            unsigned int Flag = 1u << Action;
+            if ((Queue->Held & Queue->Config.Repeats & Flag) && Queue->NextRepeat[Action] < RepeatTime)
+            {
+                Repeat = Action;
+                RepeatTime = Queue->NextRepeat[Action];
+            }
+        }
+
+        input_event *Event = &Queue->Events[Queue->Head];
+        if (Queue->Count > 0 && Event->Time < Until && Event->Time <= RepeatTime)
+        {
+            unsigned int Flag = 1u << Event->Action;
+            if (Event->Down)
+            {
+                if (Input & Flag) break;
+
+                Input |= Flag;
+                Queue->Held |= Flag;
+                Queue->NextRepeat[Event->Action] = Event->Time + Queue->Config.Das;
+            }
+            else
+            {
+                Queue->Held &= ~Flag;
+            }
+
+            Queue->Head = (Queue->Head + 1) % INPUT_QUEUE_SIZE;
+            Queue->Count--;
+        }
+        else if (Repeat >= 0)
+        {
+            unsigned int Flag = 1u << Repeat;
+            if (Input & Flag) break;
+
+            // Repeats falling behind the ticks are not made up for, one tick takes one
+            Input |= Flag;
+            Queue->NextRepeat[Repeat] += Queue->Config.Arr;
+            if (Queue->NextRepeat[Repeat] < Until) Queue->NextRepeat[Repeat] = Until;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return Input;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static bool Input_Push(input_queue *Queue, unsigned int Flag, bool Down, double Time)
+{
+    int Action = 0;
+    while (Action < INPUT_ACTIONS && Flag != (1u << Action)) Action++;
+    if (Action == INPUT_ACTIONS || Queue->Count == INPUT_QUEUE_SIZE) return false;
+
+    // Events go in the order they come, one seen earlier than the last is not reordered
+    input_event *Event = &Queue->Events[(Queue->Head + Queue->Count) % INPUT_QUEUE_SIZE];
+    Event->Time = Time;
+    Event->Action = (unsigned char)Action;
+    Event->Down = Down;
+    Queue->Count++;
+    return true;
+}
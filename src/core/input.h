@@ -0,0 +1,65 @@
+/*******************************************************************************************
+*
+*   Nettis core - timestamped input
+*
+*   Key presses and releases are queued with the time they were seen, in seconds on any
+*   clock, and handed to the ticks they fall in as GP_INPUT_* flags. Every press reaches
+*   the game: when a tick already has an action, the next one of the same kind waits for the
+*   following tick, and everything queued after it waits too so the order is kept.
+*
+*   A held key repeats on its own, after Das and then every Arr, at the times those fall on
+*   rather than whenever frames or the system key repeat come. An Arr under a tick repeats
+*   every tick
+*
+********************************************************************************************/
+
+#ifndef NETTIS_INPUT_H
+#define NETTIS_INPUT_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define INPUT_QUEUE_SIZE 64
+#define INPUT_ACTIONS 4                 // One per GP_INPUT_* flag
+
+#define INPUT_DAS_SECONDS (10.0/60)     // Delayed auto shift, 10 ticks
+#define INPUT_ARR_SECONDS (2.0/60)      // Auto repeat rate, 2 ticks
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    double Das;                     // Hold time before a key starts repeating
+    double Arr;                     // Time between repeats
+    unsigned int Repeats;           // GP_INPUT_* flags that repeat while held
+} input_config;
+
+typedef struct {
+    double Time;
+    unsigned char Action;           // Index of the GP_INPUT_* flag
+    bool Down;
+} input_event;
+
+typedef struct {
+    input_config Config;
+    input_event Events[INPUT_QUEUE_SIZE];   // Ring buffer in time order
+    int Head;
+    int Count;
+    unsigned int Held;              // GP_INPUT_* flags down as of the last event taken
+    unsigned int Pressed;           // Down as of the last event queued
+    double NextRepeat[INPUT_ACTIONS];
+} input_queue;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+input_config Input_DefaultConfig(void);
+void Input_Init(input_queue *Queue, const input_config *Config);
+
+bool Input_Press(input_queue *Queue, unsigned int Flag, double Time);      // False when the queue is full
+bool Input_Release(input_queue *Queue, unsigned int Flag, double Time);    // Ignored for a key not pressed
+unsigned int Input_Take(input_queue *Queue, double Until, unsigned int Input);  // Input plus the actions due before Until
+
+#endif // NETTIS_INPUT_H
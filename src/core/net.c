@@ -0,0 +1,112 @@
+/*******************************************************************************************
+*
+*   Nettis core - datagram sockets on the local machine
+*
+********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // Sockets under -std=c99
+#endif
+
+#include "net.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    typedef int net_length;
+    #define NET_HANDLE(Socket) ((SOCKET)(Socket)->Handle)
+#else
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+    typedef socklen_t net_length;
+    #define NET_HANDLE(Socket) ((int)(Socket)->Handle)
+#endif
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static struct sockaddr_in Net_Loopback(int Port)
+{
+    struct sockaddr_in Address;
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_port = htons((unsigned short)Port);
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return Address;
+}
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool Net_Open(net_socket *Socket, int Port)
+{
+    Socket->Handle = -1;
+    Socket->Port = 0;
+
+#if defined(_WIN32)
+    WSADATA Data;
+    if (WSAStartup(MAKEWORD(2, 2), &Data) != 0) return false;
+
+    SOCKET Handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (Handle == INVALID_SOCKET)
+    {
+        WSACleanup();
+        return false;
+    }
+    u_long NonBlocking = 1;
+    ioctlsocket(Handle, FIONBIO, &NonBlocking);
+#else
+    int Handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (Handle < 0) return false;
+    fcntl(Handle, F_SETFL, fcntl(Handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    Socket->Handle = (intptr_t)Handle;
+
+    struct sockaddr_in Address = Net_Loopback(Port);
+    net_length Length = sizeof(Address);
+    if (bind(Handle, (struct sockaddr *)&Address, sizeof(Address)) != 0 ||
+        getsockname(Handle, (struct sockaddr *)&Address, &Length) != 0)
+    {
+        Net_Close(Socket);
+        return false;
+    }
+
+    Socket->Port = ntohs(Address.sin_port);
+    return true;
+}
+
+void Net_Close(net_socket *Socket)
+{
+    if (Socket->Handle < 0) return;
+
+#if defined(_WIN32)
+    closesocket(NET_HANDLE(Socket));
+    WSACleanup();
+#else
+    close(NET_HANDLE(Socket));
+#endif
+    Socket->Handle = -1;
+}
+
+bool Net_Send(net_socket *Socket, int Port, const void *Data, int Size)
+{
+    struct sockaddr_in Address = Net_Loopback(Port);
+    return sendto(NET_HANDLE(Socket), (const char *)Data, Size, 0, (struct sockaddr *)&Address, sizeof(Address)) == Size;
+}
+
+int Net_Receive(net_socket *Socket, void *Data, int Capacity, int *FromPort)
+{
+    struct sockaddr_in Address;
+    net_length Length = sizeof(Address);
+    int Size = (int)recvfrom(NET_HANDLE(Socket), (char *)Data, Capacity, 0, (struct sockaddr *)&Address, &Length);
+    if (Size <= 0) return 0;
+
+    if (FromPort != NULL) *FromPort = ntohs(Address.sin_port);
+    return Size;
+}
@@ -0,0 +1,34 @@
+/*******************************************************************************************
+*
+*   Nettis core - datagram sockets on the local machine
+*
+*   Just enough UDP for two games on one machine to talk, or to talk through a proxy: a
+*   socket is bound to a port on 127.0.0.1 and sends to other ports there. Sockets never
+*   block, a receive with nothing waiting returns at once
+*
+********************************************************************************************/
+
+#ifndef NETTIS_NET_H
+#define NETTIS_NET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    intptr_t Handle;                // -1 when closed
+    int Port;
+} net_socket;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Net_Open(net_socket *Socket, int Port);        // Port 0 takes any free one, false if it cannot bind
+void Net_Close(net_socket *Socket);
+bool Net_Send(net_socket *Socket, int Port, const void *Data, int Size);
+int Net_Receive(net_socket *Socket, void *Data, int Capacity, int *FromPort);     // Bytes read, 0 when nothing waits
+
+#endif // NETTIS_NET_H
@@ -0,0 +1,374 @@
+/*******************************************************************************************
+*
+*   Nettis core - wire network index
+*
+********************************************************************************************/
+
+#include "network.h"
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static int Network_Find(unsigned char *Parent, int i);
+static bool Network_Links(piece Piece, piece OtherPiece, orientation Orientation);
+static void Network_MakeCell(network_index *Index, board *Board, int x, int y, bool CountOpen);
+static void Network_JoinWires(network_index *Index, int a, int b);
+static void Network_JoinPower(network_index *Index, int a, int b);
+static void Network_Sync(network_index *Index, board *Board);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+void Network_Rebuild(network_index *Index, board *Board)
+{
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        Index->WireParent[i] = NETWORK_NONE;
+        Index->PowerParent[i] = NETWORK_NONE;
+    }
+
+    for (int y = 0; y < BOARD_HEIGHT; y++)
+    {
+        for (int x = 0; x < BOARD_WIDTH; x++)
+        {
+            if (Board_IsOccupied(Board, x, y)) Network_MakeCell(Index, Board, x, y, true);
+        }
+    }
+
+    // Every link is seen once, from its left or upper end
+    for (int y = 0; y < BOARD_HEIGHT; y++)
+    {
+        for (int x = 0; x < BOARD_WIDTH; x++)
+        {
+            piece Piece = Board_GetTile(Board, x, y);
+            int i = BOARD_INDEX(x, y);
+
+            if (x + 1 < BOARD_WIDTH && Network_Links(Piece, Board_GetTile(Board, x + 1, y), RIGHT))
+            {
+                if (Index->WireParent[i] != NETWORK_NONE && Index->WireParent[i + 1] != NETWORK_NONE) Network_JoinWires(Index, i, i + 1);
+                Network_JoinPower(Index, i, i + 1);
+            }
+
+            if (y + 1 < BOARD_HEIGHT && Network_Links(Piece, Board_GetTile(Board, x, y + 1), DOWN))
+            {
+                if (Index->WireParent[i] != NETWORK_NONE && Index->WireParent[i + BOARD_WIDTH] != NETWORK_NONE) Network_JoinWires(Index, i, i + BOARD_WIDTH);
+                Network_JoinPower(Index, i, i + BOARD_WIDTH);
+            }
+        }
+    }
+
+    Index->Valid = true;
+    Index->Version = Board->Version;
+}
+
+// Merges a freshly placed piece into the networks around it. Only applies when placing it
+// was the one change since the index was last in sync, otherwise the next query rebuilds
+void Network_Add(network_index *Index, board *Board, int x, int y)
+{
+    if (!Index->Valid || Index->Version + 1 != Board->Version)
+    {
+        return;
+    }
+
+    Index->Version = Board->Version;
+
+    int i = BOARD_INDEX(x, y);
+    piece Piece = Board_GetTile(Board, x, y);
+    Network_MakeCell(Index, Board, x, y, false);
+
+    struct {
+        int x, y;
+        orientation Orientation;
+    } Positions[4] = {
+        { x-1, y, LEFT },
+        { x+1, y, RIGHT },
+        { x, y-1, UP },
+        { x, y+1, DOWN },
+    };
+
+    for (int d = 0; d < 4; d++)
+    {
+        int nx = Positions[d].x;
+        int ny = Positions[d].y;
+        orientation Orientation = Positions[d].Orientation;
+
+        if (Board_IsOob(Board, nx, ny))
+        {
+            continue;
+        }
+
+        int n = BOARD_INDEX(nx, ny);
+        piece OtherPiece = Board_GetTile(Board, nx, ny);
+
+        if (OtherPiece == PIECE_EMPTY)
+        {
+            if (Index->WireParent[i] != NETWORK_NONE && (Piece_OutgoingOrientations(Piece) & (1<<Orientation)))
+            {
+                Index->OpenConns[i]++;
+            }
+            continue;
+        }
+
+        // The neighbour's wire end pointed at this cell while it was empty
+        if (Index->WireParent[n] != NETWORK_NONE && (Piece_OutgoingOrientations(OtherPiece) & (1<<Orientation_Flip(Orientation))))
+        {
+            Index->OpenConns[Network_Find(Index->WireParent, n)]--;
+        }
+
+        if (Network_Links(Piece, OtherPiece, Orientation))
+        {
+            if (Index->WireParent[i] != NETWORK_NONE && Index->WireParent[n] != NETWORK_NONE) Network_JoinWires(Index, i, n);
+            Network_JoinPower(Index, i, n);
+        }
+    }
+}
+
+// Both cells belong to the same power network
+bool Network_IsWired(network_index *Index, board *Board, int ax, int ay, int bx, int by)
+{
+    Network_Sync(Index, Board);
+
+    int a = BOARD_INDEX(ax, ay), b = BOARD_INDEX(bx, by);
+    if (Index->PowerParent[a] == NETWORK_NONE || Index->PowerParent[b] == NETWORK_NONE)
+    {
+        return false;
+    }
+
+    return Network_Find(Index->PowerParent, a) == Network_Find(Index->PowerParent, b);
+}
+
+// Two distinct nodes joined by wires
+bool Network_HasPoweredPath(network_index *Index, board *Board, int ax, int ay, int bx, int by)
+{
+    if (Board_GetTile(Board, ax, ay) != PIECE_DST || Board_GetTile(Board, bx, by) != PIECE_DST)
+    {
+        return false;
+    }
+
+    if (ax == bx && ay == by)
+    {
+        return false;
+    }
+
+    return Network_IsWired(Index, Board, ax, ay, bx, by);
+}
+
+// The wire network through (x, y) has an end pointing off the board
+bool Network_IsDangling(network_index *Index, board *Board, int x, int y)
+{
+    Network_Sync(Index, Board);
+
+    int i = BOARD_INDEX(x, y);
+    if (Index->WireParent[i] == NETWORK_NONE)
+    {
+        return false;
+    }
+
+    return Index->OffBoard[Network_Find(Index->WireParent, i)] > 0;
+}
+
+int Network_OpenConns(network_index *Index, board *Board, int x, int y)
+{
+    Network_Sync(Index, Board);
+
+    int i = BOARD_INDEX(x, y);
+    if (Index->WireParent[i] == NETWORK_NONE)
+    {
+        return 0;
+    }
+
+    return Index->OpenConns[Network_Find(Index->WireParent, i)];
+}
+
+// Some wire network on the board would be turned into junk
+bool Network_AnyDangling(network_index *Index, board *Board)
+{
+    Network_Sync(Index, Board);
+
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        if (Index->WireParent[i] == i && Index->OffBoard[i] > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Some power network can complete a circuit: it joins two nodes, or runs a loop through a
+// node. Without one, Board_GetTrace() has nothing to clear
+bool Network_AnyCircuit(network_index *Index, board *Board)
+{
+    Network_Sync(Index, Board);
+
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        if (Index->PowerParent[i] != i)
+        {
+            continue;
+        }
+
+        if (Index->Nodes[i] >= 2 || (Index->Nodes[i] == 1 && Index->Links[i] >= Index->Cells[i]))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Lowest wire cell whose wire network dangles off the board, -1 when there is none. That is
+// where Board_GetTraceJunk() would start its trace
+int Network_FirstDangling(network_index *Index, board *Board)
+{
+    Network_Sync(Index, Board);
+
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        if (Index->WireParent[i] != NETWORK_NONE && Index->OffBoard[Network_Find(Index->WireParent, i)] > 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Every cell of the power networks that reach into Region
+bitboard Network_PowerCells(network_index *Index, board *Board, bitboard Region)
+{
+    Network_Sync(Index, Board);
+
+    bool Hit[BOARD_CELLS] = { 0 };
+    while (!BB_IsEmpty(Region))
+    {
+        int i = BB_Lowest(Region);
+        Region = BB_AndNot(Region, BB_Cell(i));
+
+        if (Index->PowerParent[i] != NETWORK_NONE) Hit[Network_Find(Index->PowerParent, i)] = true;
+    }
+
+    bitboard Cells = { 0 };
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        if (Index->PowerParent[i] != NETWORK_NONE && Hit[Network_Find(Index->PowerParent, i)])
+        {
+            Cells = BB_Or(Cells, BB_Cell(i));
+        }
+    }
+
+    return Cells;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static void Network_Sync(network_index *Index, board *Board)
+{
+    if (!Index->Valid || Index->Version != Board->Version)
+    {
+        Network_Rebuild(Index, Board);
+    }
+}
+
+static int Network_Find(unsigned char *Parent, int i)
+{
+    while (Parent[i] != i)
+    {
+        Parent[i] = Parent[Parent[i]];
+        i = Parent[i];
+    }
+
+    return i;
+}
+
+// The same rule the traces follow: Piece has an end towards OtherPiece and OtherPiece accepts
+// it. Incoming ends mirror outgoing ones for every piece that has both, so links are
+// symmetric, nodes never link to each other directly
+static bool Network_Links(piece Piece, piece OtherPiece, orientation Orientation)
+{
+    if (Piece == PIECE_DST && OtherPiece == PIECE_DST)
+    {
+        return false;
+    }
+
+    if (Piece == PIECE_FIRE || OtherPiece == PIECE_FIRE)
+    {
+        return false;
+    }
+
+    return (Piece_OutgoingOrientations(Piece) & Piece_IncomingOrientations(OtherPiece) & (1<<Orientation)) != 0;
+}
+
+// Starts a one-cell network. Ends pointing off the board are always counted, ends pointing
+// at empty cells only when CountOpen is set
+static void Network_MakeCell(network_index *Index, board *Board, int x, int y, bool CountOpen)
+{
+    int i = BOARD_INDEX(x, y);
+    piece Piece = Board_GetTile(Board, x, y);
+    bool Wire = Piece_IsConnectionType(Piece);
+
+    Index->WireParent[i] = Wire? i : NETWORK_NONE;
+    Index->PowerParent[i] = (Wire || Piece == PIECE_DST)? i : NETWORK_NONE;
+    Index->OpenConns[i] = 0;
+    Index->OffBoard[i] = 0;
+    Index->Nodes[i] = (Piece == PIECE_DST)? 1 : 0;
+    Index->Cells[i] = 1;
+    Index->Links[i] = 0;
+
+    if (!Wire)
+    {
+        return;
+    }
+
+    unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+    const int Dx[4] = { 1, 0, -1, 0 };      // Indexed by orientation
+    const int Dy[4] = { 0, 1, 0, -1 };
+
+    for (int Orientation = RIGHT; Orientation <= UP; Orientation++)
+    {
+        if ((DirFrom & (1<<Orientation)) == 0)
+        {
+            continue;
+        }
+
+        int nx = x + Dx[Orientation];
+        int ny = y + Dy[Orientation];
+
+        if (Board_IsOob(Board, nx, ny)) Index->OffBoard[i]++;
+        else if (CountOpen && !Board_IsOccupied(Board, nx, ny)) Index->OpenConns[i]++;
+    }
+}
+
+static void Network_JoinWires(network_index *Index, int a, int b)
+{
+    int ra = Network_Find(Index->WireParent, a);
+    int rb = Network_Find(Index->WireParent, b);
+
+    if (ra == rb)
+    {
+        return;
+    }
+
+    Index->WireParent[rb] = ra;
+    Index->OpenConns[ra] += Index->OpenConns[rb];
+    Index->OffBoard[ra] += Index->OffBoard[rb];
+}
+
+static void Network_JoinPower(network_index *Index, int a, int b)
+{
+    int ra = Network_Find(Index->PowerParent, a);
+    int rb = Network_Find(Index->PowerParent, b);
+
+    if (ra == rb)
+    {
+        Index->Links[ra]++;
+        return;
+    }
+
+    Index->PowerParent[rb] = ra;
+    Index->Nodes[ra] += Index->Nodes[rb];
+    Index->Cells[ra] += Index->Cells[rb];
+    Index->Links[ra] += Index->Links[rb] + 1;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************************
+*
+*   Nettis core - wire network index
+*
+*   Union-find over the board cells, kept next to the board so connectivity questions are
+*   answered without a flood fill. Two partitions are tracked:
+*     - wire networks: wires joined end to end, the cells a junk trace walks over
+*     - power networks: wires and nodes joined end to end, the cells a power trace reaches
+*
+*   The index remembers the board version it was built for. Placing a piece only merges
+*   networks and is applied incrementally with Network_Add(); after any other change the
+*   next query rebuilds the index in one pass over the board. A zeroed index is invalid
+*
+********************************************************************************************/
+
+#ifndef NETTIS_NETWORK_H
+#define NETTIS_NETWORK_H
+
+#include "board.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define NETWORK_NONE 0xFF           // Parent of cells outside any network
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Per network counters are only meaningful on the root cell of a network
+typedef struct {
+    unsigned char WireParent[BOARD_CELLS];
+    unsigned char OpenConns[BOARD_CELLS];       // Wire ends pointing at an empty cell
+    unsigned char OffBoard[BOARD_CELLS];        // Wire ends pointing off the board
+    unsigned char PowerParent[BOARD_CELLS];
+    unsigned char Nodes[BOARD_CELLS];           // DST pieces in the power network
+    unsigned char Cells[BOARD_CELLS];
+    unsigned char Links[BOARD_CELLS];           // More links than cells-1 means a loop
+    unsigned int Version;                       // Board version the index reflects
+    bool Valid;
+} network_index;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void Network_Rebuild(network_index *Index, board *Board);
+void Network_Add(network_index *Index, board *Board, int x, int y);     // Call after filling an empty cell
+
+bool Network_IsWired(network_index *Index, board *Board, int ax, int ay, int bx, int by);
+bool Network_HasPoweredPath(network_index *Index, board *Board, int ax, int ay, int bx, int by);
+bool Network_IsDangling(network_index *Index, board *Board, int x, int y);
+int Network_OpenConns(network_index *Index, board *Board, int x, int y);
+bool Network_AnyDangling(network_index *Index, board *Board);
+int Network_FirstDangling(network_index *Index, board *Board);
+bool Network_AnyCircuit(network_index *Index, board *Board);
+bitboard Network_PowerCells(network_index *Index, board *Board, bitboard Region);
+
+#endif // NETTIS_NETWORK_H
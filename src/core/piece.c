@@ -0,0 +1,88 @@
+/*******************************************************************************************
+*
+*   Nettis core - pieces and orientations
+*
+********************************************************************************************/
+
+#include "piece.h"
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+orientation Orientation_Flip(orientation Orientation)
+{
+    switch (Orientation)
+    {
+        case RIGHT: return LEFT;
+        case LEFT:  return RIGHT;
+        case DOWN:  return UP;
+        case UP:    return DOWN;
+    }
+}
+
+unsigned int Piece_IncomingOrientations(piece Piece)
+{
+    switch (Piece)
+    {
+        case PIECE_EMPTY: return 0;
+        case PIECE_HCONN: return 1<<RIGHT | 1<<LEFT;
+        case PIECE_VCONN: return 1<<DOWN  | 1<<UP;
+        case PIECE_UL:    return 1<<DOWN  | 1<<RIGHT;
+        case PIECE_DL:    return 1<<UP    | 1<<RIGHT;
+        case PIECE_DR:    return 1<<UP    | 1<<LEFT;
+        case PIECE_UR:    return 1<<DOWN  | 1<<LEFT;
+        case PIECE_DST:   return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
+        case PIECE_JUNK:  return 0;
+        case PIECE_FIRE:  return 0;
+    }
+}
+
+unsigned int Piece_OutgoingOrientations(piece Piece)
+{
+    switch (Piece)
+    {
+        case PIECE_EMPTY: return 0;
+        case PIECE_HCONN: return 1<<RIGHT | 1<<LEFT;
+        case PIECE_VCONN: return 1<<DOWN | 1<<UP;
+        case PIECE_UL:    return 1<<UP    | 1<<LEFT;
+        case PIECE_DL:    return 1<<DOWN  | 1<<LEFT;
+        case PIECE_DR:    return 1<<DOWN  | 1<<RIGHT;
+        case PIECE_UR:    return 1<<UP    | 1<<RIGHT;
+        case PIECE_DST:   return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
+        case PIECE_JUNK:  return 0;
+        case PIECE_FIRE:  return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
+    }
+}
+
+piece Piece_Rotate(piece Piece)
+{
+    switch (Piece)
+    {
+        case PIECE_EMPTY: return PIECE_EMPTY;
+        case PIECE_HCONN: return PIECE_VCONN;
+        case PIECE_VCONN: return PIECE_HCONN;
+        case PIECE_UL:    return PIECE_UR;
+        case PIECE_DL:    return PIECE_UL;
+        case PIECE_DR:    return PIECE_DL;
+        case PIECE_UR:    return PIECE_DR;
+        case PIECE_DST:   return PIECE_DST;
+        case PIECE_JUNK:  return PIECE_JUNK;
+        case PIECE_FIRE:  return PIECE_FIRE;
+    }
+}
+
+bool Piece_IsConnectionType(piece Piece)
+{
+    switch (Piece)
+    {
+        case PIECE_HCONN:
+        case PIECE_VCONN:
+        case PIECE_UL:
+        case PIECE_DL:
+        case PIECE_DR:
+        case PIECE_UR:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,48 @@
+/*******************************************************************************************
+*
+*   Nettis core - pieces and orientations
+*
+*   Part of nettis_core: the game rules, independent of raylib and of wall-clock time
+*
+********************************************************************************************/
+
+#ifndef NETTIS_PIECE_H
+#define NETTIS_PIECE_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef enum {
+    PIECE_EMPTY = 0,
+    PIECE_HCONN = 1,
+    PIECE_VCONN = 2,
+    PIECE_UL = 3,
+    PIECE_DL = 4,
+    PIECE_DR = 5,
+    PIECE_UR = 6,
+    PIECE_DST = 7,
+    PIECE_JUNK = 8,
+    PIECE_FIRE = 9,
+} piece;
+
+#define PIECE_PALLETE_SIZE 10
+
+typedef enum {
+    RIGHT = 0,
+    DOWN = 1,
+    LEFT = 2,
+    UP = 3,
+} orientation;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+orientation Orientation_Flip(orientation Orientation);
+unsigned int Piece_IncomingOrientations(piece Piece);
+unsigned int Piece_OutgoingOrientations(piece Piece);
+piece Piece_Rotate(piece Piece);
+bool Piece_IsConnectionType(piece Piece);
+
+#endif // NETTIS_PIECE_H
@@ -0,0 +1,268 @@
+/*******************************************************************************************
+*
+*   Nettis core - input recording and playback
+*
+********************************************************************************************/
+
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define REPLAY_MAGIC "NTRP"
+#define REPLAY_VERSION 2
+#define REPLAY_VERSION_SINGLE_INPUT 1     // Last one with one flag applied per tick
+#define REPLAY_HEADER_SIZE (4 + 1 + 8 + 4 + 4 + 4 + 4)
+
+#define REPLAY_INPUT_MASK 0x0F
+#define REPLAY_DELTA_ESCAPE 15
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static void Replay_Push(replay *Replay, unsigned char Byte);
+static void Replay_PutU32(unsigned char *Out, unsigned int Value);
+static unsigned int Replay_GetU32(const unsigned char *In);
+static void Replay_ReadEvent(replay_player *Player);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+void Replay_Begin(replay *Replay, uint64_t Seed)
+{
+    *Replay = (replay){ 0 };
+    Replay->Version = REPLAY_VERSION;
+    Replay->Seed = Seed;
+}
+
+void Replay_Record(replay *Replay, unsigned int Input)
+{
+    unsigned int Tick = Replay->Ticks++;
+    Input &= REPLAY_INPUT_MASK;
+
+    if (Input == 0)
+    {
+        return;
+    }
+
+    unsigned int Delta = Tick - Replay->LastEvent;
+    Replay->LastEvent = Tick;
+
+    if (Delta < REPLAY_DELTA_ESCAPE)
+    {
+        Replay_Push(Replay, (unsigned char)(Delta<<4 | Input));
+        return;
+    }
+
+    Replay_Push(Replay, (unsigned char)(REPLAY_DELTA_ESCAPE<<4 | Input));
+    Delta -= REPLAY_DELTA_ESCAPE;
+    do
+    {
+        unsigned char Byte = Delta & 0x7F;
+        Delta >>= 7;
+        Replay_Push(Replay, (Delta != 0)? (Byte | 0x80) : Byte);
+    } while (Delta != 0);
+}
+
+void Replay_Finish(replay *Replay, gameplay *Gameplay)
+{
+    Replay->Score = Gameplay->Scoring.Score;
+    Replay->Checksum = GP_Checksum(Gameplay);
+}
+
+void Replay_Free(replay *Replay)
+{
+    free(Replay->Data);
+    *Replay = (replay){ 0 };
+}
+
+bool Replay_Save(replay *Replay, const char *FileName)
+{
+    if (Replay->Truncated)
+    {
+        return false;
+    }
+
+    unsigned char Header[REPLAY_HEADER_SIZE];
+    memcpy(Header, REPLAY_MAGIC, 4);
+    Header[4] = (unsigned char)Replay->Version;
+    Replay_PutU32(Header + 5, (unsigned int)Replay->Seed);
+    Replay_PutU32(Header + 9, (unsigned int)(Replay->Seed >> 32));
+    Replay_PutU32(Header + 13, Replay->Ticks);
+    Replay_PutU32(Header + 17, (unsigned int)Replay->Score);
+    Replay_PutU32(Header + 21, Replay->Checksum);
+    Replay_PutU32(Header + 25, (unsigned int)Replay->Size);
+
+    FILE *File = fopen(FileName, "wb");
+    if (File == NULL)
+    {
+        return false;
+    }
+
+    bool Ok = fwrite(Header, 1, sizeof(Header), File) == sizeof(Header);
+    if (Ok && Replay->Size > 0)
+    {
+        Ok = fwrite(Replay->Data, 1, Replay->Size, File) == Replay->Size;
+    }
+
+    return (fclose(File) == 0) && Ok;
+}
+
+bool Replay_Load(replay *Replay, const char *FileName)
+{
+    *Replay = (replay){ 0 };
+
+    FILE *File = fopen(FileName, "rb");
+    if (File == NULL)
+    {
+        return false;
+    }
+
+    unsigned char Header[REPLAY_HEADER_SIZE];
+    if (fread(Header, 1, sizeof(Header), File) != sizeof(Header) ||
+        memcmp(Header, REPLAY_MAGIC, 4) != 0 ||
+        Header[4] < REPLAY_VERSION_SINGLE_INPUT || Header[4] > REPLAY_VERSION)
+    {
+        fclose(File);
+        return false;
+    }
+
+    Replay->Version = Header[4];
+    Replay->Seed = (uint64_t)Replay_GetU32(Header + 5) | (uint64_t)Replay_GetU32(Header + 9) << 32;
+    Replay->Ticks = Replay_GetU32(Header + 13);
+    Replay->Score = (int)Replay_GetU32(Header + 17);
+    Replay->Checksum = Replay_GetU32(Header + 21);
+    Replay->Size = Replay_GetU32(Header + 25);
+    Replay->Capacity = Replay->Size;
+
+    if (Replay->Size > 0)
+    {
+        Replay->Data = malloc(Replay->Size);
+        if (Replay->Data == NULL || fread(Replay->Data, 1, Replay->Size, File) != Replay->Size)
+        {
+            fclose(File);
+            Replay_Free(Replay);
+            return false;
+        }
+    }
+
+    fclose(File);
+    return true;
+}
+
+// Restarts Gameplay from the replay seed and feeds it every recorded tick, as fast as it goes
+bool Replay_Play(replay *Replay, gameplay *Gameplay)
+{
+    replay_player Player;
+    Replay_Start(&Player, Replay, Gameplay);
+    while (Replay_Step(&Player, Gameplay));
+
+    return Replay_Matches(Replay, Gameplay);
+}
+
+void Replay_Start(replay_player *Player, replay *Replay, gameplay *Gameplay)
+{
+    GP_Init(Gameplay, Replay->Seed);
+
+    *Player = (replay_player){ 0 };
+    Player->Replay = Replay;
+    Replay_ReadEvent(Player);
+}
+
+bool Replay_Step(replay_player *Player, gameplay *Gameplay)
+{
+    if (!Player->Pending && Player->Tick >= Player->Replay->Ticks)
+    {
+        return false;
+    }
+
+    unsigned int Input = 0;
+    if (Player->Pending && Player->NextEvent <= Player->Tick)
+    {
+        Input = Player->NextInput;
+        Replay_ReadEvent(Player);
+    }
+
+    GP_Update(Gameplay, Input);
+    Player->Tick++;
+    return true;
+}
+
+bool Replay_Matches(replay *Replay, gameplay *Gameplay)
+{
+    return Gameplay->Scoring.Score == Replay->Score &&
+        GP_Checksum(Gameplay) == Replay->Checksum;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static void Replay_Push(replay *Replay, unsigned char Byte)
+{
+    if (Replay->Size == Replay->Capacity)
+    {
+        size_t Capacity = (Replay->Capacity != 0)? Replay->Capacity*2 : 4096;
+        unsigned char *Data = realloc(Replay->Data, Capacity);
+        if (Data == NULL)
+        {
+            Replay->Truncated = true;
+            return;
+        }
+        Replay->Data = Data;
+        Replay->Capacity = Capacity;
+    }
+
+    Replay->Data[Replay->Size++] = Byte;
+}
+
+static void Replay_PutU32(unsigned char *Out, unsigned int Value)
+{
+    Out[0] = (unsigned char)Value;
+    Out[1] = (unsigned char)(Value >> 8);
+    Out[2] = (unsigned char)(Value >> 16);
+    Out[3] = (unsigned char)(Value >> 24);
+}
+
+static unsigned int Replay_GetU32(const unsigned char *In)
+{
+    return (unsigned int)In[0] | (unsigned int)In[1] << 8 | (unsigned int)In[2] << 16 | (unsigned int)In[3] << 24;
+}
+
+// Decodes the next event, the first one counts from tick 0 and every other one from the last
+static void Replay_ReadEvent(replay_player *Player)
+{
+    replay *Replay = Player->Replay;
+    if (Player->Cursor >= Replay->Size)
+    {
+        Player->Pending = false;
+        return;
+    }
+
+    unsigned char Byte = Replay->Data[Player->Cursor++];
+    unsigned int Delta = Byte >> 4;
+
+    if (Delta == REPLAY_DELTA_ESCAPE)
+    {
+        unsigned int Extra = 0;
+        for (int Shift = 0; Player->Cursor < Replay->Size && Shift < 32; Shift += 7)
+        {
+            unsigned char Next = Replay->Data[Player->Cursor++];
+            Extra |= (unsigned int)(Next & 0x7F) << Shift;
+            if ((Next & 0x80) == 0) break;
+        }
+        Delta += Extra;
+    }
+
+    Player->NextEvent += Delta;
+    Player->NextInput = Byte & REPLAY_INPUT_MASK;
+    if (Replay->Version == REPLAY_VERSION_SINGLE_INPUT)
+    {
+        // The lowest flag is the one these ticks applied
+        Player->NextInput &= 0u - Player->NextInput;
+    }
+    Player->Pending = true;
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************************
+*
+*   Nettis core - input recording and playback
+*
+*   A game is fully determined by its seed and the GP_* input given to every tick, gravity
+*   included since it runs on the tick counter. A replay stores the seed, the number of ticks
+*   and one event per tick that had input:
+*     - one byte: input flags in the low 4 bits, ticks since the previous event in the high 4
+*     - a delta of 15 or more stores 15 and the rest follows as a LEB128 varint
+*   A quiet tick costs nothing and a typical input costs a single byte.
+*
+*   The score and a checksum of the board at the end of recording are kept too, so playback
+*   can tell whether it reproduced the game.
+*
+*   Version 1 replays are from when a tick only applied one of its flags, down first, then
+*   left, right and rotate. They are played back with the others dropped
+*
+********************************************************************************************/
+
+#ifndef NETTIS_REPLAY_H
+#define NETTIS_REPLAY_H
+
+#include "gameplay.h"
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    int Version;                    // Format the events were recorded in
+    uint64_t Seed;
+    unsigned int Ticks;             // Ticks recorded, with or without input
+    unsigned int LastEvent;         // Tick of the last event written
+    int Score;                      // Scoring.Score when recording finished
+    unsigned int Checksum;          // Board_Checksum() when recording finished
+    unsigned char *Data;            // Event stream
+    size_t Size;
+    size_t Capacity;
+    bool Truncated;                 // An event did not fit in memory, the stream is unusable
+} replay;
+
+// Plays a replay back one tick at a time
+typedef struct {
+    replay *Replay;
+    size_t Cursor;                  // Next byte of the event stream
+    unsigned int Tick;              // Ticks played so far
+    unsigned int NextEvent;         // Tick of the next event, while Pending
+    unsigned int NextInput;
+    bool Pending;
+} replay_player;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void Replay_Begin(replay *Replay, uint64_t Seed);                    // Same seed as GP_Init()
+void Replay_Record(replay *Replay, unsigned int Input);              // Once per GP_Update(), with its input
+void Replay_Finish(replay *Replay, gameplay *Gameplay);
+void Replay_Free(replay *Replay);
+
+bool Replay_Save(replay *Replay, const char *FileName);              // False for a truncated recording too
+bool Replay_Load(replay *Replay, const char *FileName);
+
+bool Replay_Play(replay *Replay, gameplay *Gameplay);                // Runs every tick, true if the result matches
+void Replay_Start(replay_player *Player, replay *Replay, gameplay *Gameplay);   // GP_Init()s the game
+bool Replay_Step(replay_player *Player, gameplay *Gameplay);         // Runs one tick, false once all were run
+bool Replay_Matches(replay *Replay, gameplay *Gameplay);             // Ends with the recorded score and board
+
+#endif // NETTIS_REPLAY_H
@@ -0,0 +1,56 @@
+/*******************************************************************************************
+*
+*   Nettis core - seedable random numbers
+*
+*   PCG32 generator: 64-bit state, 32-bit output. Every game owns its own generator, so a
+*   seed fully determines the sequence and games never share hidden state
+*
+********************************************************************************************/
+
+#ifndef NETTIS_RNG_H
+#define NETTIS_RNG_H
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define RNG_MULTIPLIER 6364136223846793005ULL
+#define RNG_INCREMENT 1442695040888963407ULL
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    uint64_t State;
+} rng;
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition (inline, used on every hot path)
+//----------------------------------------------------------------------------------
+static inline uint32_t Rng_Next(rng *Rng)
+{
+    uint64_t Old = Rng->State;
+    Rng->State = Old*RNG_MULTIPLIER + RNG_INCREMENT;
+
+    uint32_t Xorshifted = (uint32_t)(((Old >> 18) ^ Old) >> 27);
+    uint32_t Rotation = (uint32_t)(Old >> 59);
+    return (Xorshifted >> Rotation) | (Xorshifted << ((32 - Rotation) & 31));
+}
+
+static inline void Rng_Seed(rng *Rng, uint64_t Seed)
+{
+    Rng->State = 0;
+    Rng_Next(Rng);
+    Rng->State += Seed;
+    Rng_Next(Rng);
+}
+
+// Uniform value in [0, Bound), Bound has to be non zero. Uses the high bits of a 64-bit
+// product instead of a modulo, the bias is below 2^-24 for the small bounds used here
+static inline uint32_t Rng_Below(rng *Rng, uint32_t Bound)
+{
+    return (uint32_t)(((uint64_t)Rng_Next(Rng)*Bound) >> 32);
+}
+
+#endif // NETTIS_RNG_H
@@ -0,0 +1,425 @@
+/*******************************************************************************************
+*
+*   Nettis core - packed game state
+*
+********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // ftruncate() under -std=c99
+#endif
+
+#include "snapshot.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define SNAPSHOT_MAGIC "NTSS"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ORDER 0x01020304u      // Reads back differently on the other byte order
+
+#define SNAPSHOT_TIMER_MAX 0xFFFF
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t Order;
+    uint32_t Size;                      // sizeof(snapshot)
+    uint32_t Count;
+} snapshot_header;
+
+// Where the resolution state is packed from, the game itself or the origin of its cascade
+typedef struct {
+    board *Board;
+    power_board *Powers;
+    trace *Trace;
+    trace *TraceJunk;
+    unsigned int PowerVersion;
+    unsigned int JunkVersion;
+    timer TimerTrace;
+    timer TimerJunk;
+    int TraceIndex;
+    int TraceJunkIndex;
+    scoring Scoring;
+} snapshot_source;
+
+// A mapped file
+typedef struct {
+    unsigned char *Data;
+    size_t Size;
+#if defined(_WIN32)
+    HANDLE File;
+    HANDLE Mapping;
+#else
+    int File;
+#endif
+} snapshot_map;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static snapshot_source Snapshot_Origin(gp_resolution *Origin);
+static void Snapshot_PackSource(snapshot *Snapshot, snapshot_source *Source);
+static bool Snapshot_SameOrigin(snapshot *Snapshot, gp_cascade *Cascade);
+static uint16_t Snapshot_TimerLeft(timer *Timer, unsigned int Now);
+static void Snapshot_PackTrace(uint8_t *Cells, uint8_t *Count, trace *Trace);
+static void Snapshot_UnpackTrace(const uint8_t *Cells, uint8_t Count, trace *Trace);
+static snapshot_brick Snapshot_PackBrick(brick *Brick);
+static brick Snapshot_UnpackBrick(snapshot_brick *Packed);
+static bool Snapshot_Map(snapshot_map *Map, const char *FileName, size_t Size);
+static void Snapshot_Unmap(snapshot_map *Map);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool Snapshot_Take(snapshot *Snapshot, gameplay *Gameplay)
+{
+    if (GP_IsField(Gameplay))
+    {
+        return false;
+    }
+
+    *Snapshot = (snapshot){ 0 };
+
+    snapshot_source Source;
+    gp_cascade *Cascade = &Gameplay->Cascade;
+    if (Cascade->Active)
+    {
+        Source = Snapshot_Origin(&Cascade->Origin);
+        Snapshot->Flags |= SNAPSHOT_CASCADE;
+        Snapshot->Start = Cascade->Start;
+    }
+    else
+    {
+        Source = (snapshot_source){ &Gameplay->Board, &Gameplay->Powers, &Gameplay->Trace, &Gameplay->TraceJunk,
+            Gameplay->PowerVersion, Gameplay->JunkVersion, Gameplay->TimerTrace, Gameplay->TimerJunk,
+            Gameplay->TraceIndex, Gameplay->TraceJunkIndex, Gameplay->Scoring };
+        Snapshot->Start = Gameplay->Tick;
+    }
+    Snapshot_PackSource(Snapshot, &Source);
+
+    Snapshot->Tick = Gameplay->Tick;
+    Snapshot->JunkPending = (uint16_t)((Gameplay->JunkPending < UINT16_MAX)? Gameplay->JunkPending : UINT16_MAX);
+    Snapshot->GravityLeft = Snapshot_TimerLeft(&Gameplay->TimerGravity, Gameplay->Tick);
+    Snapshot->Brick = Snapshot_PackBrick(&Gameplay->Brick);
+    Snapshot->Rng = Gameplay->Queue.Rng.State;
+    Snapshot->QueueHead = (uint8_t)Gameplay->Queue.Head;
+    Snapshot->QueueCount = (uint8_t)Gameplay->Queue.Count;
+    for (int i = 0; i < BRICK_QUEUE_SIZE; i++)
+    {
+        Snapshot->Queue[i] = Snapshot_PackBrick(&Gameplay->Queue.Bricks[i]);
+    }
+
+    return true;
+}
+
+// Rules, timing and the brick table are the game's own, everything else comes from the
+// snapshot. Board versions go on from the ones the game had
+void Snapshot_Restore(snapshot *Snapshot, gameplay *Gameplay)
+{
+    Board_Reset(&Gameplay->Board);
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        int x = i % BOARD_WIDTH, y = i / BOARD_WIDTH;
+        int Shift = (i & 1)*4;
+        Board_SetTile(&Gameplay->Board, x, y, (piece)((Snapshot->Cells[i/2] >> Shift) & 0x0F));
+        Gameplay->Powers.Incoming[y][x] = (Snapshot->Powers[i/2] >> Shift) & 0x0F;
+    }
+    Gameplay->Board.Touched = (bitboard){ Snapshot->Touched[0], Snapshot->Touched[1] };
+
+    // Only whether they match the board counts
+    unsigned int Version = Gameplay->Board.Version;
+    Gameplay->PowerVersion = (Snapshot->Flags & SNAPSHOT_POWER_CURRENT)? Version : Version - 1;
+    Gameplay->JunkVersion = (Snapshot->Flags & SNAPSHOT_JUNK_CURRENT)? Version : Version - 1;
+    Gameplay->Networks = (network_index){ 0 };
+
+    Snapshot_UnpackTrace(Snapshot->Trace, Snapshot->TraceCount, &Gameplay->Trace);
+    Snapshot_UnpackTrace(Snapshot->TraceJunk, Snapshot->TraceJunkCount, &Gameplay->TraceJunk);
+    Gameplay->TraceIndex = Snapshot->TraceIndex;
+    Gameplay->TraceJunkIndex = Snapshot->TraceJunkIndex;
+    Gameplay->TimerTrace = Timer_Make(Snapshot->Start, Snapshot->TraceLeft);
+    Gameplay->TimerJunk = Timer_Make(Snapshot->Start, Snapshot->JunkLeft);
+
+    Gameplay->Scoring.Score = Snapshot->Score;
+    Gameplay->Scoring.NodeChain = Snapshot->NodeChain;
+    Gameplay->Scoring.WireChain = Snapshot->WireChain;
+    Gameplay->Scoring.Multiplier = Snapshot->Multiplier;
+    Gameplay->Falls.Count = 0;
+
+    Gameplay->Tick = Snapshot->Tick;
+    Gameplay->JunkPending = Snapshot->JunkPending;
+    Gameplay->TimerGravity = Timer_Make(Snapshot->Tick, Snapshot->GravityLeft);
+    Gameplay->Brick = Snapshot_UnpackBrick(&Snapshot->Brick);
+    Gameplay->Queue.Rng.State = Snapshot->Rng;
+    Gameplay->Queue.Head = Snapshot->QueueHead;
+    Gameplay->Queue.Count = Snapshot->QueueCount;
+    for (int i = 0; i < BRICK_QUEUE_SIZE; i++)
+    {
+        Gameplay->Queue.Bricks[i] = Snapshot_UnpackBrick(&Snapshot->Queue[i]);
+    }
+
+    // Rollback restores into the game that resolved the chain, which still holds it
+    bool Resolved = (Snapshot->Flags & SNAPSHOT_CASCADE) && Snapshot_SameOrigin(Snapshot, &Gameplay->Cascade);
+    Gameplay->Cascade.Active = false;
+    if (Snapshot->Flags & SNAPSHOT_CASCADE)
+    {
+        GP_ResumeCascade(Gameplay, Snapshot->Start, Resolved);
+    }
+}
+
+bool Snapshot_Save(const snapshot *Snapshots, int Count, const char *FileName)
+{
+    if (Count < 0)
+    {
+        return false;
+    }
+
+    snapshot_map Map;
+    size_t Size = sizeof(snapshot_header) + (size_t)Count*sizeof(snapshot);
+    if (!Snapshot_Map(&Map, FileName, Size))
+    {
+        return false;
+    }
+
+    snapshot_header Header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, SNAPSHOT_ORDER, sizeof(snapshot), (uint32_t)Count };
+    memcpy(Map.Data, &Header, sizeof(Header));
+    if (Count > 0) memcpy(Map.Data + sizeof(Header), Snapshots, (size_t)Count*sizeof(snapshot));
+
+    Snapshot_Unmap(&Map);
+    return true;
+}
+
+int Snapshot_Load(snapshot *Snapshots, int Capacity, const char *FileName)
+{
+    snapshot_map Map;
+    if (!Snapshot_Map(&Map, FileName, 0))
+    {
+        return -1;
+    }
+
+    snapshot_header Header;
+    int Count = -1;
+    if (Map.Size >= sizeof(Header))
+    {
+        memcpy(&Header, Map.Data, sizeof(Header));
+
+        bool Valid = memcmp(Header.Magic, SNAPSHOT_MAGIC, 4) == 0 && Header.Version == SNAPSHOT_VERSION &&
+            Header.Order == SNAPSHOT_ORDER && Header.Size == sizeof(snapshot) &&
+            Header.Count <= (Map.Size - sizeof(Header))/sizeof(snapshot);
+        if (Valid)
+        {
+            Count = ((int)Header.Count < Capacity)? (int)Header.Count : Capacity;
+            if (Count > 0) memcpy(Snapshots, Map.Data + sizeof(Header), (size_t)Count*sizeof(snapshot));
+        }
+    }
+
+    Snapshot_Unmap(&Map);
+    return Count;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static snapshot_source Snapshot_Origin(gp_resolution *Origin)
+{
+    return (snapshot_source){ &Origin->Board, &Origin->Powers, &Origin->Trace, &Origin->TraceJunk,
+        Origin->PowerVersion, Origin->JunkVersion, Origin->TimerTrace, Origin->TimerJunk,
+        Origin->TraceIndex, Origin->TraceJunkIndex, Origin->Scoring };
+}
+
+// The resolution state, timers as the ticks they have left at Snapshot->Start
+static void Snapshot_PackSource(snapshot *Snapshot, snapshot_source *Source)
+{
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        int x = i % BOARD_WIDTH, y = i / BOARD_WIDTH;
+        int Shift = (i & 1)*4;
+        Snapshot->Cells[i/2] |= (uint8_t)(Board_GetTile(Source->Board, x, y) << Shift);
+        Snapshot->Powers[i/2] |= (uint8_t)((Source->Powers->Incoming[y][x] & 0x0F) << Shift);
+    }
+    Snapshot->Touched[0] = Source->Board->Touched.Lo;
+    Snapshot->Touched[1] = Source->Board->Touched.Hi;
+
+    if (Source->PowerVersion == Source->Board->Version) Snapshot->Flags |= SNAPSHOT_POWER_CURRENT;
+    if (Source->JunkVersion == Source->Board->Version) Snapshot->Flags |= SNAPSHOT_JUNK_CURRENT;
+
+    Snapshot_PackTrace(Snapshot->Trace, &Snapshot->TraceCount, Source->Trace);
+    Snapshot_PackTrace(Snapshot->TraceJunk, &Snapshot->TraceJunkCount, Source->TraceJunk);
+    Snapshot->TraceIndex = (uint8_t)Source->TraceIndex;
+    Snapshot->TraceJunkIndex = (uint8_t)Source->TraceJunkIndex;
+    Snapshot->TraceLeft = Snapshot_TimerLeft(&Source->TimerTrace, Snapshot->Start);
+    Snapshot->JunkLeft = Snapshot_TimerLeft(&Source->TimerJunk, Snapshot->Start);
+
+    Snapshot->Score = Source->Scoring.Score;
+    Snapshot->NodeChain = (uint16_t)Source->Scoring.NodeChain;
+    Snapshot->WireChain = (uint16_t)Source->Scoring.WireChain;
+    Snapshot->Multiplier = (uint16_t)Source->Scoring.Multiplier;
+}
+
+// Whether the cascade in the game was resolved from the state the snapshot kept, then only
+// its events have to be played again. The chain is the same whatever the brick and queue
+static bool Snapshot_SameOrigin(snapshot *Snapshot, gp_cascade *Cascade)
+{
+    if (Cascade->Start != Snapshot->Start || Cascade->Count == 0)
+    {
+        return false;
+    }
+
+    snapshot Origin = { 0 };
+    Origin.Start = Snapshot->Start;
+    snapshot_source Source = Snapshot_Origin(&Cascade->Origin);
+    Snapshot_PackSource(&Origin, &Source);
+
+    uint8_t Kept = SNAPSHOT_POWER_CURRENT | SNAPSHOT_JUNK_CURRENT;
+    return memcmp(Origin.Cells, Snapshot->Cells, sizeof(Origin.Cells)) == 0 &&
+        memcmp(Origin.Powers, Snapshot->Powers, sizeof(Origin.Powers)) == 0 &&
+        Origin.Touched[0] == Snapshot->Touched[0] && Origin.Touched[1] == Snapshot->Touched[1] &&
+        (Origin.Flags & Kept) == (Snapshot->Flags & Kept) &&
+        Origin.TraceCount == Snapshot->TraceCount && Origin.TraceJunkCount == Snapshot->TraceJunkCount &&
+        memcmp(Origin.Trace, Snapshot->Trace, Origin.TraceCount) == 0 &&
+        memcmp(Origin.TraceJunk, Snapshot->TraceJunk, Origin.TraceJunkCount) == 0 &&
+        Origin.TraceIndex == Snapshot->TraceIndex && Origin.TraceJunkIndex == Snapshot->TraceJunkIndex &&
+        Origin.TraceLeft == Snapshot->TraceLeft && Origin.JunkLeft == Snapshot->JunkLeft &&
+        Origin.Score == Snapshot->Score && Origin.NodeChain == Snapshot->NodeChain &&
+        Origin.WireChain == Snapshot->WireChain && Origin.Multiplier == Snapshot->Multiplier;
+}
+
+static uint16_t Snapshot_TimerLeft(timer *Timer, unsigned int Now)
+{
+    unsigned int Elapsed = Now - Timer->Start;
+    if (Elapsed >= Timer->Duration)
+    {
+        return 0;
+    }
+
+    unsigned int Left = Timer->Duration - Elapsed;
+    return (uint16_t)((Left < SNAPSHOT_TIMER_MAX)? Left : SNAPSHOT_TIMER_MAX);
+}
+
+static void Snapshot_PackTrace(uint8_t *Cells, uint8_t *Count, trace *Trace)
+{
+    *Count = Trace->Count;
+    memcpy(Cells, Trace->Cells, Trace->Count);
+}
+
+// Only the cells, their order and the mask survive, the rest is for tracing
+static void Snapshot_UnpackTrace(const uint8_t *Cells, uint8_t Count, trace *Trace)
+{
+    Trace_Clear(Trace);
+    Trace->Count = Count;
+    memcpy(Trace->Cells, Cells, Count);
+    for (int i = 0; i < Count; i++)
+    {
+        Trace->Mask = BB_Or(Trace->Mask, BB_Cell(Cells[i]));
+    }
+}
+
+static snapshot_brick Snapshot_PackBrick(brick *Brick)
+{
+    snapshot_brick Packed;
+    Packed.x = (int8_t)Brick->x;
+    Packed.y = (int8_t)Brick->y;
+    Packed.Pieces = (uint8_t)(Brick->Pieces[0] | Brick->Pieces[1] << 4);
+    Packed.Orientation = (uint8_t)Brick->Orientation;
+    return Packed;
+}
+
+static brick Snapshot_UnpackBrick(snapshot_brick *Packed)
+{
+    brick Brick;
+    Brick.x = Packed->x;
+    Brick.y = Packed->y;
+    Brick.Pieces[0] = (piece)(Packed->Pieces & 0x0F);
+    Brick.Pieces[1] = (piece)(Packed->Pieces >> 4);
+    Brick.Orientation = (orientation)Packed->Orientation;
+    return Brick;
+}
+
+// Size 0 maps an existing file to read it, any other size creates the file that size to
+// write it
+static bool Snapshot_Map(snapshot_map *Map, const char *FileName, size_t Size)
+{
+    bool Write = Size > 0;
+    *Map = (snapshot_map){ 0 };
+
+#if defined(_WIN32)
+    Map->File = CreateFileA(FileName, Write? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, Write? 0 : FILE_SHARE_READ,
+        NULL, Write? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (Map->File == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    if (!Write)
+    {
+        LARGE_INTEGER FileSize;
+        if (!GetFileSizeEx(Map->File, &FileSize) || FileSize.QuadPart == 0)
+        {
+            CloseHandle(Map->File);
+            return false;
+        }
+        Size = (size_t)FileSize.QuadPart;
+    }
+
+    // Mapping a writable view sizes the file
+    Map->Mapping = CreateFileMappingA(Map->File, NULL, Write? PAGE_READWRITE : PAGE_READONLY,
+        (DWORD)((uint64_t)Size >> 32), (DWORD)Size, NULL);
+    if (Map->Mapping != NULL)
+    {
+        Map->Data = MapViewOfFile(Map->Mapping, Write? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, Size);
+    }
+    if (Map->Data == NULL)
+    {
+        if (Map->Mapping != NULL) CloseHandle(Map->Mapping);
+        CloseHandle(Map->File);
+        return false;
+    }
+#else
+    Map->File = open(FileName, Write? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+    if (Map->File < 0)
+    {
+        return false;
+    }
+
+    struct stat Stat;
+    bool Sized = Write? ftruncate(Map->File, (off_t)Size) == 0 :
+        (fstat(Map->File, &Stat) == 0 && Stat.st_size > 0 && (Size = (size_t)Stat.st_size) > 0);
+
+    void *Data = Sized? mmap(NULL, Size, Write? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, Map->File, 0) : MAP_FAILED;
+    if (Data == MAP_FAILED)
+    {
+        close(Map->File);
+        return false;
+    }
+    Map->Data = Data;
+#endif
+
+    Map->Size = Size;
+    return true;
+}
+
+static void Snapshot_Unmap(snapshot_map *Map)
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(Map->Data);
+    CloseHandle(Map->Mapping);
+    CloseHandle(Map->File);
+#else
+    munmap(Map->Data, Map->Size);
+    close(Map->File);
+#endif
+}
@@ -0,0 +1,83 @@
+/*******************************************************************************************
+*
+*   Nettis core - packed game state
+*
+*   A snapshot is everything a standard board game needs to go on exactly as it would have,
+*   in a few hundred bytes with no pointers: pieces and power in 4 bits per cell, traces as
+*   byte cell indices and timers as the ticks they have left. Copying one around is a plain
+*   memcpy, for bots, rollback and undo; taking and restoring one packs and unpacks the game.
+*
+*   What the game derives from the board is left out and rebuilt when needed: the network
+*   index, board versions (restored ones are always new) and the last settle's Falls. While a
+*   chain is played back the snapshot keeps the state it was resolved from. Restored into a
+*   game that still holds that chain, as rollback does, only its events are played again up
+*   to the snapshot tick; into any other game the chain is resolved again, as long as the
+*   lock that set it off took.
+*
+*   Files hold an array of snapshots in native byte order behind a small header, written and
+*   read through a memory-mapped file
+*
+********************************************************************************************/
+
+#ifndef NETTIS_SNAPSHOT_H
+#define NETTIS_SNAPSHOT_H
+
+#include "gameplay.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define SNAPSHOT_CELL_BYTES ((BOARD_CELLS + 1)/2)
+
+// Snapshot flags
+#define SNAPSHOT_POWER_CURRENT  (1<<0)   // Powers and Trace match the board
+#define SNAPSHOT_JUNK_CURRENT   (1<<1)   // TraceJunk matches the board
+#define SNAPSHOT_CASCADE        (1<<2)   // Resolution state is the origin of the chain under way
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    int8_t x, y;
+    uint8_t Pieces;                         // First piece in the low 4 bits
+    uint8_t Orientation;
+} snapshot_brick;
+
+typedef struct {
+    uint64_t Rng;                           // Brick queue generator
+    uint64_t Touched[2];                    // Cells changed since the last evaluation
+    uint32_t Tick;
+    uint32_t Start;                         // Tick the resolution state is from
+    int32_t Score;
+    uint16_t NodeChain;
+    uint16_t WireChain;
+    uint16_t Multiplier;
+    uint16_t GravityLeft;                   // Ticks left on each timer
+    uint16_t TraceLeft;
+    uint16_t JunkLeft;
+    uint16_t JunkPending;
+    uint8_t Flags;
+    uint8_t TraceIndex;
+    uint8_t TraceCount;
+    uint8_t TraceJunkIndex;
+    uint8_t TraceJunkCount;
+    uint8_t QueueHead;
+    uint8_t QueueCount;
+    uint8_t Cells[SNAPSHOT_CELL_BYTES];     // Two cells per byte, the even one low
+    uint8_t Powers[SNAPSHOT_CELL_BYTES];    // Incoming ends, packed like Cells
+    uint8_t Trace[TRACE_CAPACITY];
+    uint8_t TraceJunk[TRACE_CAPACITY];
+    snapshot_brick Brick;
+    snapshot_brick Queue[BRICK_QUEUE_SIZE];
+} snapshot;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Snapshot_Take(snapshot *Snapshot, gameplay *Gameplay);         // False for a game on a field
+void Snapshot_Restore(snapshot *Snapshot, gameplay *Gameplay);      // Into a game with the same rules
+
+bool Snapshot_Save(const snapshot *Snapshots, int Count, const char *FileName);
+int Snapshot_Load(snapshot *Snapshots, int Capacity, const char *FileName);    // Count read, -1 on error
+
+#endif // NETTIS_SNAPSHOT_H
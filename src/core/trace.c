@@ -0,0 +1,336 @@
+/*******************************************************************************************
+*
+*   Nettis core - wire network tracing (power, junk and fire rules)
+*
+********************************************************************************************/
+
+#include "trace.h"
+
+#include <stddef.h>
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+void Trace_Clear(trace *Trace)
+{
+    Trace->Mask = (bitboard){ 0 };
+    Trace->Count = 0;
+    Trace->OpenConns = 0;
+    Trace->Junk = false;
+}
+
+bool Trace_Contains(trace *Trace, int x, int y)
+{
+    return BB_Test(Trace->Mask, BOARD_INDEX(x, y));
+}
+
+// Drops the wires that are not powered from every end, keeping the order of the rest
+void Board_TraceFilter(board *Board, trace *Trace, power_board *Powers)
+{
+    int Count = 0;
+
+    for (int i = 0; i < Trace->Count; i++)
+    {
+        int Cell = Trace->Cells[i];
+        int x = Cell % BOARD_WIDTH, y = Cell / BOARD_WIDTH;
+        piece Piece = Board_GetTile(Board, x, y);
+
+        if (Piece_IsConnectionType(Piece))
+        {
+            unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+            if ((Powers->Incoming[y][x] & DirFrom) != DirFrom)
+            {
+                Trace->Mask = BB_AndNot(Trace->Mask, BB_Cell(Cell));
+                continue;
+            }
+        }
+
+        Trace->Cells[Count++] = (unsigned char)Cell;
+    }
+
+    Trace->Count = (unsigned char)Count;
+}
+
+// Size Board_TraceFilter() would leave of a power trace over Cells, without building it
+static int Trace_CountPowered(board *Board, bitboard Cells, power_board *Powers)
+{
+    bitboard Wires = BB_And(Cells, Board_ConnectionMask(Board));
+    int Count = BB_PopCount(BB_AndNot(Cells, Wires));
+
+    while (!BB_IsEmpty(Wires))
+    {
+        int i = BB_Lowest(Wires);
+        int x = i % BOARD_WIDTH, y = i / BOARD_WIDTH;
+        Wires = BB_AndNot(Wires, BB_Cell(i));
+
+        unsigned int DirFrom = Piece_OutgoingOrientations(Board_GetTile(Board, x, y));
+        if ((Powers->Incoming[y][x] & DirFrom) == DirFrom) Count++;
+    }
+
+    return Count;
+}
+
+// Power rule: wires carry power between matching ends, nodes never power each other directly
+bool Trace_PowerEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob)
+{
+    if (Oob)
+    {
+        return false;
+    }
+
+    if (OtherPiece == PIECE_DST && Piece == PIECE_DST)
+    {
+        return false;
+    }
+
+    unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+    unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
+
+    return (DirFrom & DirTo & (1<<Orientation)) != 0;
+}
+
+// Junk rule: follows wires only, a wire end pointing off the board marks the network as junk
+bool Trace_JunkEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob)
+{
+    unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+
+    if ((DirFrom & (1<<Orientation)) == 0)
+    {
+        return false;
+    }
+
+    if (Oob)
+    {
+        Trace->Junk = true;
+        return false;
+    }
+
+    if (OtherPiece == PIECE_DST)
+    {
+        return false;
+    }
+
+    unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
+
+    if ((DirFrom & DirTo & (1<<Orientation)) == 0)
+    {
+        if (OtherPiece == PIECE_EMPTY)
+        {
+            Trace->OpenConns++;
+        }
+        return false;
+    }
+
+    Trace->OpenConns++;
+    return true;
+}
+
+// Fire rule: burns from a fire piece along connected wires
+bool Trace_FireEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob)
+{
+    if (Oob)
+    {
+        return false;
+    }
+
+    if (Piece != PIECE_FIRE && !Piece_IsConnectionType(Piece))
+    {
+        return false;
+    }
+
+    if (!Piece_IsConnectionType(OtherPiece))
+    {
+        return false;
+    }
+
+    unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
+    unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
+
+    return (DirFrom & DirTo & (1<<Orientation)) != 0;
+}
+
+// Breadth-first traversal from (x, y), the trace itself is the frontier queue and every cell
+// is visited at most once, so the cost is linear in the size of the network.
+// Edge is asked about every neighbour of a traced cell that has not been reached on an
+// earlier level, including off-board ones. When Powers is given, every followed edge into a
+// cell of the next level records where the power came from
+void Board_TraceNetwork(board *Board, int x, int y, trace_edge Edge, power_board *Powers, trace *Trace)
+{
+    Trace_Clear(Trace);
+    Trace->Count = 1;
+    Trace->Cells[0] = (unsigned char)BOARD_INDEX(x, y);
+
+    bitboard Visited = BB_Cell(BOARD_INDEX(x, y));
+    bitboard NextLevel = { 0 };
+    int LevelEnd = 1;
+
+    for (int Head = 0; Head < Trace->Count; Head++)
+    {
+        if (Head == LevelEnd)
+        {
+            NextLevel = (bitboard){ 0 };
+            LevelEnd = Trace->Count;
+        }
+
+        int cx = Trace->Cells[Head] % BOARD_WIDTH;
+        int cy = Trace->Cells[Head] / BOARD_WIDTH;
+        piece Piece = Board_GetTile(Board, cx, cy);
+
+        struct {
+            int x, y;
+            orientation Orientation;
+        } Positions[4] = {
+            { cx-1, cy, LEFT },
+            { cx+1, cy, RIGHT },
+            { cx, cy-1, UP },
+            { cx, cy+1, DOWN },
+        };
+
+        for (int i = 0; i < 4; i++) {
+            int nx = Positions[i].x;
+            int ny = Positions[i].y;
+
+            if (Board_IsOob(Board, nx, ny))
+            {
+                Edge(Trace, Piece, PIECE_EMPTY, Positions[i].Orientation, true);
+                continue;
+            }
+
+            bitboard Cell = BB_Cell(BOARD_INDEX(nx, ny));
+            bool Seen = !BB_IsEmpty(BB_And(Visited, Cell));
+
+            if (Seen && BB_IsEmpty(BB_And(NextLevel, Cell)))
+            {
+                continue;
+            }
+
+            if (!Edge(Trace, Piece, Board_GetTile(Board, nx, ny), Positions[i].Orientation, false))
+            {
+                continue;
+            }
+
+            if (Powers != NULL)
+            {
+                Powers->Incoming[ny][nx] |= 1<<Orientation_Flip(Positions[i].Orientation);
+            }
+
+            if (Seen || Trace->Count >= TRACE_CAPACITY)
+            {
+                continue;
+            }
+
+            Visited = BB_Or(Visited, Cell);
+            NextLevel = BB_Or(NextLevel, Cell);
+            Trace->Cells[Trace->Count++] = (unsigned char)BOARD_INDEX(nx, ny);
+        }
+    }
+
+    Trace->Mask = Visited;
+}
+
+void Board_Trace(board *Board, int x, int y, power_board *Powers, trace *Trace)
+{
+    Board_TraceNetwork(Board, x, y, Trace_PowerEdge, Powers, Trace);
+}
+
+void Board_TraceJunk(board *Board, int x, int y, trace *Trace)
+{
+    Board_TraceNetwork(Board, x, y, Trace_JunkEdge, NULL, Trace);
+}
+
+void Board_TraceFire(board *Board, int x, int y, trace *Trace)
+{
+    Board_TraceNetwork(Board, x, y, Trace_FireEdge, NULL, Trace);
+}
+
+// Shared by Board_GetTrace() and Board_GetTraceIn(), only nodes and fires in Region are used.
+// Trace doubles as the scratch buffer of every traversal
+static void Trace_FindCircuit(board *Board, power_board *Powers, bitboard Region, trace *Trace)
+{
+    struct {
+        int Node;
+        bitboard Cells;
+    } Circuits[BOARD_CELLS];
+    int CircuitCount = 0;
+    bitboard Traced = { 0 };
+
+    bitboard Sources = BB_And(BB_Or(Board->Planes[PIECE_FIRE], Board->Planes[PIECE_DST]), Region);
+    while (!BB_IsEmpty(Sources))
+    {
+        int i = BB_Lowest(Sources);
+        int x = i % BOARD_WIDTH, y = i / BOARD_WIDTH;
+        Sources = BB_AndNot(Sources, BB_Cell(i));
+
+        if (BB_Test(Board->Planes[PIECE_FIRE], i))
+        {
+            Board_TraceFire(Board, x, y, Trace);
+            if (Trace->Count > 1) return;
+            continue;
+        }
+
+        Board_TraceNetwork(Board, x, y, Trace_PowerEdge, Powers, Trace);
+
+        if (!BB_Test(Traced, i) && Trace->Count > 1)
+        {
+            Circuits[CircuitCount].Node = i;
+            Circuits[CircuitCount].Cells = Trace->Mask;
+            CircuitCount++;
+        }
+        Traced = BB_Or(Traced, Trace->Mask);
+    }
+
+    for (int c = 0; c < CircuitCount; c++)
+    {
+        if (Trace_CountPowered(Board, Circuits[c].Cells, Powers) > 1)
+        {
+            int i = Circuits[c].Node;
+            Board_Trace(Board, i % BOARD_WIDTH, i / BOARD_WIDTH, NULL, Trace);
+            Board_TraceFilter(Board, Trace, Powers);
+            return;
+        }
+    }
+
+    Trace_Clear(Trace);
+}
+
+// Propagates power from every node into Powers and fills Trace with the first circuit to
+// clear, or a fire trace when a fire touches a wire first. Each node is traced once: the first
+// node of every network remembers the cells it reached, and only the circuit that gets cleared
+// is traced again, for its clearing order
+void Board_GetTrace(board *Board, power_board *Powers, trace *Trace)
+{
+    Trace_FindCircuit(Board, Powers, BOARD_MASK_FULL, Trace);
+}
+
+// Board_GetTrace() limited to the nodes and fires inside Region, which has to hold whole power
+// networks. Powers outside Region are kept, inside it they are recomputed
+void Board_GetTraceIn(board *Board, power_board *Powers, bitboard Region, trace *Trace)
+{
+    bitboard Cells = BB_And(Region, BOARD_MASK_FULL);
+    while (!BB_IsEmpty(Cells))
+    {
+        int i = BB_Lowest(Cells);
+        Cells = BB_AndNot(Cells, BB_Cell(i));
+        Powers->Incoming[i / BOARD_WIDTH][i % BOARD_WIDTH] = 0;
+    }
+
+    Trace_FindCircuit(Board, Powers, Region, Trace);
+}
+
+// Every wire of a network reaches the same cells and finds the same junk, so each network is
+// traced once, from its first wire
+void Board_GetTraceJunk(board *Board, trace *Trace)
+{
+    bitboard Wires = Board_ConnectionMask(Board);
+    while (!BB_IsEmpty(Wires))
+    {
+        int i = BB_Lowest(Wires);
+
+        Board_TraceJunk(Board, i % BOARD_WIDTH, i / BOARD_WIDTH, Trace);
+        if (Trace->Junk) return;
+        Wires = BB_AndNot(Wires, BB_Or(Trace->Mask, BB_Cell(i)));
+        // if (Trace->OpenConns < 2) return;
+    }
+
+    Trace_Clear(Trace);
+}
@@ -0,0 +1,56 @@
+/*******************************************************************************************
+*
+*   Nettis core - wire network tracing (power, junk and fire rules)
+*
+********************************************************************************************/
+
+#ifndef NETTIS_TRACE_H
+#define NETTIS_TRACE_H
+
+#include "board.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define TRACE_CAPACITY (BOARD_HEIGHT*BOARD_WIDTH)
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    unsigned int Incoming[BOARD_HEIGHT][BOARD_WIDTH];
+} power_board;
+
+// Traces are filled in place by the functions below, never returned by value
+typedef struct {
+    bitboard Mask;                          // Every cell in Cells
+    unsigned char Cells[TRACE_CAPACITY];    // Cell indices (BOARD_INDEX) in traversal order
+    unsigned char Count;
+    unsigned short OpenConns;
+    bool Junk;
+} trace;
+
+// Rule deciding whether a network continues from Piece into its neighbour in direction
+// Orientation. Oob is set when that neighbour is off the board
+typedef bool (*trace_edge)(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob);
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void Trace_Clear(trace *Trace);
+bool Trace_Contains(trace *Trace, int x, int y);
+void Board_TraceFilter(board *Board, trace *Trace, power_board *Powers);
+void Board_TraceNetwork(board *Board, int x, int y, trace_edge Edge, power_board *Powers, trace *Trace);
+void Board_Trace(board *Board, int x, int y, power_board *Powers, trace *Trace);
+void Board_TraceJunk(board *Board, int x, int y, trace *Trace);
+void Board_TraceFire(board *Board, int x, int y, trace *Trace);
+void Board_GetTrace(board *Board, power_board *Powers, trace *Trace);
+void Board_GetTraceIn(board *Board, power_board *Powers, bitboard Region, trace *Trace);
+void Board_GetTraceJunk(board *Board, trace *Trace);
+
+// The trace_edge rules of the traces above, for traversals over other storage
+bool Trace_PowerEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob);
+bool Trace_JunkEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob);
+bool Trace_FireEdge(trace *Trace, piece Piece, piece OtherPiece, orientation Orientation, bool Oob);
+
+#endif // NETTIS_TRACE_H
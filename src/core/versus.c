@@ -0,0 +1,232 @@
+/*******************************************************************************************
+*
+*   Nettis core - two player versus with rollback
+*
+********************************************************************************************/
+
+#include "versus.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define VERSUS_SLOT(Frame) ((Frame) & (VERSUS_RING - 1))
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static void Versus_Play(versus *Versus);
+static void Versus_Save(versus_match *Match, versus_save *Save);
+static void Versus_Load(versus_match *Match, versus_save *Save, unsigned int Frame);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+void Versus_MatchInit(versus_match *Match, uint64_t Seed)
+{
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        GP_Init(&Match->Games[p], Seed);
+    }
+    Match->Tally = (versus_tally){ 0 };
+    Match->Frame = 0;
+}
+
+// Junk scored on a tick is sent once both games ran it, neither player goes first
+void Versus_MatchStep(versus_match *Match, const unsigned int *Inputs)
+{
+    versus_tally *Tally = &Match->Tally;
+    int Junk[VERSUS_PLAYERS];
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        GP_Update(&Match->Games[p], Inputs[p]);
+    }
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        // A lost game starts over with the score reset
+        int Score = Match->Games[p].Scoring.Score;
+        if (Score < Tally->LastScore[p])
+        {
+            Tally->Losses[p]++;
+            Tally->Points[p] = 0;
+        }
+        else
+        {
+            Tally->Points[p] += Score - Tally->LastScore[p];
+        }
+        Tally->LastScore[p] = Score;
+
+        Junk[p] = Tally->Points[p]/VERSUS_JUNK_POINTS;
+        Tally->Points[p] -= Junk[p]*VERSUS_JUNK_POINTS;
+        Tally->Sent[p] += Junk[p];
+    }
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        GP_AddJunk(&Match->Games[p], Junk[VERSUS_PLAYERS - 1 - p]);
+    }
+    Match->Frame++;
+}
+
+uint64_t Versus_MatchHash(versus_match *Match)
+{
+    uint64_t Hash = Match->Frame;
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Hash = (Hash ^ GP_Hash(&Match->Games[p]))*0x100000001B3ULL;
+        Hash = (Hash ^ (uint64_t)(unsigned int)Match->Tally.Points[p])*0x100000001B3ULL;
+        Hash ^= Hash >> 29;
+    }
+
+    return Hash;
+}
+
+void Versus_Init(versus *Versus, uint64_t Seed, int Local)
+{
+    *Versus = (versus){ 0 };
+    Versus->Local = Local;
+    Versus_MatchInit(&Versus->Match, Seed);
+}
+
+// Restores the frame a wrong prediction was made for and plays every frame since again
+void Versus_Sync(versus *Versus)
+{
+    versus_match *Match = &Versus->Match;
+
+    if (!Versus->Mispredicted)
+    {
+        return;
+    }
+
+    unsigned int Present = Match->Frame;
+    unsigned int Frames = Present - Versus->Rollback;
+
+    Versus_Load(Match, &Versus->Saves[VERSUS_SLOT(Versus->Rollback)], Versus->Rollback);
+    while (Match->Frame < Present)
+    {
+        Versus_Play(Versus);
+    }
+
+    Versus->Mispredicted = false;
+    Versus->Rollbacks++;
+    Versus->Replayed += Frames;
+    if (Frames > Versus->Deepest) Versus->Deepest = Frames;
+}
+
+// A pending rollback is done first, even when no new frame can be played
+bool Versus_Advance(versus *Versus, unsigned int Input)
+{
+    versus_match *Match = &Versus->Match;
+    Versus_Sync(Versus);
+
+    if (Match->Frame >= Versus->Received + VERSUS_MAX_ROLLBACK)
+    {
+        return false;
+    }
+
+    uint8_t *Inputs = Versus->Inputs[VERSUS_SLOT(Match->Frame)];
+    Inputs[Versus->Local] = (uint8_t)Input;
+    if (Match->Frame >= Versus->Received) Inputs[1 - Versus->Local] = 0;
+
+    Versus_Play(Versus);
+    return true;
+}
+
+unsigned int Versus_Confirmed(versus *Versus)
+{
+    unsigned int Confirmed = (Versus->Received < Versus->Match.Frame)? Versus->Received : Versus->Match.Frame;
+    if (Versus->Mispredicted && Versus->Rollback < Confirmed) Confirmed = Versus->Rollback;
+    return Confirmed;
+}
+
+void Versus_MakePacket(versus *Versus, versus_packet *Packet)
+{
+    unsigned int Frame = Versus->Match.Frame;
+    unsigned int First = Versus->Acked;
+    if (Frame - First > VERSUS_PACKET_INPUTS) First = Frame - VERSUS_PACKET_INPUTS;
+
+    *Packet = (versus_packet){ 0 };
+    Packet->First = First;
+    Packet->Ack = Versus->Received;
+    Packet->Confirmed = Versus_Confirmed(Versus);
+    Packet->Hash = (Packet->Confirmed > 0)? Versus->Hashes[VERSUS_SLOT(Packet->Confirmed - 1)] : 0;
+    Packet->Count = Frame - First;
+    for (unsigned int i = 0; i < Packet->Count; i++)
+    {
+        Packet->Inputs[i] = Versus->Inputs[VERSUS_SLOT(First + i)][Versus->Local];
+    }
+}
+
+// Packets can come late, twice or not at all, only inputs following the ones already
+// received are taken
+void Versus_ReadPacket(versus *Versus, const versus_packet *Packet)
+{
+    versus_match *Match = &Versus->Match;
+    int Remote = 1 - Versus->Local;
+
+    if (Packet->Ack > Versus->Acked && Packet->Ack <= Match->Frame) Versus->Acked = Packet->Ack;
+
+    unsigned int Count = (Packet->Count < VERSUS_PACKET_INPUTS)? Packet->Count : VERSUS_PACKET_INPUTS;
+    for (unsigned int i = 0; i < Count; i++)
+    {
+        unsigned int Frame = Packet->First + i;
+        if (Frame != Versus->Received || Frame >= Match->Frame + VERSUS_MAX_ROLLBACK) continue;
+
+        uint8_t *Inputs = Versus->Inputs[VERSUS_SLOT(Frame)];
+        if (Frame < Match->Frame && Inputs[Remote] != Packet->Inputs[i] &&
+            (!Versus->Mispredicted || Frame < Versus->Rollback))
+        {
+            Versus->Rollback = Frame;
+            Versus->Mispredicted = true;
+        }
+        Inputs[Remote] = Packet->Inputs[i];
+        Versus->Received++;
+    }
+
+    // Only frames both sides confirmed and still kept here can be compared
+    unsigned int Last = Packet->Confirmed - 1;
+    if (Packet->Confirmed > 0 && Packet->Confirmed <= Versus_Confirmed(Versus) && Match->Frame - Last <= VERSUS_RING &&
+        Versus->Hashes[VERSUS_SLOT(Last)] != Packet->Hash)
+    {
+        Versus->Desynced = true;
+    }
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static void Versus_Play(versus *Versus)
+{
+    versus_match *Match = &Versus->Match;
+    int Slot = VERSUS_SLOT(Match->Frame);
+    unsigned int Inputs[VERSUS_PLAYERS];
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Inputs[p] = Versus->Inputs[Slot][p];
+    }
+
+    Versus_Save(Match, &Versus->Saves[Slot]);
+    Versus_MatchStep(Match, Inputs);
+    Versus->Hashes[Slot] = Versus_MatchHash(Match);
+}
+
+static void Versus_Save(versus_match *Match, versus_save *Save)
+{
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Snapshot_Take(&Save->Games[p], &Match->Games[p]);
+    }
+    Save->Tally = Match->Tally;
+}
+
+static void Versus_Load(versus_match *Match, versus_save *Save, unsigned int Frame)
+{
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Snapshot_Restore(&Save->Games[p], &Match->Games[p]);
+    }
+    Match->Tally = Save->Tally;
+    Match->Frame = Frame;
+}
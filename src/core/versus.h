@@ -0,0 +1,102 @@
+/*******************************************************************************************
+*
+*   Nettis core - two player versus with rollback
+*
+*   A match is two games on the standard board stepped together: every VERSUS_JUNK_POINTS
+*   a player scores send a junk piece to the other, dropped when their next brick locks.
+*   A lost game starts over and the match goes on.
+*
+*   Each peer plays the whole match, its own input as it comes and the other player's as it
+*   arrives over the network. Until a remote input arrives, the player is predicted to give
+*   none, which is what most ticks are. When a prediction turns out wrong the match is
+*   restored to the frame it was made for and played again up to the present, within one
+*   call to Versus_Advance(), so the other player's moves show up late but never diverge.
+*   A peer runs at most VERSUS_MAX_ROLLBACK frames past the last remote input it has, then
+*   waits.
+*
+*   States are kept as snapshots taken at the start of every frame. Packets repeat every
+*   input the other side has not acknowledged yet, so lost ones cost nothing but a late
+*   rollback, and carry the hash of the last frame the sender played with both inputs known,
+*   so a desync is noticed within a few frames
+*
+********************************************************************************************/
+
+#ifndef NETTIS_VERSUS_H
+#define NETTIS_VERSUS_H
+
+#include "gameplay.h"
+#include "snapshot.h"
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define VERSUS_PLAYERS 2
+#define VERSUS_JUNK_POINTS 300              // Points scored per junk piece sent
+#define VERSUS_MAX_ROLLBACK 8               // Frames played on predictions at most
+#define VERSUS_RING 32                      // Frames of inputs and states kept, a power of two
+#define VERSUS_PACKET_INPUTS (2*VERSUS_MAX_ROLLBACK)    // Most inputs the other side can miss
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// What the match keeps besides the two games, per player
+typedef struct {
+    int LastScore[VERSUS_PLAYERS];
+    int Points[VERSUS_PLAYERS];             // Scored and not sent yet
+    int Sent[VERSUS_PLAYERS];               // Junk pieces sent
+    int Losses[VERSUS_PLAYERS];
+} versus_tally;
+
+typedef struct {
+    gameplay Games[VERSUS_PLAYERS];
+    versus_tally Tally;
+    unsigned int Frame;                     // Frames played, the tick of both games
+} versus_match;
+
+typedef struct {
+    snapshot Games[VERSUS_PLAYERS];
+    versus_tally Tally;
+} versus_save;
+
+// In native byte order, like snapshot files: both peers run on the same kind of machine
+typedef struct {
+    uint32_t First;                         // Frame of Inputs[0]
+    uint32_t Ack;                           // Inputs of the receiver the sender has, for every frame before
+    uint32_t Confirmed;                     // Frames the sender played with both inputs known
+    uint32_t Count;
+    uint64_t Hash;                          // Match hash at the end of frame Confirmed - 1
+    uint8_t Inputs[VERSUS_PACKET_INPUTS];
+} versus_packet;
+
+typedef struct {
+    versus_match Match;
+    int Local;                              // Player this peer gives input for
+    uint8_t Inputs[VERSUS_RING][VERSUS_PLAYERS];
+    versus_save Saves[VERSUS_RING];         // Match at the start of each frame
+    uint64_t Hashes[VERSUS_RING];           // Match hash at the end of each frame
+    unsigned int Received;                  // Remote inputs are known for every frame before this
+    unsigned int Acked;                     // Local inputs the other side has, for every frame before
+    unsigned int Rollback;                  // First frame played on a wrong prediction
+    bool Mispredicted;
+    bool Desynced;                          // The other side hashed a confirmed frame differently
+
+    unsigned long long Rollbacks;
+    unsigned long long Replayed;            // Frames played again by rollbacks
+    unsigned int Deepest;                   // Most frames one rollback played again
+} versus;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+void Versus_MatchInit(versus_match *Match, uint64_t Seed);         // Both players get the same bricks
+void Versus_MatchStep(versus_match *Match, const unsigned int *Inputs);    // One tick, an input per player
+uint64_t Versus_MatchHash(versus_match *Match);
+
+void Versus_Init(versus *Versus, uint64_t Seed, int Local);
+bool Versus_Advance(versus *Versus, unsigned int Input);           // False while waiting for the other side
+void Versus_Sync(versus *Versus);                                  // Rolls back now if a prediction was wrong
+unsigned int Versus_Confirmed(versus *Versus);                     // Frames played with both inputs known
+void Versus_MakePacket(versus *Versus, versus_packet *Packet);
+void Versus_ReadPacket(versus *Versus, const versus_packet *Packet);
+
+#endif // NETTIS_VERSUS_H
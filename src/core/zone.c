@@ -0,0 +1,142 @@
+/*******************************************************************************************
+*
+*   Nettis core - instrumentation zones
+*
+********************************************************************************************/
+
+#include "zone.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+    #define ZONE_THREAD __declspec(thread)
+#else
+    #define ZONE_THREAD __thread
+#endif
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+static ZONE_THREAD zone_trace *Zone_Current;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static long long Zone_First(zone_trace *Trace);
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+bool Zone_Init(zone_trace *Trace, int Capacity, double (*Clock)(void))
+{
+    *Trace = (zone_trace){ 0 };
+    Trace->Events = malloc((size_t)Capacity*sizeof(zone_event));
+    if (Trace->Events == NULL)
+    {
+        return false;
+    }
+
+    Trace->Capacity = Capacity;
+    Trace->Clock = Clock;
+    Trace->Origin = Clock();
+    return true;
+}
+
+void Zone_Free(zone_trace *Trace)
+{
+    if (Zone_Current == Trace) Zone_Current = NULL;
+    free(Trace->Events);
+    *Trace = (zone_trace){ 0 };
+}
+
+void Zone_Attach(zone_trace *Trace)
+{
+    Zone_Current = Trace;
+}
+
+int Zone_Count(zone_trace *Trace)
+{
+    return (int)(Trace->Written - Zone_First(Trace));
+}
+
+bool Zone_Save(zone_trace *Trace, const char *FileName)
+{
+    FILE *File = fopen(FileName, "w");
+    if (File == NULL)
+    {
+        return false;
+    }
+
+    fprintf(File, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (long long i = Zone_First(Trace); i < Trace->Written; i++)
+    {
+        zone_event *Event = &Trace->Events[i % Trace->Capacity];
+        fprintf(File, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}%s\n",
+            Event->Name, Event->Start*1e6, Event->Duration*1e6, (i + 1 < Trace->Written)? "," : "");
+    }
+    fprintf(File, "]}\n");
+
+    return fclose(File) == 0;
+}
+
+void Zone_Begin(const char *Name)
+{
+    zone_trace *Trace = Zone_Current;
+    if (Trace == NULL)
+    {
+        return;
+    }
+
+    if (Trace->Depth == 0) Trace->Mark = Trace->Written;
+    if (Trace->Depth < ZONE_MAX_DEPTH)
+    {
+        Trace->Names[Trace->Depth] = Name;
+        Trace->Starts[Trace->Depth] = Trace->Clock();
+    }
+    Trace->Depth++;
+}
+
+void Zone_End(void)
+{
+    zone_trace *Trace = Zone_Current;
+    if (Trace == NULL || Trace->Depth == 0)
+    {
+        return;
+    }
+
+    int Depth = --Trace->Depth;
+    if (Depth >= ZONE_MAX_DEPTH)
+    {
+        return;
+    }
+
+    double Duration = Trace->Clock() - Trace->Starts[Depth];
+    if (Depth == 0 && Duration < Trace->MinSeconds)
+    {
+        Trace->Written = Trace->Mark;
+        return;
+    }
+
+    zone_event *Event = &Trace->Events[Trace->Written % Trace->Capacity];
+    Event->Name = Trace->Names[Depth];
+    Event->Start = Trace->Starts[Depth] - Trace->Origin;
+    Event->Duration = Duration;
+    Trace->Written++;
+    if (Trace->Written > Trace->HighWater) Trace->HighWater = Trace->Written;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// Oldest event still in the ring. Slots past Written hold events of dropped zones, which may
+// have overwritten older ones
+static long long Zone_First(zone_trace *Trace)
+{
+    long long First = Trace->HighWater - Trace->Capacity;
+    if (First < 0) First = 0;
+    return (First < Trace->Written)? First : Trace->Written;
+}
@@ -0,0 +1,75 @@
+/*******************************************************************************************
+*
+*   Nettis core - instrumentation zones
+*
+*   ZONE_BEGIN() and ZONE_END() pairs mark the parts of a run worth seeing on a timeline:
+*   ticks, traces, settles, drawing. They only exist in builds with NETTIS_ZONES defined,
+*   otherwise they compile to nothing.
+*
+*   A thread records into the zone_trace it attached, other threads skip the zones. Each
+*   zone is kept as one complete event in a ring buffer, so a long run keeps its last
+*   Capacity zones. With MinSeconds set, an outermost zone shorter than that is dropped
+*   together with everything inside it, only the slow ticks or frames are left.
+*
+*   Zone_Save() writes the Chrome trace event format, which chrome://tracing and Perfetto
+*   open. Names are string literals and are written as they are
+*
+********************************************************************************************/
+
+#ifndef NETTIS_ZONE_H
+#define NETTIS_ZONE_H
+
+#include <stdbool.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define ZONE_EVENTS (1<<20)             // Default capacity, 24 MB of events
+#define ZONE_MAX_DEPTH 32               // Deeper zones are not recorded
+
+#if defined(NETTIS_ZONES)
+    #define ZONE_ENABLED 1
+    #define ZONE_BEGIN(Name) Zone_Begin(Name)
+    #define ZONE_END() Zone_End()
+#else
+    #define ZONE_ENABLED 0
+    #define ZONE_BEGIN(Name) ((void)0)
+    #define ZONE_END() ((void)0)
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    const char *Name;
+    double Start;                   // Seconds since the trace was initialized
+    double Duration;
+} zone_event;
+
+typedef struct {
+    zone_event *Events;             // Ring buffer, children before the zone they are in
+    int Capacity;
+    long long Written;              // Events recorded, Events[Written % Capacity] is the next one
+    long long HighWater;            // Most ever written, the slots after Written may be lost
+    long long Mark;                 // Written when the outermost zone began
+    double (*Clock)(void);
+    double Origin;
+    double MinSeconds;              // Outermost zones shorter than this are dropped
+    const char *Names[ZONE_MAX_DEPTH];
+    double Starts[ZONE_MAX_DEPTH];
+    int Depth;
+} zone_trace;
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+bool Zone_Init(zone_trace *Trace, int Capacity, double (*Clock)(void));
+void Zone_Free(zone_trace *Trace);
+void Zone_Attach(zone_trace *Trace);            // The calling thread records into Trace, NULL stops
+int Zone_Count(zone_trace *Trace);              // Events Zone_Save() would write
+bool Zone_Save(zone_trace *Trace, const char *FileName);
+
+void Zone_Begin(const char *Name);              // Through ZONE_BEGIN()
+void Zone_End(void);
+
+#endif // NETTIS_ZONE_H
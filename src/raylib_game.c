@@ -18,7 +18,16 @@
     #include <emscripten/emscripten.h>      // Emscripten library - LLVM to JavaScript compiler
 #endif
 
+#include "core/gameplay.h"
+#include "core/gfx.h"
+#include "core/replay.h"
+#include "core/versus.h"
+#include "core/net.h"
+#include "core/input.h"
+#include "core/zone.h"
+
 #include <stdio.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -35,12 +44,11 @@
     #define LOG(...)
 #endif
 
-#define BOARD_WIDTH 6
-#define BOARD_HEIGHT 13
+#define REPLAY_FILE "last_game.ntrp"     // Play back with nettis_replay
 
-#define PAL_BLACK BLACK
-#define PAL_WHITE WHITE
-#define PAL_GRAY GRAY
+#define SIM_TICK_SECONDS (1.0/GP_TICKS_PER_SECOND)
+#define SIM_MAX_TICKS 8                 // Catch-up limit per frame, time lost beyond it is dropped
+#define GAME_CACHE_ENTRIES 256          // Boards whose evaluation the game remembers
 
 //----------------------------------------------------------------------------------
 // Types and Structures Definition
@@ -52,79 +60,61 @@ typedef enum {
     SCREEN_ENDING
 } game_screen;
 
-typedef enum {
-    PIECE_EMPTY = 0,
-    PIECE_HCONN = 1,
-    PIECE_VCONN = 2,
-    PIECE_UL = 3,
-    PIECE_DL = 4,
-    PIECE_DR = 5,
-    PIECE_UR = 6,
-    PIECE_DST = 7,
-    PIECE_JUNK = 8,
-    PIECE_FIRE = 9,
-} piece;
-
-#define PIECE_PALLETE_SIZE 10
-
-typedef enum {
-    RIGHT = 0,
-    DOWN = 1,
-    LEFT = 2,
-    UP = 3,
-} orientation;
-
+// The rules tick at a fixed rate whatever the frame rate, see UpdateDrawFrame()
 typedef struct {
-    piece Pieces[BOARD_HEIGHT][BOARD_WIDTH];
-} board;
+    double Accumulator;     // Seconds not simulated yet, under a tick after every frame
+    double LastTime;
+    unsigned int Input;     // Taken from the queue for the next tick, kept while a versus match waits
+    brick PrevBrick;        // Falling brick before the last tick, drawing goes from it to the current one
+} sim;
 
 typedef struct {
-    unsigned int Incoming[BOARD_HEIGHT][BOARD_WIDTH];
-} power_board;
-
-typedef struct {
-    int x, y;
-    piece Pieces[2];
-    orientation Orientation;
-} brick;
-
-typedef struct {
-    int Ys[BOARD_HEIGHT*BOARD_WIDTH];
-    int Xs[BOARD_HEIGHT*BOARD_WIDTH];
-    int Count;
-    int OpenConns;
-    bool Junk;
-} trace;
+    gameplay Gameplay;
+    replay Replay;          // Every input of this session, saved on exit
+    sim Sim;
+    input_queue Input;      // Key presses and releases since the ticks last took them
+    trace_cache Cache;      // Chains resolved again after a late lock are mostly lookups
+    versus *Versus;         // Set in a versus match, played instead of Gameplay
+    net_socket Socket;
+    int RemotePort;
+} game;
 
-typedef struct {
-    float Start;
-    float Duration;
-} timer;
+typedef enum {
+    GFX_SPRITE_PIECE = 0,               // The piece alone, for the HUD and the falling brick
+    GFX_SPRITE_CELL,                    // A board cell: grid square and piece
+    GFX_SPRITE_POWERED,                 // A board cell whose wires carry power
+    GFX_SPRITE_KINDS
+} gfx_sprite;
 
+// Drawing retained in a render texture, only re-rendered when one of its keys changes
 typedef struct {
-    int Score;
-    int NodeChain;
-    int WireChain;
-    int Multiplier;
-} scoring;
+    RenderTexture2D Target;
+    unsigned int Key[2];
+    bool Ready;
+} gfx_layer;
 
-typedef struct {
-    power_board Powers;
-    board Board;
-    brick Brick;
-    trace Trace;
-    trace TraceJunk;
-    timer TimerGravity;
-    timer TimerTrace;
-    int   TraceIndex;
-    timer TimerJunk;
-    int   TraceJunkIndex;
-    scoring Scoring;
-} gameplay;
+// Frame phases timed by the profiler overlay. Power, junk and settle happen inside GP_Update
+typedef enum {
+    PROF_UPDATE = 0,
+    PROF_POWER,
+    PROF_JUNK,
+    PROF_SETTLE,
+    PROF_DRAW,                          // Layers, board and HUD
+    PROF_PRESENT,                       // EndDrawing(), waiting for the frame rate included
+    PROF_FRAME,                         // End of the previous frame to the end of this one
+    PROF_PHASES
+} prof_phase;
+
+#define PROF_HISTORY 512                // Frames kept, about 8 seconds at 60 fps
+#define PROF_BUCKETS 16                 // Histogram buckets, doubling from 1 us
 
 typedef struct {
-    gameplay Gameplay;
-} game;
+    float Ms[PROF_HISTORY][PROF_PHASES];    // Ring buffer, Head is the oldest frame once full
+    int Head;
+    int Count;
+    double LastEnd;
+    bool Visible;
+} profiler;
 
 // TODO: Define your custom data types here
 
@@ -133,7 +123,31 @@ typedef struct {
 //----------------------------------------------------------------------------------
 static const int ScreenWidth = 224*3;
 static const int ScreenHeight = 256*3;
+static const int CELL_SIZE = GFX_CELL_SIZE;
 static game Game;
+static versus Versus;
+
+// Sprites baked by GFX_Init(), one row per gfx_sprite and one column per piece. They sit one pixel
+// further apart than CELL_SIZE so that filtering never bleeds a neighbour in
+#define GFX_ATLAS_PITCH (CELL_SIZE + 1)
+static RenderTexture2D Atlas;
+
+// Board layers leave room for the outline drawn one pixel outside the cells
+#define GFX_LAYER_MARGIN 1
+static gfx_layer GridLayer;             // Empty cells and outline, never changes
+static gfx_layer BoardLayer;            // Settled pieces and power, keyed on the board and power versions
+static gfx_layer HudLayer;              // Score, next brick and legend, keyed on the score and next brick
+
+// Drawing shared with the headless tools goes through raylib with this backend
+static void Raylib_Clear(void *User, gfx_color Tint);
+static void Raylib_Rect(void *User, int x, int y, int Width, int Height, gfx_color Tint);
+static void Raylib_Line(void *User, float x0, float y0, float x1, float y1, float Thickness, gfx_color Tint);
+static void Raylib_Text(void *User, const char *Text, int x, int y, int Size, gfx_color Tint);
+static const gfx_backend RAYLIB_BACKEND = { Raylib_Clear, Raylib_Rect, Raylib_Line, Raylib_Text };
+static gfx Gfx = { &RAYLIB_BACKEND, NULL, 0, 0 };
+
+static profiler Profiler;               // Always recording, F3 shows it
+static zone_trace Trace;                // Frames and what they spent time on, with --trace
 
 // TODO: Define global variables here, recommended to make them static
 
@@ -141,30 +155,116 @@ static game Game;
 // Module Functions Declaration
 //----------------------------------------------------------------------------------
 static void UpdateDrawFrame(void);      // Update and Draw one frame
-static void GFX_DrawBoard(power_board *Powers, board *board);
-void GP_Update(gameplay *Gameplay);
-void GFX_DrawBoardAndBricks(power_board *Powers, board *Board, brick *Brick);
-brick Brick_Random(void);
-void GFX_DrawPiece(piece Piece, int x, int y);
+static void PollInput(double Now);      // Queue key presses and releases as GP_INPUT_* flags
+static bool UpdateVersus(unsigned int Input);
+static gameplay *ShownGame(void);
+static void GFX_Init(void);
+static void GFX_Close(void);
+static void GFX_DrawSettled(power_board *Powers, board *board);
+static void GFX_DrawSprite(gfx_sprite Sprite, piece Piece, int x, int y);
+static void GFX_DrawSpriteAt(gfx_sprite Sprite, piece Piece, Vector2 Position);
+static Vector2 GFX_BrickLag(brick *From, brick *To, float Alpha);
+static void GFX_UpdateLayers(gameplay *Gameplay);
+static void GFX_DrawLayer(gfx_layer *Layer, float x, float y, float Scale);
+static void GFX_DrawBoardLayers(board *Board, brick *Brick, Vector2 Lag);
+static void GFX_DrawGrid(void);
+static void GFX_DrawField(field *Field, brick *Brick, Vector2 Lag, int FirstRow, int RowCount);
+static void Prof_Record(profiler *Profiler, const double Seconds[PROF_PHASES]);
+static void Prof_Draw(profiler *Profiler, int x, int y);
 
 //------------------------------------------------------------------------------------
 // Program main entry point
 //------------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char **argv)
 {
 #if !defined(_DEBUG)
     SetTraceLogLevel(LOG_NONE);         // Disable raylib trace log messages
 #endif
 
-    Game.Gameplay.Brick = Brick_Random();
+    // --size WxH plays on a board of any size up to FIELD_MAX_WIDTH x FIELD_MAX_HEIGHT
+    // --fps N caps the frame rate, 0 draws as fast as possible. The game runs at the same speed
+    // --versus PORT REMOTE PLAYER plays player 1 or 2 of a versus match from port PORT against
+    // the game on port REMOTE, or through a nettis_versus proxy listening there. Both games
+    // must be started with the same --seed N, 1 when neither gives one
+    // --das MS and --arr MS set how long a key is held before it repeats and how often it does
+    // --trace FILE writes the zones of the last frames as a Chrome trace on exit, in builds with
+    // NETTIS_ZONES. --trace-slow MS only keeps the frames that took at least that long
+    gp_rules Rules = GP_DefaultRules();
+    input_config InputConfig = Input_DefaultConfig();
+    int TargetFps = 60;
+    int VersusPort = -1, Player = 1;
+    bool Seeded = false;
+    uint64_t Seed = 0;
+    const char *TraceFile = NULL;
+    double TraceSlow = 0.0;
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--size") == 0) sscanf(argv[++i], "%ix%i", &Rules.Width, &Rules.Height);
+        else if (strcmp(argv[i], "--fps") == 0) TargetFps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--das") == 0) InputConfig.Das = atof(argv[++i])/1000.0;
+        else if (strcmp(argv[i], "--arr") == 0) InputConfig.Arr = atof(argv[++i])/1000.0;
+        else if (strcmp(argv[i], "--trace") == 0) TraceFile = argv[++i];
+        else if (strcmp(argv[i], "--trace-slow") == 0) TraceSlow = atof(argv[++i])/1000.0;
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            char *End = NULL;
+            Seed = strtoull(argv[++i], &End, 10);
+            Seeded = (End != argv[i]) && (*End == '\0');
+            if (!Seeded) LOG("Bad seed %s, ignored\n", argv[i]);
+        }
+        else if (strcmp(argv[i], "--versus") == 0 && i + 3 < argc)
+        {
+            VersusPort = atoi(argv[++i]);
+            Game.RemotePort = atoi(argv[++i]);
+            Player = atoi(argv[++i]);
+        }
+    }
+
+    if (!Seeded) Seed = (uint64_t)time(NULL);
+    if (!GP_InitRules(&Game.Gameplay, Seed, &Rules))
+    {
+        LOG("Cannot play on a %ix%i board, playing on the standard one\n", Rules.Width, Rules.Height);
+        GP_Init(&Game.Gameplay, Seed);
+    }
+    Game.Gameplay.Timing.Clock = GetTime;
+    if (Cache_Init(&Game.Cache, GAME_CACHE_ENTRIES)) Game.Gameplay.Cache = &Game.Cache;
+    Replay_Begin(&Game.Replay, Seed);
+    Input_Init(&Game.Input, &InputConfig);
+
+    // Both ends agree on the seed without a handshake, so it has to come from the command line:
+    // behind a proxy each game only knows its own port and the proxy's
+    if (VersusPort >= 0)
+    {
+        if (Net_Open(&Game.Socket, VersusPort))
+        {
+            int Local = (Player == 2)? 1 : 0;
+            Versus_Init(&Versus, Seeded? Seed : 1, Local);
+            Versus.Match.Games[Local].Timing.Clock = GetTime;
+            Game.Versus = &Versus;
+        }
+        else LOG("Cannot open port %i, playing alone\n", VersusPort);
+    }
+    Game.Sim.PrevBrick = ShownGame()->Brick;
     // Initialization
     //--------------------------------------------------------------------------------------
     InitWindow(ScreenWidth, ScreenHeight, "Nettis");
+    if (TraceFile != NULL)
+    {
+        if (!ZONE_ENABLED) LOG("Built without NETTIS_ZONES, %s will be empty\n", TraceFile);
+        if (Zone_Init(&Trace, ZONE_EVENTS, GetTime))
+        {
+            Trace.MinSeconds = TraceSlow;
+            Zone_Attach(&Trace);
+        }
+        else TraceFile = NULL;
+    }
+    GFX_Init();
+    Game.Sim.LastTime = GetTime();
 
 #if defined(PLATFORM_WEB)
-    emscripten_set_main_loop(UpdateDrawFrame, 60, 1);
+    emscripten_set_main_loop(UpdateDrawFrame, 0, 1);   // At the browser's refresh rate
 #else
-    SetTargetFPS(60);     // Set our game frames-per-second
+    SetTargetFPS(TargetFps);     // Set our game frames-per-second
     //--------------------------------------------------------------------------------------
 
     // Main game loop
@@ -174,6 +274,16 @@ int main(void)
     }
 #endif
     // TODO: Unload all loaded resources at this point
+    // Replays only hold the seed, so they can only be played back on the standard board
+    Replay_Finish(&Game.Replay, &Game.Gameplay);
+    if (Game.Versus == NULL && !GP_IsField(&Game.Gameplay) && !Replay_Save(&Game.Replay, REPLAY_FILE)) LOG("Could not save %s\n", REPLAY_FILE);
+    Replay_Free(&Game.Replay);
+    GP_Free(&Game.Gameplay);
+    Net_Close(&Game.Socket);
+    Cache_Free(&Game.Cache);
+    GFX_Close();
+    if (TraceFile != NULL && !Zone_Save(&Trace, TraceFile)) LOG("Could not save %s\n", TraceFile);
+    Zone_Free(&Trace);
 
     CloseWindow();        // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
@@ -187,1008 +297,492 @@ int main(void)
 // Update and draw frame
 void UpdateDrawFrame(void)
 {
-    GP_Update(&Game.Gameplay);
+    ZONE_BEGIN("UpdateDrawFrame");
+    double Seconds[PROF_PHASES] = { 0 };
+    gameplay *Gameplay = ShownGame();
+    if (IsKeyPressed(KEY_F3)) Profiler.Visible = !Profiler.Visible;
+
+    // Runs every tick due by now. After a stall of more than SIM_MAX_TICKS the rest is dropped,
+    // the game pauses for that long instead of fast-forwarding
+    double Start = GetTime();
+    Game.Sim.Accumulator += Start - Game.Sim.LastTime;
+    Game.Sim.LastTime = Start;
+    PollInput(Start);
+
+    // A versus match waiting for the other side drops the time like a stall
+    for (int Ticks = 0; Game.Sim.Accumulator >= SIM_TICK_SECONDS && Ticks < SIM_MAX_TICKS; Ticks++)
+    {
+        // A tick takes the input seen up to a tick after it came due, the one it is drawn over,
+        // so what this frame saw reaches its last tick and the ticks of a stall share it by time
+        double Until = Start - Game.Sim.Accumulator + 2*SIM_TICK_SECONDS;
+        Game.Sim.Input = Input_Take(&Game.Input, Until, Game.Sim.Input);
+
+        brick PrevBrick = Gameplay->Brick;
+        if (Game.Versus != NULL)
+        {
+            if (!UpdateVersus(Game.Sim.Input)) break;
+        }
+        else
+        {
+            Replay_Record(&Game.Replay, Game.Sim.Input);
+            GP_Update(Gameplay, Game.Sim.Input);
+        }
+        Game.Sim.PrevBrick = PrevBrick;
+        Game.Sim.Input = 0;
+        Game.Sim.Accumulator -= SIM_TICK_SECONDS;
+    }
+    if (Game.Sim.Accumulator >= SIM_TICK_SECONDS) Game.Sim.Accumulator = fmod(Game.Sim.Accumulator, SIM_TICK_SECONDS);
+    Seconds[PROF_UPDATE] = GetTime() - Start;
+
+    // Drawn where the brick is between the last two ticks, a tick behind at most
+    float Alpha = (float)(Game.Sim.Accumulator/SIM_TICK_SECONDS);
+    Vector2 Lag = GFX_BrickLag(&Game.Sim.PrevBrick, &Gameplay->Brick, Alpha);
+    Seconds[PROF_POWER] = Gameplay->Timing.Seconds[GP_PHASE_POWER];
+    Seconds[PROF_JUNK] = Gameplay->Timing.Seconds[GP_PHASE_JUNK];
+    Seconds[PROF_SETTLE] = Gameplay->Timing.Seconds[GP_PHASE_SETTLE];
+    for (int i = 0; i < GP_PHASE_COUNT; i++) Gameplay->Timing.Seconds[i] = 0.0;
+
+    // Large boards are shrunk to leave room for the HUD, and scrolled to follow the brick
+    const int sz = CELL_SIZE-1;
+    int Width = GP_Width(Gameplay), Height = GP_Height(Gameplay);
+    float Zoom = (float)(ScreenWidth - 300)/(Width*sz);
+    if (Zoom > 3.0f) Zoom = 3.0f;
+
+    int RowCount = (int)((ScreenHeight - 100)/(sz*Zoom)) + 1;
+    int FirstRow = Gameplay->Brick.y - RowCount/3;
+    if (FirstRow > Height - RowCount) FirstRow = Height - RowCount;
+    if (FirstRow < 0) FirstRow = 0;
 
     Camera2D Camera = { 0 };
-    Camera.zoom = 3.0f;
+    Camera.zoom = Zoom;
     Camera.offset = (Vector2){ 100, 100 };
+    Camera.target = (Vector2){ 0, (float)(FirstRow*sz) };
+
+    Start = GetTime();
+    GFX_UpdateLayers(Gameplay);
 
     // Draw the texture to the screen
     BeginDrawing();
     {
         ClearBackground(BLACK);
-        Camera.offset.x = 100;
         BeginMode2D(Camera);
         {
-            GFX_DrawBoardAndBricks(&Game.Gameplay.Powers, &Game.Gameplay.Board, &Game.Gameplay.Brick);
+            if (GP_IsField(Gameplay)) GFX_DrawField(&Gameplay->Field, &Gameplay->Brick, Lag, FirstRow, RowCount);
+            else GFX_DrawBoardLayers(&Gameplay->Board, &Gameplay->Brick, Lag);
         }
         EndMode2D();
-        Camera.offset.x = 120;
-        BeginMode2D(Camera);
+        GFX_DrawLayer(&HudLayer, 100 + Width*sz*Zoom - BOARD_WIDTH*sz*3.0f + 20, 100, 3.0f);
+
+        // The other player in the margin left of the board, as this end predicts it
+        if (Game.Versus != NULL)
         {
-            DrawText(TextFormat("Score: %i", Game.Gameplay.Scoring.Score), 90, 10, 10, WHITE);
-            GFX_DrawPiece(PIECE_DST, 6, 4);
-            DrawText(TextFormat("Nodes\n\n"), 110, 62, 10, DARKGRAY); 
-            GFX_DrawPiece(PIECE_HCONN, 6, 6);
-            DrawText(TextFormat("Connections\n\n"), 110, 62+30, 10, DARKGRAY); 
-            GFX_DrawPiece(PIECE_FIRE, 6, 8);
-            DrawText(TextFormat("Fire\n\n"), 110, 62+30+30, 10, DARKGRAY); 
-            GFX_DrawPiece(PIECE_JUNK, 6, 10);
-            DrawText(TextFormat("Junk\n\n"), 110, 62+30+30+30, 10, DARKGRAY);
+            gameplay *Opponent = &Game.Versus->Match.Games[1 - Game.Versus->Local];
+            versus_tally *Tally = &Game.Versus->Match.Tally;
+            Camera2D Margin = { 0 };
+            Margin.zoom = 1.0f;
+            Margin.offset = (Vector2){ 5, 100 };
+
+            BeginMode2D(Margin);
+            GFX_DrawBoard(&Gfx, &Opponent->Powers, &Opponent->Board, &Opponent->Brick);
+            EndMode2D();
+            DrawText(TextFormat("%i", Opponent->Scoring.Score), 5, 100 + BOARD_HEIGHT*sz + 8, 10, GRAY);
+            DrawText(TextFormat("Junk %i", Gameplay->JunkPending), 5, 100 + BOARD_HEIGHT*sz + 24, 10, GRAY);
+            DrawText(TextFormat("Lost %i-%i", Tally->Losses[Game.Versus->Local], Tally->Losses[1 - Game.Versus->Local]),
+                5, 100 + BOARD_HEIGHT*sz + 40, 10, GRAY);
+            if (Game.Versus->Desynced) DrawText("DESYNC", 5, 100 + BOARD_HEIGHT*sz + 56, 10, RED);
         }
-        EndMode2D();
+        Seconds[PROF_DRAW] = GetTime() - Start;
+
+        if (Profiler.Visible) Prof_Draw(&Profiler, 10, ScreenHeight - 240);
     }
+    Start = GetTime();
+    ZONE_BEGIN("EndDrawing");
     EndDrawing();
-}
-
-timer Timer_Make(float Duration)
-{
-    timer NewTimer;
-    NewTimer.Start = GetTime();
-    NewTimer.Duration = Duration;
-    return NewTimer;
-}
+    ZONE_END();
 
-bool Timer_IsExpired(timer *Timer)
-{
-    return GetTime() > Timer->Start + Timer->Duration;  
+    double End = GetTime();
+    Seconds[PROF_PRESENT] = End - Start;
+    Seconds[PROF_FRAME] = (Profiler.LastEnd > 0.0)? End - Profiler.LastEnd : 0.0;
+    Profiler.LastEnd = End;
+    Prof_Record(&Profiler, Seconds);
+    ZONE_END();
 }
 
-bool Trace_Contains(trace *Trace, int x, int y)
+// Plays the next frame of the match, false while the other side is too far behind. Every
+// call sends a packet, waiting ones included, so the other side never waits on this one
+bool UpdateVersus(unsigned int Input)
 {
-    for (int i = 0; i < Trace->Count; i++)
+    versus_packet Packet;
+    while (Net_Receive(&Game.Socket, &Packet, sizeof(Packet), NULL) == sizeof(Packet))
     {
-        if (Trace->Xs[i] == x && Trace->Ys[i] == y)
-        {
-            return true;
-        }
+        Versus_ReadPacket(Game.Versus, &Packet);
     }
 
-    return false;
-}
+    bool Played = Versus_Advance(Game.Versus, Input);
 
-orientation Orientation_Flip(orientation Orientation)
-{
-    switch (Orientation)
-    {
-        case RIGHT: return LEFT;
-        case LEFT:  return RIGHT;
-        case DOWN:  return UP;
-        case UP:    return DOWN;
-    }
+    Versus_MakePacket(Game.Versus, &Packet);
+    Net_Send(&Game.Socket, Game.RemotePort, &Packet, sizeof(Packet));
+    return Played;
 }
 
-unsigned int Piece_IncomingOrientations(piece Piece)
+gameplay *ShownGame(void)
 {
-    switch (Piece)
-    {
-        case PIECE_EMPTY: return 0;
-        case PIECE_HCONN: return 1<<RIGHT | 1<<LEFT;
-        case PIECE_VCONN: return 1<<DOWN  | 1<<UP;
-        case PIECE_UL:    return 1<<DOWN  | 1<<RIGHT;
-        case PIECE_DL:    return 1<<UP    | 1<<RIGHT;
-        case PIECE_DR:    return 1<<UP    | 1<<LEFT;
-        case PIECE_UR:    return 1<<DOWN  | 1<<LEFT;
-        case PIECE_DST:   return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
-        case PIECE_JUNK:  return 0;
-        case PIECE_FIRE:  return 0;
-    }
+    return (Game.Versus != NULL)? &Game.Versus->Match.Games[Game.Versus->Local] : &Game.Gameplay;
 }
 
-unsigned int Piece_OutgoingOrientations(piece Piece)
+// Presses come from raylib's queue in the order they were made, so a key tapped and let go
+// between two frames still counts. Repeats are left to the input queue, not the system
+void PollInput(double Now)
 {
-    switch (Piece)
-    {
-        case PIECE_EMPTY: return 0;
-        case PIECE_HCONN: return 1<<RIGHT | 1<<LEFT;
-        case PIECE_VCONN: return 1<<DOWN | 1<<UP;
-        case PIECE_UL:    return 1<<UP    | 1<<LEFT;
-        case PIECE_DL:    return 1<<DOWN  | 1<<LEFT;
-        case PIECE_DR:    return 1<<DOWN  | 1<<RIGHT;
-        case PIECE_UR:    return 1<<UP    | 1<<RIGHT;
-        case PIECE_DST:   return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
-        case PIECE_JUNK:  return 0;
-        case PIECE_FIRE:  return 1<<RIGHT | 1<<LEFT | 1<<DOWN | 1<<UP;
-    }
-}
+    static const int Keys[INPUT_ACTIONS] = { KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_Z };
+    static const unsigned int Flags[INPUT_ACTIONS] = { GP_INPUT_DOWN, GP_INPUT_LEFT, GP_INPUT_RIGHT, GP_INPUT_ROTATE };
 
-piece Piece_Rotate(piece Piece)
-{
-    switch (Piece)
+    for (int Key = GetKeyPressed(); Key != 0; Key = GetKeyPressed())
     {
-        case PIECE_EMPTY: return PIECE_EMPTY;
-        case PIECE_HCONN: return PIECE_VCONN;
-        case PIECE_VCONN: return PIECE_HCONN;
-        case PIECE_UL:    return PIECE_UR;
-        case PIECE_DL:    return PIECE_UL;
-        case PIECE_DR:    return PIECE_DL;
-        case PIECE_UR:    return PIECE_DR;
-        case PIECE_DST:   return PIECE_DST;
-        case PIECE_JUNK:  return PIECE_JUNK;
-        case PIECE_FIRE:  return PIECE_FIRE;
+        for (int i = 0; i < INPUT_ACTIONS; i++)
+        {
+            if (Key == Keys[i]) Input_Press(&Game.Input, Flags[i], Now);
+        }
     }
-}
 
-bool Piece_IsConnectionType(piece Piece)
-{
-    switch (Piece)
+    for (int i = 0; i < INPUT_ACTIONS; i++)
     {
-        case PIECE_HCONN:
-        case PIECE_VCONN:
-        case PIECE_UL:
-        case PIECE_DL:
-        case PIECE_DR:
-        case PIECE_UR:
-            return true;
-        default:
-            return false;
+        if (!IsKeyDown(Keys[i])) Input_Release(&Game.Input, Flags[i], Now);
     }
 }
 
-brick Brick_Rotate(brick *Brick)
+// Bakes every sprite with the shapes of core/gfx.h, once, so that frames only draw textured quads.
+// Quads sharing a texture go out in one batch, a board costs a single draw call however full it is
+void GFX_Init(void)
 {
-    brick NewBrick;
-    memcpy(&NewBrick, Brick, sizeof(brick));
+    ZONE_BEGIN("GFX_Init");
+    Atlas = LoadRenderTexture(PIECE_PALLETE_SIZE*GFX_ATLAS_PITCH, GFX_SPRITE_KINDS*GFX_ATLAS_PITCH);
 
-    switch (NewBrick.Orientation)
+    BeginTextureMode(Atlas);
+    ClearBackground(BLANK);
+    for (int Sprite = 0; Sprite < GFX_SPRITE_KINDS; Sprite++)
     {
-        case RIGHT:
-            NewBrick.Orientation = DOWN;
-            break;
-        case DOWN:
-            NewBrick.Orientation = LEFT;
-            break;
-        case LEFT:
-            NewBrick.Orientation = UP;
-            break;
-        case UP:
-            NewBrick.Orientation = RIGHT;
-            break;
-        default:
-            break;
+        for (int Piece = 0; Piece < PIECE_PALLETE_SIZE; Piece++)
+        {
+            Camera2D Camera = { 0 };
+            Camera.zoom = 1.0f;
+            Camera.offset = (Vector2){ (float)(Piece*GFX_ATLAS_PITCH), (float)(Sprite*GFX_ATLAS_PITCH) };
+            BeginMode2D(Camera);
+            {
+                if (Sprite == GFX_SPRITE_PIECE) GFX_DrawPiece(&Gfx, Piece, 0, 0);
+                else GFX_DrawCell(&Gfx, Piece, Sprite == GFX_SPRITE_POWERED, 0, 0);
+            }
+            EndMode2D();
+        }
     }
+    EndTextureMode();
 
-    NewBrick.Pieces[0] = Piece_Rotate(NewBrick.Pieces[0]);
-    NewBrick.Pieces[1] = Piece_Rotate(NewBrick.Pieces[1]);
-
-    return NewBrick;
+    GridLayer.Target = LoadRenderTexture((CELL_SIZE-1)*BOARD_WIDTH + 2*GFX_LAYER_MARGIN, (CELL_SIZE-1)*BOARD_HEIGHT + 2*GFX_LAYER_MARGIN);
+    BoardLayer.Target = LoadRenderTexture(GridLayer.Target.texture.width, GridLayer.Target.texture.height);
+    HudLayer.Target = LoadRenderTexture(ScreenWidth/3, ScreenHeight/3);
+    ZONE_END();
 }
 
-brick Brick_Move(brick *Brick, int dx, int dy)
+void GFX_Close(void)
 {
-    brick NewBrick;
-    memcpy(&NewBrick, Brick, sizeof(brick));
-
-    NewBrick.x += dx;
-    NewBrick.y += dy;
-
-    return NewBrick;
+    UnloadRenderTexture(HudLayer.Target);
+    UnloadRenderTexture(BoardLayer.Target);
+    UnloadRenderTexture(GridLayer.Target);
+    UnloadRenderTexture(Atlas);
 }
 
-brick Brick_Random(void)
+// Starts re-rendering the layer if its keys changed, returns false when it is still current
+static bool GFX_BeginLayer(gfx_layer *Layer, unsigned int Key0, unsigned int Key1)
 {
-    srand(time(NULL));
-
-    const piece CHANCE_TBL[] = {
-        PIECE_HCONN,
-        PIECE_HCONN,
-        PIECE_HCONN,
-        PIECE_VCONN,
-        PIECE_VCONN,
-        PIECE_VCONN,
-        PIECE_UL,
-        PIECE_DL,
-        PIECE_DR,
-        PIECE_UR,
-        PIECE_DST,
-        PIECE_DST,
-        PIECE_JUNK,
-        PIECE_FIRE
-    };
-
-    const int CHANCE_TBL_SIZE = sizeof(CHANCE_TBL)/sizeof(CHANCE_TBL[0]);
-
-    brick NewBrick;
-    NewBrick.x = BOARD_WIDTH/2-1;
-    NewBrick.y = 0;
-    NewBrick.Orientation = rand() % 2;
-
-    enum brick_type {
-        TYPE_CONNECTION,
-        TYPE_JUNK,
-        TYPE_RANDOM,
-        TYPE_DEST,
-        TYPE_FIRE,
-    };
-
-    const enum brick_type TYPE_CHANCE_TBL[] = {
-        TYPE_CONNECTION,
-        TYPE_CONNECTION,
-        TYPE_CONNECTION,
-        TYPE_JUNK,
-        TYPE_RANDOM,
-        TYPE_RANDOM,
-        TYPE_DEST,
-        TYPE_FIRE,
-    };
-
-    enum brick_type Type = TYPE_CHANCE_TBL[rand() % (sizeof(TYPE_CHANCE_TBL)/sizeof(TYPE_CHANCE_TBL[0]))];
-    printf("Type: %d\n", Type);
-
-    if (Type == TYPE_FIRE)
-    {
-        NewBrick.Pieces[0] = PIECE_FIRE;
-        NewBrick.Pieces[1] = PIECE_EMPTY;
-        return NewBrick;
-    }
+    if (Layer->Ready && Layer->Key[0] == Key0 && Layer->Key[1] == Key1) return false;
 
-    while (true) {
-        NewBrick.Pieces[0] = CHANCE_TBL[rand() % CHANCE_TBL_SIZE];
-        NewBrick.Pieces[1] = CHANCE_TBL[rand() % CHANCE_TBL_SIZE];
-
-        unsigned int DirFrom = Piece_OutgoingOrientations(NewBrick.Pieces[0]);
-        unsigned int DirTo = Piece_IncomingOrientations(NewBrick.Pieces[1]);
-
-        if (NewBrick.Pieces[0] == PIECE_FIRE || NewBrick.Pieces[1] == PIECE_FIRE)
-            continue;
-
-        switch (Type) {
-            case TYPE_CONNECTION:
-                if (!(Piece_IsConnectionType(NewBrick.Pieces[0]) || Piece_IsConnectionType(NewBrick.Pieces[1])))
-                    break;
-                if ((DirFrom & DirTo & 1<<NewBrick.Orientation) != 0)
-                    return NewBrick;
-                break;
-            case TYPE_JUNK:
-                if (NewBrick.Pieces[0] != PIECE_JUNK && NewBrick.Pieces[1] != PIECE_JUNK)
-                    break;
-                return NewBrick;
-                break;
-            case TYPE_RANDOM:
-                if (NewBrick.Pieces[0] == PIECE_JUNK || NewBrick.Pieces[1] == PIECE_JUNK)
-                    break;
-                return NewBrick;
-                break;
-            case TYPE_DEST:
-                printf("NewBrick.Pieces[0..1]: %d, %d\n", NewBrick.Pieces[0], NewBrick.Pieces[1]);
-                if (NewBrick.Pieces[0] == PIECE_JUNK || NewBrick.Pieces[1] == PIECE_JUNK)
-                    break;
-                if (NewBrick.Pieces[0] != PIECE_DST && NewBrick.Pieces[1] != PIECE_DST)
-                    break;
-                if (NewBrick.Pieces[0] == PIECE_DST && NewBrick.Pieces[1] == PIECE_DST)
-                    break;
-                return NewBrick;
-                break;
-            default:
-                break;
-        }
-    }
-
-    return NewBrick;
+    Layer->Key[0] = Key0;
+    Layer->Key[1] = Key1;
+    Layer->Ready = true;
+    BeginTextureMode(Layer->Target);
+    ClearBackground(BLANK);
+    return true;
 }
 
-void Brick_Locations(brick *Brick, int x[2], int y[2])
+// Runs outside BeginDrawing(), during play most frames render nothing here
+void GFX_UpdateLayers(gameplay *Gameplay)
 {
-    switch (Brick->Orientation)
-    {
-        case RIGHT:
-            x[0] = Brick->x;
-            x[1] = Brick->x+1;
-            y[0] = Brick->y;
-            y[1] = Brick->y;
-            break;
-        case DOWN:
-            x[0] = Brick->x;
-            x[1] = Brick->x;
-            y[0] = Brick->y;
-            y[1] = Brick->y+1;
-            break;
-        case LEFT:
-            x[0] = Brick->x;
-            x[1] = Brick->x-1;
-            y[0] = Brick->y;
-            y[1] = Brick->y;
-            break;
-        case UP:
-            x[0] = Brick->x;
-            x[1] = Brick->x;
-            y[0] = Brick->y;
-            y[1] = Brick->y-1;
-            break;
-    }
-}
+    ZONE_BEGIN("GFX_UpdateLayers");
+    Camera2D Camera = { 0 };
+    Camera.zoom = 1.0f;
+    Camera.offset = (Vector2){ GFX_LAYER_MARGIN, GFX_LAYER_MARGIN };
 
-void Board_PutTileSafe(board *Board, int x, int y, piece Piece)
-{
-    if (Piece == PIECE_EMPTY)
+    if (!GP_IsField(Gameplay))
     {
-        return;
+        if (GFX_BeginLayer(&GridLayer, 0, 0))
+        {
+            BeginMode2D(Camera);
+            GFX_DrawGrid();
+            EndMode2D();
+            EndTextureMode();
+        }
+        if (GFX_BeginLayer(&BoardLayer, Gameplay->Board.Version, Gameplay->PowerVersion))
+        {
+            BeginMode2D(Camera);
+            GFX_DrawSettled(&Gameplay->Powers, &Gameplay->Board);
+            EndMode2D();
+            EndTextureMode();
+        }
     }
 
-    if (x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT)
+    brick *Next = Brick_QueuePeek(&Gameplay->Queue, 0);
+    unsigned int NextKey = Next->Pieces[0] | Next->Pieces[1] << 8 | Next->Orientation << 16;
+    if (GFX_BeginLayer(&HudLayer, (unsigned int)Gameplay->Scoring.Score, NextKey))
     {
-        Board->Pieces[y][x] = Piece;
+        GFX_DrawHud(&Gfx, Gameplay);
+        EndTextureMode();
     }
+    ZONE_END();
 }
 
-void Board_PutBrick(board *Board, brick *Brick)
+void GFX_DrawSprite(gfx_sprite Sprite, piece Piece, int x, int y)
 {
-    int x[2], y[2];
-    Brick_Locations(Brick, x, y);
-    Board_PutTileSafe(Board, x[0], y[0], Brick->Pieces[0]);
-    Board_PutTileSafe(Board, x[1], y[1], Brick->Pieces[1]);
+    const int sz = CELL_SIZE-1;
+    GFX_DrawSpriteAt(Sprite, Piece, (Vector2){ (float)(x*sz), (float)(y*sz) });
 }
 
-brick Board_BumpBrick(board *Board, brick *Brick)
+void GFX_DrawSpriteAt(gfx_sprite Sprite, piece Piece, Vector2 Position)
 {
-    brick NewBrick;
-    memcpy(&NewBrick, Brick, sizeof(brick));
-    if (NewBrick.Pieces[0] == PIECE_EMPTY || NewBrick.Pieces[1] == PIECE_EMPTY)
-    {
-        while (true) {
-            int x = NewBrick.x, y = NewBrick.y;
-            if (x < 0) NewBrick.x++;
-            else if (x >= BOARD_WIDTH) NewBrick.x--;
-            else if (y < 0) NewBrick.y++;
-            else break;
-        }
-        return NewBrick;
-    }
+    // Render textures are stored bottom-up, a negative height flips the sprite back
+    Rectangle Source = { (float)(Piece*GFX_ATLAS_PITCH), (float)(Atlas.texture.height - Sprite*GFX_ATLAS_PITCH - CELL_SIZE), (float)CELL_SIZE, (float)-CELL_SIZE };
+    DrawTextureRec(Atlas.texture, Source, Position, WHITE);
+}
 
-    int x[2], y[2];
-    while (true) {
-        Brick_Locations(&NewBrick, x, y);
+// Offset from the brick's cell to where it is drawn, Alpha of the way from From to To.
+// Only a step of one cell slides, a new brick or a rotation is drawn where it is
+static Vector2 GFX_BrickLag(brick *From, brick *To, float Alpha)
+{
+    const int sz = CELL_SIZE-1;
+    int dx = From->x - To->x, dy = From->y - To->y;
 
-        if (x[0] < 0 || x[1] < 0) NewBrick.x++;
-        else if (x[0] >= BOARD_WIDTH || x[1] >= BOARD_WIDTH) NewBrick.x--;
-        else if (y[0] < 0 || y[1] < 0) NewBrick.y++;
-        else break;
+    if (From->Orientation != To->Orientation || abs(dx) + abs(dy) != 1)
+    {
+        return (Vector2){ 0, 0 };
     }
-
-    return NewBrick;
+    return (Vector2){ dx*sz*(1.0f - Alpha), dy*sz*(1.0f - Alpha) };
 }
 
-bool Board_IsOob(board *Board, int x, int y)
+void GFX_DrawLayer(gfx_layer *Layer, float x, float y, float Scale)
 {
-    return x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT;
+    ZONE_BEGIN("GFX_DrawLayer");
+    Texture2D Texture = Layer->Target.texture;
+    Rectangle Source = { 0, 0, (float)Texture.width, (float)-Texture.height };
+    DrawTexturePro(Texture, Source, (Rectangle){ x, y, Texture.width*Scale, Texture.height*Scale }, (Vector2){ 0, 0 }, 0.0f, WHITE);
+    ZONE_END();
 }
 
-bool Board_IsOccupied(board *Board, int x, int y)
+// The settled board comes from its layers, only the falling brick is drawn live
+void GFX_DrawBoardLayers(board *Board, brick *Brick, Vector2 Lag)
 {
-    if (Board_IsOob(Board, x, y)) 
-        return true;
+    ZONE_BEGIN("GFX_DrawBoardLayers");
+    const int sz = CELL_SIZE-1;
 
-    return Board->Pieces[y][x] != PIECE_EMPTY;
-}
-
-bool Board_ShouldPlaceBrick(board *Board, brick *Brick)
-{
-    int x[2], y[2];
-    Brick_Locations(Brick, x, y);
+    GFX_DrawLayer(&GridLayer, -GFX_LAYER_MARGIN, -GFX_LAYER_MARGIN, 1.0f);
+    GFX_DrawLayer(&BoardLayer, -GFX_LAYER_MARGIN, -GFX_LAYER_MARGIN, 1.0f);
 
+    int px[2], py[2];
+    Brick_Locations(Brick, px, py);
     for (int i = 0; i < 2; i++)
     {
-        if (Brick->Pieces[i] == PIECE_EMPTY)
-        {
-            continue;
-        }
-
-        if (Board_IsOccupied(Board, x[i], y[i]))
-        {
-            return true;
-        }
+        if (Board_IsOob(Board, px[i], py[i])) continue;
+        GFX_DrawSpriteAt(GFX_SPRITE_PIECE, Brick->Pieces[i], (Vector2){ px[i]*sz + Lag.x, py[i]*sz + Lag.y });
     }
-    
-    return false;
+    ZONE_END();
 }
 
-bool Board_GravityStep(board *Board)
+void GFX_DrawGrid(void)
 {
-    bool HasMoved = false;
-
-    for (int y = 0; y < BOARD_HEIGHT-1; y++)
+    ZONE_BEGIN("GFX_DrawGrid");
+    for (int y = 0; y < BOARD_HEIGHT; y++)
     {
         for (int x = 0; x < BOARD_WIDTH; x++)
         {
-            if (Board->Pieces[y][x] == PIECE_EMPTY || Board->Pieces[y+1][x] != PIECE_EMPTY)
-            {
-                continue;
-            }
-
-            piece Piece = Board->Pieces[y][x];
-            Board->Pieces[y][x] = PIECE_EMPTY;
-            Board->Pieces[y+1][x] = Piece;
-            HasMoved = true;
+            GFX_DrawSprite(GFX_SPRITE_CELL, PIECE_EMPTY, x, y);
         }
     }
 
-    return HasMoved;
+    DrawRectangleLinesEx((Rectangle){-1, -1, (CELL_SIZE-1)*BOARD_WIDTH+2, (CELL_SIZE-1)*BOARD_HEIGHT+2}, 1, GRAY);
+    ZONE_END();
 }
 
-trace Board_TraceFilter(board *Board, trace *Trace, power_board *Powers)
+// One atlas quad per occupied cell, powered wires included
+void GFX_DrawSettled(power_board *Powers, board *Board)
 {
-    trace NewTrace = { 0 };
-    memcpy(&NewTrace, Trace, sizeof(trace));
-
-    // int Count = 0;
-    // for (int i = 0; i < Trace->Count; i++)
-    // {
-    //     if (Board->Pieces[Trace->Ys[i]][Trace->Xs[i]] == PIECE_DST)
-    //     {
-    //         Count++;
-    //         if (Count > 1) {
-    //             return NewTrace;
-    //         }
-    //     }
-    // }
-
-    NewTrace.Count = 0;
-
-    for (int i = 0; i < Trace->Count; i++)
+    ZONE_BEGIN("GFX_DrawSettled");
+    for (int y = 0; y < BOARD_HEIGHT; y++)
     {
-        int x = Trace->Xs[i];
-        int y = Trace->Ys[i];
-        piece Piece = Board->Pieces[y][x];
-
-        if (!Piece_IsConnectionType(Piece))
-        {
-            NewTrace.Xs[NewTrace.Count] = x;
-            NewTrace.Ys[NewTrace.Count] = y;
-            NewTrace.Count++;
-            continue;
-        }
-
-        unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
-        if ((Powers->Incoming[y][x] & DirFrom) != DirFrom)
+        for (int x = 0; x < BOARD_WIDTH; x++)
         {
-            continue;
-        }
-
-        NewTrace.Xs[NewTrace.Count] = x;
-        NewTrace.Ys[NewTrace.Count] = y;
-        NewTrace.Count++;
-    }
-
-    return NewTrace;
-}
-
-bool Board_DoTraceIter(board *Board, trace *Trace, power_board *Powers)
-{
-    trace NewTrace;
-    memcpy(&NewTrace, Trace, sizeof(trace));
-    bool HasIter = false;
-
-    for (int i = 0; i < Trace->Count; i++)
-    {
-        int x = Trace->Xs[i];
-        int y = Trace->Ys[i];
-        piece Piece = Board->Pieces[y][x];
-        unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
-
-        struct {
-            int x, y;
-            orientation Orientation;
-        } Positions[4] = {
-            { x-1, y, LEFT },
-            { x+1, y, RIGHT },
-            { x, y-1, UP },
-            { x, y+1, DOWN },
-        };
-
-        for (int i = 0; i < 4; i++) {
-            int x = Positions[i].x;
-            int y = Positions[i].y;
-
-            if (Board_IsOob(Board, x, y) || Trace_Contains(Trace, x, y))
-                continue;
-            
-            piece OtherPiece = Board->Pieces[y][x];
-
-            if (OtherPiece == PIECE_DST && Piece == PIECE_DST)
-            {
-                continue;
-            }
-
-            unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
-
-            if ((DirFrom & DirTo & (1<<Positions[i].Orientation)) == 0)
-            {
-                continue;
-            }
-
-            Powers->Incoming[y][x] |= 1<<Orientation_Flip(Positions[i].Orientation);
+            piece Piece = Board_GetTile(Board, x, y);
+            if (Piece == PIECE_EMPTY) continue;
 
-            NewTrace.Xs[NewTrace.Count] = x;
-            NewTrace.Ys[NewTrace.Count] = y;
-            NewTrace.Count++;
-            HasIter = true;
+            bool Powered = Piece_IsConnectionType(Piece) && Powers->Incoming[y][x] != 0;
+            GFX_DrawSprite(Powered ? GFX_SPRITE_POWERED : GFX_SPRITE_CELL, Piece, x, y);
         }
     }
-
-    memcpy(Trace, &NewTrace, sizeof(trace));
-    return HasIter;
+    ZONE_END();
 }
 
-trace Board_Trace(board *Board, int x, int y, power_board *Powers)
+// Draws rows [FirstRow, FirstRow + RowCount) of the field, visiting only their occupied cells
+void GFX_DrawField(field *Field, brick *Brick, Vector2 Lag, int FirstRow, int RowCount)
 {
-    trace Trace = { 0 };
-    Trace.Count = 1;
-    Trace.Xs[0] = x;
-    Trace.Ys[0] = y;
-    while (Board_DoTraceIter(Board, &Trace, Powers))
-        ;
-    return Trace;
-}
+    ZONE_BEGIN("GFX_DrawField");
+    const int sz = CELL_SIZE-1;
+    int EndRow = FirstRow + RowCount;
+    if (EndRow > Field->Height) EndRow = Field->Height;
 
-bool Board_DoTraceIterJunk(board *Board, trace *Trace)
-{
-    trace NewTrace;
-    memcpy(&NewTrace, Trace, sizeof(trace));
-    bool HasIter = false;
+    // One line per row and column in view instead of a rectangle per cell
+    for (int y = FirstRow; y <= EndRow; y++) DrawLine(0, y*sz, Field->Width*sz, y*sz, DARKGRAY);
+    for (int x = 0; x <= Field->Width; x++) DrawLine(x*sz, FirstRow*sz, x*sz, EndRow*sz, DARKGRAY);
+    DrawRectangleLinesEx((Rectangle){-1, -1, sz*Field->Width+2, sz*Field->Height+2}, 1, GRAY);
 
-    for (int i = 0; i < Trace->Count; i++)
+    for (int y = FirstRow; y < EndRow; y++)
     {
-        int x = Trace->Xs[i];
-        int y = Trace->Ys[i];
-        piece Piece = Board->Pieces[y][x];
-        unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
-
-        struct {
-            int x, y;
-            orientation Orientation;
-        } Positions[4] = {
-            { x-1, y, LEFT },
-            { x+1, y, RIGHT },
-            { x, y-1, UP },
-            { x, y+1, DOWN },
-        };
-
-        for (int i = 0; i < 4; i++) {
-            int x = Positions[i].x;
-            int y = Positions[i].y;
-
-            if ((DirFrom & (1<<Positions[i].Orientation)) == 0)
-            {
-                continue;
-            }
-
-            if (Trace_Contains(Trace, x, y))
-            {
-                continue;
-            }
- 
-            if (Board_IsOob(Board, x, y))
+        for (int w = 0; w < Field->Words; w++)
+        {
+            for (uint64_t Bits = Field->Occupied[y*Field->Words + w]; Bits != 0; Bits &= Bits - 1)
             {
-                NewTrace.Junk = true;
-                continue;
-            }
-            
-            piece OtherPiece = Board->Pieces[y][x];
+                int x = w*64 + BB_LowestBit64(Bits);
+                piece Piece = Field_GetTile(Field, x, y);
 
-            if (OtherPiece == PIECE_DST)
-            {
-                continue;
+                bool Powered = Piece_IsConnectionType(Piece) && Field->Incoming[FIELD_INDEX(Field, x, y)] != 0;
+                GFX_DrawSprite(Powered ? GFX_SPRITE_POWERED : GFX_SPRITE_CELL, Piece, x, y);
             }
-
-            // if (OtherPiece == PIECE_JUNK)
-            // {
-            //     NewTrace.Junk = true;
-            // }
-
-            unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
-
-            if ((DirFrom & DirTo & (1<<Positions[i].Orientation)) == 0)
-            {
-                if (OtherPiece == PIECE_EMPTY)
-                {
-                    NewTrace.OpenConns++;
-                }
-                continue;
-            }
-
-            NewTrace.OpenConns++;
-            NewTrace.Xs[NewTrace.Count] = x;
-            NewTrace.Ys[NewTrace.Count] = y;
-            NewTrace.Count++;
-            HasIter = true;
         }
     }
 
-    memcpy(Trace, &NewTrace, sizeof(trace));
-    return HasIter;
-}
-
-bool Board_DoTraceIterFire(board *Board, trace *Trace)
-{
-    trace NewTrace;
-    memcpy(&NewTrace, Trace, sizeof(trace));
-    bool HasIter = false;
-
-    for (int i = 0; i < Trace->Count; i++)
+    int px[2], py[2];
+    Brick_Locations(Brick, px, py);
+    for (int i = 0; i < 2; i++)
     {
-        int x = Trace->Xs[i];
-        int y = Trace->Ys[i];
-        piece Piece = Board->Pieces[y][x];
-        unsigned int DirFrom = Piece_OutgoingOrientations(Piece);
-
-        struct {
-            int x, y;
-            orientation Orientation;
-        } Positions[4] = {
-            { x-1, y, LEFT },
-            { x+1, y, RIGHT },
-            { x, y-1, UP },
-            { x, y+1, DOWN },
-        };
-
-        if (Piece != PIECE_FIRE && !Piece_IsConnectionType(Piece))
-        {
-            continue;
-        }
-
-        for (int i = 0; i < 4; i++) {
-            int x = Positions[i].x;
-            int y = Positions[i].y;
-
-            if (Board_IsOob(Board, x, y) || Trace_Contains(Trace, x, y))
-            {
-                continue;
-            }
-            
-            piece OtherPiece = Board->Pieces[y][x];
-
-            if (!Piece_IsConnectionType(OtherPiece))
-            {
-                continue;
-            }
-
-            unsigned int DirTo = Piece_IncomingOrientations(OtherPiece);
-
-            if ((DirFrom & DirTo & (1<<Positions[i].Orientation)) == 0)
-            {
-                continue;
-            }
-
-            NewTrace.Xs[NewTrace.Count] = x;
-            NewTrace.Ys[NewTrace.Count] = y;
-            NewTrace.Count++;
-            HasIter = true;
-        }
+        if (Field_IsOob(Field, px[i], py[i])) continue;
+        GFX_DrawSpriteAt(GFX_SPRITE_PIECE, Brick->Pieces[i], (Vector2){ px[i]*sz + Lag.x, py[i]*sz + Lag.y });
     }
-
-    memcpy(Trace, &NewTrace, sizeof(trace));
-    return HasIter;
+    ZONE_END();
 }
 
-trace Board_TraceJunk(board *Board, int x, int y)
+//----------------------------------------------------------------------------------
+// Frame profiler
+//----------------------------------------------------------------------------------
+static void Prof_Record(profiler *Profiler, const double Seconds[PROF_PHASES])
 {
-    trace Trace = { 0 };
-    Trace.Count = 1;
-    Trace.Xs[0] = x;
-    Trace.Ys[0] = y;
-    while (Board_DoTraceIterJunk(Board, &Trace))
-        ;
-    return Trace;
-}
+    int Slot = (Profiler->Head + Profiler->Count) % PROF_HISTORY;
+    if (Profiler->Count < PROF_HISTORY) Profiler->Count++;
+    else Profiler->Head = (Profiler->Head + 1) % PROF_HISTORY;
 
-trace Board_TraceFire(board *Board, int x, int y)
-{
-    trace Trace = { 0 };
-    Trace.Count = 1;
-    Trace.Xs[0] = x;
-    Trace.Ys[0] = y;
-    while (Board_DoTraceIterFire(Board, &Trace))
-        ;
-    return Trace;
+    for (int i = 0; i < PROF_PHASES; i++) Profiler->Ms[Slot][i] = (float)(Seconds[i]*1000.0);
 }
 
-trace Board_GetTrace(board *Board, power_board *Powers)
+static int Prof_CompareMs(const void *a, const void *b)
 {
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            if (Board->Pieces[y][x] == PIECE_FIRE)
-            {
-                trace Trace = Board_TraceFire(Board, x, y);
-                if (Trace.Count > 1) return Trace;
-            }
-            if (Board->Pieces[y][x] == PIECE_DST)
-            {
-                Board_Trace(Board, x, y, Powers);
-            }
-        }
-    }
-
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            if (Board->Pieces[y][x] == PIECE_DST)
-            {
-                trace Trace = Board_Trace(Board, x, y, Powers);
-                Trace = Board_TraceFilter(Board, &Trace, Powers);
-                if (Trace.Count > 1) return Trace; 
-            }
-        }
-    }
-
-    return (trace){ 0 };
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
 }
 
-trace Board_GetTraceJunk(board *Board)
+// A table of p50/p99/max with a histogram per phase, and a graph of the frames stacked by phase
+static void Prof_Draw(profiler *Profiler, int x, int y)
 {
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            if (Piece_IsConnectionType(Board->Pieces[y][x]))
-            {
-                trace Trace = Board_TraceJunk(Board, x, y);
-                if (Trace.Junk) return Trace;
-                // if (Trace.OpenConns < 2) return Trace;
-            }
-        }
-    }
+    static const char *Names[PROF_PHASES] = { "GP_Update", "  power", "  junk", "  settle", "draw", "EndDrawing", "frame" };
+    const int GraphHeight = 80;
+    const float GraphMs = 1000.0f/30.0f;    // Two frames at 60 fps fill the graph
 
-    return (trace){ 0 };
-}
+    DrawRectangle(x - 5, y - 5, ScreenWidth - 2*x + 10, 240, (Color){ 0, 0, 0, 200 });
+    DrawText(TextFormat("Frame phases, last %i frames (F3 hides)", Profiler->Count), x, y, 10, WHITE);
+    DrawText("p50 ms     p99 ms     max ms     1 us .. 32 ms", x + 90, y + 16, 10, GRAY);
 
-void Board_CleanSurroundings(board *Board, int x, int y)
-{
-    struct {
-        int x, y;
-    } Positions[8] = {
-        { 0, 1 },
-        { 1, 0 },
-        { 0, -1 },
-        { -1, 0 },
-        { 1, 1 },
-        { -1, 1 },
-        { 1, -1 },
-        { -1, -1 },
-    };
-
-    for (int i = 0; i < 8; i++)
+    for (int Phase = 0; Phase < PROF_PHASES; Phase++)
     {
-        int x2 = x + Positions[i].x;
-        int y2 = y + Positions[i].y;
+        float Sorted[PROF_HISTORY];
+        int Buckets[PROF_BUCKETS] = { 0 };
+        int Peak = 1;
 
-        if (Board_IsOob(Board, x2, y2))
+        for (int i = 0; i < Profiler->Count; i++)
         {
-            continue;
-        }
+            float Ms = Profiler->Ms[(Profiler->Head + i) % PROF_HISTORY][Phase];
+            Sorted[i] = Ms;
 
-        if (Board->Pieces[y2][x2] == PIECE_JUNK)
-        {
-            Board->Pieces[y2][x2] = PIECE_EMPTY;
+            // Bucket b holds [2^b, 2^(b+1)) microseconds, the first one everything shorter too
+            int b = 0;
+            for (float Us = Ms*1000.0f; Us >= 2.0f && b < PROF_BUCKETS - 1; Us /= 2.0f) b++;
+            if (++Buckets[b] > Peak) Peak = Buckets[b];
         }
-    }
-}
+        qsort(Sorted, Profiler->Count, sizeof(float), Prof_CompareMs);
 
-void GP_Update(gameplay *Gameplay)
-{
-    Gameplay->Powers = (power_board){ 0 };
-    if (Gameplay->TraceIndex >= Gameplay->Trace.Count)
-    {
-        Gameplay->Scoring.Multiplier += 1;
-        Gameplay->TraceIndex = 0;
-        Gameplay->Trace = Board_GetTrace(&Gameplay->Board, &Gameplay->Powers);
-    }
-    else
-    {
-        if (Timer_IsExpired(&Gameplay->TimerTrace))
+        float p50 = 0.0f, p99 = 0.0f, Max = 0.0f;
+        if (Profiler->Count > 0)
         {
-            int x = Gameplay->Trace.Xs[Gameplay->TraceIndex];
-            int y = Gameplay->Trace.Ys[Gameplay->TraceIndex];
-            if (Gameplay->Board.Pieces[y][x] == PIECE_DST)
-            {
-                Gameplay->Scoring.NodeChain += 1;
-            }
-            Gameplay->Scoring.WireChain += 1;
-            Gameplay->Board.Pieces[y][x] = PIECE_EMPTY;
-            Gameplay->Scoring.Score += 10*Gameplay->Scoring.Multiplier*(Gameplay->Scoring.NodeChain+1)*(Gameplay->Scoring.WireChain+1);
-            Board_CleanSurroundings(&Gameplay->Board, x, y);
-            Gameplay->TimerTrace = Timer_Make(0.15f);
-            Gameplay->TraceIndex = (Gameplay->TraceIndex + 1);
+            p50 = Sorted[Profiler->Count/2];
+            p99 = Sorted[(Profiler->Count*99)/100];
+            Max = Sorted[Profiler->Count - 1];
         }
-        return;
-    }
 
-    if (Gameplay->TraceJunkIndex >= Gameplay->TraceJunk.Count)
-    {
-        Gameplay->Scoring.Multiplier += 1;
-        Gameplay->TraceJunkIndex = 0;
-        Gameplay->TraceJunk = Board_GetTraceJunk(&Gameplay->Board);
-    }
-    else
-    {
-        if (Timer_IsExpired(&Gameplay->TimerJunk))
+        int Row = y + 30 + Phase*14;
+        DrawText(Names[Phase], x, Row, 10, LIGHTGRAY);
+        DrawText(TextFormat("%7.3f    %7.3f    %7.3f", p50, p99, Max), x + 90, Row, 10, WHITE);
+        for (int b = 0; b < PROF_BUCKETS; b++)
         {
-            int x = Gameplay->TraceJunk.Xs[Gameplay->TraceJunkIndex];
-            int y = Gameplay->TraceJunk.Ys[Gameplay->TraceJunkIndex];
-            Gameplay->Board.Pieces[y][x] = PIECE_JUNK;
-            Gameplay->TimerJunk = Timer_Make(0.15f);
-            Gameplay->TraceJunkIndex = (Gameplay->TraceJunkIndex + 1);
+            int Height = (Buckets[b]*10 + Peak - 1)/Peak;
+            DrawRectangle(x + 300 + b*8, Row + 10 - Height, 6, Height, GREEN);
         }
-        return;
     }
 
-    if (Gameplay->TraceJunk.Count != 0 || Gameplay->Trace.Count != 0)
-    {
-        return;
-    }
+    // Oldest frame on the left, update, draw and EndDrawing stacked over the whole frame
+    int Bottom = y + 30 + PROF_PHASES*14 + 10 + GraphHeight;
+    const prof_phase Stacked[3] = { PROF_UPDATE, PROF_DRAW, PROF_PRESENT };
+    const Color Colors[3] = { RED, GREEN, BLUE };
 
-    Gameplay->Scoring.NodeChain = 0;
-    Gameplay->Scoring.WireChain = 0;
-    Gameplay->Scoring.Multiplier = 0;
-
-    brick NewBrick = Gameplay->Brick;
-    int dx = 0, dy = 0;
-
-    if (IsKeyPressed(KEY_DOWN) || IsKeyPressedRepeat(KEY_DOWN))
+    for (int i = 0; i < Profiler->Count; i++)
     {
-        dy = 1;
-    }
-    else if (IsKeyPressed(KEY_LEFT) || IsKeyPressedRepeat(KEY_LEFT))
-    {
-        dx = -1;
-    }
-    else if (IsKeyPressed(KEY_RIGHT) || IsKeyPressedRepeat(KEY_RIGHT))
-    {
-        dx = 1;
-    }
-    else if (IsKeyPressed(KEY_Z) || IsKeyPressedRepeat(KEY_Z))
-    {
-        NewBrick = Brick_Rotate(&Gameplay->Brick);
-        if (Board_ShouldPlaceBrick(&Gameplay->Board, &NewBrick)) {
-            NewBrick = Gameplay->Brick;
-        }
+        const float *Ms = Profiler->Ms[(Profiler->Head + i) % PROF_HISTORY];
+        int Column = x + i;
 
-        Gameplay->Brick = NewBrick;
-    }
-    
-    if (Timer_IsExpired(&Gameplay->TimerGravity))
-    {
-        Gameplay->TimerGravity = Timer_Make(0.75f);
-        dy += 1;
-    }
+        int Height = (int)(Ms[PROF_FRAME]/GraphMs*GraphHeight);
+        if (Height > GraphHeight) Height = GraphHeight;
+        DrawRectangle(Column, Bottom - Height, 1, Height, DARKGRAY);
 
-    if (dx != 0 || dy != 0)
-    {
-        NewBrick = Brick_Move(&Gameplay->Brick, dx, dy);
-        if (Board_ShouldPlaceBrick(&Gameplay->Board, &NewBrick))
-        {
-            if (dy != 0)
-            {
-                Board_PutBrick(&Gameplay->Board, &Gameplay->Brick);
-                Gameplay->Brick = Brick_Random();
-                if (Board_ShouldPlaceBrick(&Gameplay->Board, &Gameplay->Brick))
-                {
-                    Gameplay->Scoring = (scoring){ 0 };
-                    Gameplay->Board = (board){ 0 };
-                }
-            }
-        }
-        else
+        int Top = Bottom;
+        for (int k = 0; k < 3; k++)
         {
-            Gameplay->Brick = NewBrick;
+            int Part = (int)(Ms[Stacked[k]]/GraphMs*GraphHeight + 0.5f);
+            if (Part > Top - (Bottom - GraphHeight)) Part = Top - (Bottom - GraphHeight);
+            DrawRectangle(Column, Top - Part, 1, Part, Colors[k]);
+            Top -= Part;
         }
     }
 
-    while (Board_GravityStep(&Gameplay->Board))
-        ;
+    DrawLine(x, Bottom - GraphHeight/2, x + PROF_HISTORY, Bottom - GraphHeight/2, YELLOW);
+    DrawText("16.7 ms", x + PROF_HISTORY + 6, Bottom - GraphHeight/2 - 5, 10, YELLOW);
+    DrawText("update", x + PROF_HISTORY + 6, Bottom - 40, 10, RED);
+    DrawText("draw", x + PROF_HISTORY + 6, Bottom - 28, 10, GREEN);
+    DrawText("EndDrawing", x + PROF_HISTORY + 6, Bottom - 16, 10, BLUE);
 }
 
-const int CELL_SIZE = 16;
-
-void GFX_DrawCellLines(unsigned int Parts, Color color, int x, int y, int Thickness)
-{   
-    const int sz = CELL_SIZE-1;
-    const float offs = Thickness / 2.0; 
-
-    if (Parts & 1<<RIGHT) DrawLineEx((Vector2){x*sz+CELL_SIZE/2-offs, y*sz+CELL_SIZE/2}, (Vector2){x*sz+CELL_SIZE, y*sz+CELL_SIZE/2}, Thickness, color);
-    if (Parts & 1<<LEFT)  DrawLineEx((Vector2){x*sz, y*sz+CELL_SIZE/2}, (Vector2){x*sz+CELL_SIZE/2+offs, y*sz+CELL_SIZE/2}, Thickness, color);
-    if (Parts & 1<<DOWN)  DrawLineEx((Vector2){x*sz+CELL_SIZE/2, y*sz+CELL_SIZE/2-offs}, (Vector2){x*sz+CELL_SIZE/2, y*sz+CELL_SIZE}, Thickness, color);
-    if (Parts & 1<<UP)    DrawLineEx((Vector2){x*sz+CELL_SIZE/2, y*sz}, (Vector2){x*sz+CELL_SIZE/2, y*sz+CELL_SIZE/2+offs}, Thickness, color);
+static Color ToColor(gfx_color Tint)
+{
+    return (Color){ Tint.r, Tint.g, Tint.b, Tint.a };
 }
 
-void GFX_DrawPiece(piece Piece, int x, int y)
+static void Raylib_Clear(void *User, gfx_color Tint)
 {
-    const Color PIECE_PALLETE[PIECE_PALLETE_SIZE] = {
-        PAL_BLACK,
-        PAL_WHITE,
-        PAL_WHITE,
-        PAL_WHITE,
-        PAL_WHITE,
-        PAL_WHITE,
-        PAL_WHITE,
-        BLUE,
-        DARKGRAY,
-        ORANGE
-    };
-
-    int parts = Piece_OutgoingOrientations(Piece);
-    const int sz = CELL_SIZE-1;
-
-    if (Piece_IsConnectionType(Piece)) {
-        GFX_DrawCellLines(parts, PIECE_PALLETE[Piece], x, y, 1);
-    }
-
-    switch (Piece)
-    {
-        case PIECE_DST:
-        case PIECE_JUNK:
-        case PIECE_FIRE:
-            DrawRectangle(x*sz, y*sz, CELL_SIZE-1, CELL_SIZE-1, PIECE_PALLETE[Piece]);
-            break;
-        default:
-            break;
-    }
-
-    switch (Piece)
-    {
-        case PIECE_DST:
-            DrawRectangle(x*sz+1, y*sz+1, CELL_SIZE-3, CELL_SIZE-3, BLACK);  
-            DrawRectangle(x*sz+2, y*sz+2, CELL_SIZE-5, CELL_SIZE-5, BLUE);  
-            break;
-        case PIECE_JUNK:
-            DrawRectangle(x*sz+1, y*sz+1, CELL_SIZE-3, CELL_SIZE-3, DARKGRAY);  
-            break;
-        case PIECE_FIRE:
-            DrawRectangle(x*sz+1, y*sz+1, CELL_SIZE-3, CELL_SIZE-3, BLACK);  
-            DrawRectangle(x*sz+2, y*sz+2, CELL_SIZE-5, CELL_SIZE-5, WHITE);  
-        default:
-            break;
-    }
+    ClearBackground(ToColor(Tint));
 }
 
-void GFX_DrawBoardAndBricks(power_board *Powers, board *Board, brick *Brick)
+static void Raylib_Rect(void *User, int x, int y, int Width, int Height, gfx_color Tint)
 {
-    board VirtualBoard;
-    memcpy(&VirtualBoard, Board, sizeof(board));
-    Board_PutBrick(&VirtualBoard, Brick);
-    GFX_DrawBoard(Powers, &VirtualBoard);
+    DrawRectangle(x, y, Width, Height, ToColor(Tint));
 }
 
-void GFX_DrawBoard(power_board *Powers, board *Board)
+static void Raylib_Line(void *User, float x0, float y0, float x1, float y1, float Thickness, gfx_color Tint)
 {
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            if (!Piece_IsConnectionType(Board->Pieces[y][x]))
-            {
-                continue;
-            }
-
-            if (Powers->Incoming[y][x] == 0)
-            {
-                continue;
-            }
-
-            unsigned int Dir = Piece_OutgoingOrientations(Board->Pieces[y][x]);
-
-            GFX_DrawCellLines(Dir, BLUE, x, y, 3);
-        }
-    }
-
-
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            DrawRectangleLines(x*(CELL_SIZE-1), y*(CELL_SIZE-1), CELL_SIZE-1, CELL_SIZE-1, DARKGRAY);  
-        }
-    }
-
-    DrawRectangleLinesEx((Rectangle){-1, -1, (CELL_SIZE-1)*BOARD_WIDTH+2, (CELL_SIZE-1)*BOARD_HEIGHT+2}, 1, GRAY);
+    DrawLineEx((Vector2){ x0, y0 }, (Vector2){ x1, y1 }, Thickness, ToColor(Tint));
+}
 
-    for (int y = 0; y < BOARD_HEIGHT; y++)
-    {
-        for (int x = 0; x < BOARD_WIDTH; x++)
-        {
-            GFX_DrawPiece(Board->Pieces[y][x], x, y);
-        }
-    }
-}
\ No newline at end of file
+static void Raylib_Text(void *User, const char *Text, int x, int y, int Size, gfx_color Tint)
+{
+    DrawText(Text, x, y, Size, ToColor(Tint));
+}
@@ -0,0 +1,408 @@
+/*******************************************************************************************
+*
+*   nettis_balance - Monte-Carlo balancing runner
+*
+*   Plays many headless bot games for every combination of rules in a grid file and writes
+*   score, chain and game length distributions per combination to a CSV file. Games of all
+*   combinations are spread over every CPU. Game i of every combination uses seed i, so
+*   differences between combinations are not hidden by luck of the draw.
+*
+*   Grid file, one setting per line, # starts a comment:
+*       games 1000              games per combination
+*       ticks 54000             a game ends when lost or after this many ticks
+*       bot 1 4                 search depth and beam width of the player
+*       gravity 0.75 0.6        seconds per gravity step, one value per grid point
+*       trace 0.15 0.1          seconds per cleared piece, one value per grid point
+*       pieces HCONN*3 VCONN*3 UL DL DR UR DST*2 JUNK FIRE      one CHANCE_TBL per line
+*       types CONNECTION*3 JUNK RANDOM*2 DEST FIRE              one TYPE_CHANCE_TBL per line
+*   Settings left out keep the game defaults
+*
+*   Usage: nettis_balance <grid.txt> <results.csv> [threads]
+*
+********************************************************************************************/
+
+#include "core/bot.h"
+#include "pool.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BALANCE_MAX_VALUES 16           // Values per setting
+#define BALANCE_LINE_SIZE 1024
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    int Games;
+    int Ticks;
+    int BotDepth;
+    int BotWidth;
+    float Gravity[BALANCE_MAX_VALUES];
+    int GravityCount;
+    float Trace[BALANCE_MAX_VALUES];
+    int TraceCount;
+    brick_odds Pieces[BALANCE_MAX_VALUES];      // Only Pieces and PieceCount are used
+    char PiecesText[BALANCE_MAX_VALUES][BALANCE_LINE_SIZE];
+    int PiecesCount;
+    brick_odds Types[BALANCE_MAX_VALUES];       // Only Types and TypeCount are used
+    char TypesText[BALANCE_MAX_VALUES][BALANCE_LINE_SIZE];
+    int TypesCount;
+} balance_grid;
+
+typedef struct {
+    float Gravity;
+    float Trace;
+    int Pieces;
+    int Types;
+    brick_table Table;
+    gp_rules Rules;
+} balance_config;
+
+typedef struct {
+    int Score;
+    int NodeChain;          // Longest chains seen during the game
+    int WireChain;
+    int Ticks;
+    bool Lost;
+} balance_result;
+
+typedef struct {
+    balance_grid *Grid;
+    balance_config *Configs;
+    balance_result *Results;
+} balance_run;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Balance_LoadGrid(balance_grid *Grid, const char *FileName);
+static bool Balance_ParseTable(char *Text, brick_odds *Odds, bool Types);
+static void Balance_PlayGame(void *Context, int Index);
+static int Balance_CompareInt(const void *a, const void *b);
+static void Balance_WriteStats(FILE *File, int *Values, int Count, float Scale);
+static bool Balance_ParseArg(int argc, char **argv, int Index, int Default, int *Value);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int Threads;
+    if (argc < 3 || argc > 4 || !Balance_ParseArg(argc, argv, 3, 0, &Threads))
+    {
+        fprintf(stderr, "Usage: %s <grid.txt> <results.csv> [threads], threads above zero\n", argv[0]);
+        return 1;
+    }
+
+    Pool_SetThreads(Threads);
+
+    static balance_grid Grid;
+    if (!Balance_LoadGrid(&Grid, argv[1]))
+    {
+        return 1;
+    }
+
+    int ConfigCount = Grid.GravityCount*Grid.TraceCount*Grid.PiecesCount*Grid.TypesCount;
+    balance_config *Configs = malloc(sizeof(balance_config)*ConfigCount);
+    balance_result *Results = calloc((size_t)ConfigCount*Grid.Games, sizeof(balance_result));
+    int *Values = malloc(sizeof(int)*Grid.Games);
+    if (Configs == NULL || Results == NULL || Values == NULL)
+    {
+        fprintf(stderr, "Out of memory for %i combinations\n", ConfigCount);
+        return 1;
+    }
+
+    for (int c = 0; c < ConfigCount; c++)
+    {
+        balance_config *Config = &Configs[c];
+        int i = c;
+        Config->Types = i % Grid.TypesCount; i /= Grid.TypesCount;
+        Config->Pieces = i % Grid.PiecesCount; i /= Grid.PiecesCount;
+        Config->Trace = Grid.Trace[i % Grid.TraceCount]; i /= Grid.TraceCount;
+        Config->Gravity = Grid.Gravity[i];
+
+        brick_odds Odds = Grid.Pieces[Config->Pieces];
+        Odds.TypeCount = Grid.Types[Config->Types].TypeCount;
+        memcpy(Odds.Types, Grid.Types[Config->Types].Types, sizeof(Odds.Types));
+        if (!Brick_BuildTable(&Config->Table, &Odds))
+        {
+            fprintf(stderr, "pieces line %i cannot make every brick of types line %i\n", Config->Pieces + 1, Config->Types + 1);
+            return 1;
+        }
+
+        Config->Rules = GP_DefaultRules();
+        Config->Rules.GravityTicks = GP_SECONDS_TO_TICKS(Config->Gravity);
+        Config->Rules.TraceTicks = GP_SECONDS_TO_TICKS(Config->Trace);
+        Config->Rules.Bricks = &Config->Table;
+    }
+
+    printf("%i combinations, %i games each, %i threads\n", ConfigCount, Grid.Games, Pool_Threads());
+
+    balance_run Run = { &Grid, Configs, Results };
+    double Start = Pool_Seconds();
+    Pool_For(ConfigCount*Grid.Games, Balance_PlayGame, &Run);
+    double Seconds = Pool_Seconds() - Start;
+
+    printf("%i games in %.2f s, %.1f games/s\n", ConfigCount*Grid.Games, Seconds, ConfigCount*Grid.Games/Seconds);
+
+    FILE *File = fopen(argv[2], "w");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    fprintf(File, "gravity,trace,pieces,types,games,lost");
+    const char *Names[] = { "score", "node_chain", "wire_chain", "length_s" };
+    for (int n = 0; n < 4; n++)
+    {
+        fprintf(File, ",%s_mean,%s_p10,%s_p50,%s_p90,%s_max", Names[n], Names[n], Names[n], Names[n], Names[n]);
+    }
+    fprintf(File, "\n");
+
+    for (int c = 0; c < ConfigCount; c++)
+    {
+        balance_result *Games = &Results[(size_t)c*Grid.Games];
+        int Lost = 0;
+        for (int g = 0; g < Grid.Games; g++) Lost += Games[g].Lost;
+
+        fprintf(File, "%.3f,%.3f,\"%s\",\"%s\",%i,%i", Configs[c].Gravity, Configs[c].Trace,
+            Grid.PiecesText[Configs[c].Pieces], Grid.TypesText[Configs[c].Types], Grid.Games, Lost);
+
+        for (int g = 0; g < Grid.Games; g++) Values[g] = Games[g].Score;
+        Balance_WriteStats(File, Values, Grid.Games, 1.0f);
+        for (int g = 0; g < Grid.Games; g++) Values[g] = Games[g].NodeChain;
+        Balance_WriteStats(File, Values, Grid.Games, 1.0f);
+        for (int g = 0; g < Grid.Games; g++) Values[g] = Games[g].WireChain;
+        Balance_WriteStats(File, Values, Grid.Games, 1.0f);
+        for (int g = 0; g < Grid.Games; g++) Values[g] = Games[g].Ticks;
+        Balance_WriteStats(File, Values, Grid.Games, 1.0f/GP_TICKS_PER_SECOND);
+        fprintf(File, "\n");
+    }
+
+    fclose(File);
+    printf("Results written to %s\n", argv[2]);
+
+    free(Values);
+    free(Results);
+    free(Configs);
+    return 0;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static bool Balance_LoadGrid(balance_grid *Grid, const char *FileName)
+{
+    FILE *File = fopen(FileName, "r");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", FileName);
+        return false;
+    }
+
+    Grid->Games = 100;
+    Grid->Ticks = GP_TICKS_PER_SECOND*60*15;
+    Grid->BotDepth = 1;
+    Grid->BotWidth = 4;
+
+    char Line[BALANCE_LINE_SIZE];
+    int LineNumber = 0;
+    bool Ok = true;
+
+    while (Ok && fgets(Line, sizeof(Line), File) != NULL)
+    {
+        LineNumber++;
+        char *Comment = strchr(Line, '#');
+        if (Comment != NULL) *Comment = '\0';
+        Line[strcspn(Line, "\r\n")] = '\0';
+
+        char Text[BALANCE_LINE_SIZE];
+        strcpy(Text, Line);
+
+        char *Key = strtok(Line, " \t");
+        if (Key == NULL)
+        {
+            continue;
+        }
+
+        char *Rest = strstr(Text, Key) + strlen(Key);
+        Rest += strspn(Rest, " \t");
+
+        if (strcmp(Key, "games") == 0) Ok = sscanf(Rest, "%i", &Grid->Games) == 1 && Grid->Games > 0;
+        else if (strcmp(Key, "ticks") == 0) Ok = sscanf(Rest, "%i", &Grid->Ticks) == 1 && Grid->Ticks > 0;
+        else if (strcmp(Key, "bot") == 0) Ok = sscanf(Rest, "%i %i", &Grid->BotDepth, &Grid->BotWidth) == 2;
+        else if (strcmp(Key, "gravity") == 0 || strcmp(Key, "trace") == 0)
+        {
+            float *Values = (Key[0] == 'g')? Grid->Gravity : Grid->Trace;
+            int *Count = (Key[0] == 'g')? &Grid->GravityCount : &Grid->TraceCount;
+            for (char *Value = strtok(NULL, " \t"); Ok && Value != NULL; Value = strtok(NULL, " \t"))
+            {
+                Ok = *Count < BALANCE_MAX_VALUES && sscanf(Value, "%f", &Values[*Count]) == 1 && Values[*Count] > 0.0f;
+                (*Count)++;
+            }
+        }
+        else if (strcmp(Key, "pieces") == 0 || strcmp(Key, "types") == 0)
+        {
+            bool Types = Key[0] == 't';
+            int *Count = Types? &Grid->TypesCount : &Grid->PiecesCount;
+            Ok = *Count < BALANCE_MAX_VALUES;
+            if (Ok)
+            {
+                strcpy(Types? Grid->TypesText[*Count] : Grid->PiecesText[*Count], Rest);
+                Ok = Balance_ParseTable(Rest, Types? &Grid->Types[*Count] : &Grid->Pieces[*Count], Types);
+                (*Count)++;
+            }
+        }
+        else Ok = false;
+
+        if (!Ok) fprintf(stderr, "%s:%i: cannot read '%s'\n", FileName, LineNumber, Text);
+    }
+
+    fclose(File);
+
+    brick_odds Defaults;
+    Brick_DefaultOdds(&Defaults);
+    if (Grid->GravityCount == 0) Grid->Gravity[Grid->GravityCount++] = GP_GRAVITY_SECONDS;
+    if (Grid->TraceCount == 0) Grid->Trace[Grid->TraceCount++] = GP_TRACE_SECONDS;
+    if (Grid->PiecesCount == 0)
+    {
+        Grid->Pieces[0] = Defaults;
+        strcpy(Grid->PiecesText[Grid->PiecesCount++], "default");
+    }
+    if (Grid->TypesCount == 0)
+    {
+        Grid->Types[0] = Defaults;
+        strcpy(Grid->TypesText[Grid->TypesCount++], "default");
+    }
+
+    return Ok;
+}
+
+// Entries are names, optionally repeated with *N: "HCONN*3 DST FIRE"
+static bool Balance_ParseTable(char *Text, brick_odds *Odds, bool Types)
+{
+    static const char *PIECE_NAMES[] = { "EMPTY", "HCONN", "VCONN", "UL", "DL", "DR", "UR", "DST", "JUNK", "FIRE" };
+    static const char *TYPE_NAMES[] = { "CONNECTION", "JUNK", "RANDOM", "DEST", "FIRE" };
+
+    const char **Names = Types? TYPE_NAMES : PIECE_NAMES;
+    int NameCount = Types? BRICK_TYPE_COUNT : PIECE_PALLETE_SIZE;
+    int *Count = Types? &Odds->TypeCount : &Odds->PieceCount;
+    *Odds = (brick_odds){ 0 };
+
+    char Copy[BALANCE_LINE_SIZE];
+    strcpy(Copy, Text);
+
+    for (char *Entry = strtok(Copy, " \t"); Entry != NULL; Entry = strtok(NULL, " \t"))
+    {
+        int Repeat = 1;
+        char *Star = strchr(Entry, '*');
+        if (Star != NULL)
+        {
+            *Star = '\0';
+            Repeat = atoi(Star + 1);
+        }
+
+        int Value = -1;
+        for (int n = (Types? 0 : 1); n < NameCount; n++)
+        {
+            if (strcmp(Entry, Names[n]) == 0) Value = n;
+        }
+
+        if (Value < 0 || Repeat < 1 || *Count + Repeat > BRICK_ODDS_CAPACITY)
+        {
+            return false;
+        }
+
+        for (int r = 0; r < Repeat; r++)
+        {
+            if (Types) Odds->Types[(*Count)++] = (brick_type)Value;
+            else Odds->Pieces[(*Count)++] = (piece)Value;
+        }
+    }
+
+    return *Count > 0;
+}
+
+// Plays one game until it is lost or runs out of ticks
+static void Balance_PlayGame(void *Context, int Index)
+{
+    balance_run *Run = Context;
+    balance_grid *Grid = Run->Grid;
+    balance_config *Config = &Run->Configs[Index / Grid->Games];
+    balance_result *Result = &Run->Results[Index];
+    int Game = Index % Grid->Games;
+
+    bot Bot;
+    if (!Bot_Init(&Bot, Grid->BotDepth, Grid->BotWidth, NULL))
+    {
+        return;
+    }
+
+    gameplay Gameplay;
+    GP_InitRules(&Gameplay, (uint64_t)Game + 1, &Config->Rules);
+
+    for (Result->Ticks = 0; Result->Ticks < Grid->Ticks; Result->Ticks++)
+    {
+        int Score = Gameplay.Scoring.Score;
+        GP_Update(&Gameplay, Bot_Play(&Bot, &Gameplay));
+
+        if (Gameplay.Scoring.NodeChain > Result->NodeChain) Result->NodeChain = Gameplay.Scoring.NodeChain;
+        if (Gameplay.Scoring.WireChain > Result->WireChain) Result->WireChain = Gameplay.Scoring.WireChain;
+
+        // Losing starts the game over with the score reset
+        if (Gameplay.Scoring.Score < Score)
+        {
+            Result->Lost = true;
+            Result->Ticks++;
+            break;
+        }
+        Result->Score = Gameplay.Scoring.Score;
+    }
+
+    Bot_Free(&Bot);
+}
+
+static int Balance_CompareInt(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Appends mean, p10, p50, p90 and max of Values, sorting them
+static void Balance_WriteStats(FILE *File, int *Values, int Count, float Scale)
+{
+    qsort(Values, Count, sizeof(int), Balance_CompareInt);
+
+    double Sum = 0.0;
+    for (int i = 0; i < Count; i++) Sum += Values[i];
+
+    fprintf(File, ",%.2f,%.2f,%.2f,%.2f,%.2f", Sum/Count*Scale, Values[Count/10]*Scale, Values[Count/2]*Scale,
+        Values[(Count*9)/10]*Scale, Values[Count - 1]*Scale);
+}
+
+// Whole numbers above zero only, Default when the argument is left out
+static bool Balance_ParseArg(int argc, char **argv, int Index, int Default, int *Value)
+{
+    if (argc <= Index)
+    {
+        *Value = Default;
+        return true;
+    }
+
+    char *End;
+    long Number = strtol(argv[Index], &End, 10);
+    if (End == argv[Index] || *End != '\0' || Number <= 0 || Number > INT_MAX)
+    {
+        return false;
+    }
+
+    *Value = (int)Number;
+    return true;
+}
@@ -0,0 +1,580 @@
+/*******************************************************************************************
+*
+*   nettis_bench - benchmarks of the game kernels
+*
+*   Every benchmark runs over the same corpus of saved boards (tools/bench/boards.txt) on
+*   one thread. Each one is repeated BENCH_PASSES times and the fastest pass is kept, per
+*   board as well: ns_per_op is the average over the corpus, worst_board_ns the slowest
+*   board, which is what a frame budget has to survive.
+*   The benchmarks named with a size tile each saved board over a field that large.
+*
+*   Results are written as JSON. Given a baseline written the same way, every benchmark is
+*   compared to it and the tool fails if one got slower than the tolerance allows.
+*
+*   Boards are saved as BOARD_HEIGHT lines of BOARD_WIDTH characters, a blank line between
+*   boards: . empty  - | horizontal and vertical wires  J 7 r L corners (up-left, down-left,
+*   down-right, up-right)  O node  # junk  * fire
+*
+*   Usage: nettis_bench [--corpus boards.txt] [--out results.json] [--baseline baseline.json]
+*                       [--tolerance 0.15] [--make-corpus boards.txt]
+*
+********************************************************************************************/
+
+#include "core/bot.h"
+#include "core/field.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#if !defined(BENCH_DIR)
+    #define BENCH_DIR "tools/bench"
+#endif
+
+#define BENCH_MAX_BOARDS 256
+#define BENCH_PASSES 7
+#define BENCH_GAME_BOARDS 48            // Boards taken from bot games by --make-corpus
+#define BENCH_DENSE_BOARDS 16           // Random full boards, for the largest networks
+#define BENCH_TICKS_PER_BOARD 240       // GP_Update ticks run from each board
+#define BENCH_FIELD_WIDTH 256           // Stress size, each saved board is tiled over it
+#define BENCH_FIELD_HEIGHT 1024
+
+static const char PIECE_GLYPHS[PIECE_PALLETE_SIZE + 1] = ".-|J7rLO#*";
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+// Runs the benchmark on one board, returns how many operations that was
+typedef int (*bench_run)(board *Board, int Index);
+typedef void (*bench_prepare)(board *Board, int Index);
+
+typedef struct {
+    const char *Name;
+    bench_run Run;
+    bench_prepare Prepare;              // Optional, sets up each board outside the timing
+    int Repeat;                         // Runs per board and pass, to get above timer resolution
+    double NsPerOp;
+    double WorstBoardNs;
+    long long Ops;
+} bench;
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+static board Boards[BENCH_MAX_BOARDS];
+static int BoardCount = 0;
+static field Field;
+static gameplay FieldGameplay;
+static volatile unsigned int Sink = 0;  // Keeps results alive through the optimizer
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Bench_LoadCorpus(const char *FileName);
+static bool Bench_MakeCorpus(const char *FileName);
+static void Bench_Measure(bench *Bench);
+static bool Bench_WriteJson(bench *Benches, int Count, const char *FileName);
+static bool Bench_Compare(bench *Benches, int Count, const char *FileName, double Tolerance);
+
+static int Bench_Trace(board *Board, int Index);
+static int Bench_GetTrace(board *Board, int Index);
+static int Bench_GetTraceJunk(board *Board, int Index);
+static int Bench_GravityStep(board *Board, int Index);
+static int Bench_BrickRandom(board *Board, int Index);
+static int Bench_CleanSurroundings(board *Board, int Index);
+static int Bench_Update(board *Board, int Index);
+static void Bench_PrepareField(board *Board, int Index);
+static void Bench_PrepareFieldFalling(board *Board, int Index);
+static void Bench_PrepareFieldGame(board *Board, int Index);
+static int Bench_FieldGetTrace(board *Board, int Index);
+static int Bench_FieldGetTraceJunk(board *Board, int Index);
+static int Bench_FieldSettle(board *Board, int Index);
+static int Bench_FieldUpdate(board *Board, int Index);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    const char *Corpus = BENCH_DIR "/boards.txt";
+    const char *Out = NULL;
+    const char *Baseline = NULL;
+    double Tolerance = 0.15;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool HasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--corpus") == 0 && HasValue) Corpus = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && HasValue) Out = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && HasValue) Baseline = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && HasValue) Tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--make-corpus") == 0 && HasValue) return Bench_MakeCorpus(argv[++i])? 0 : 1;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--corpus boards.txt] [--out results.json] [--baseline baseline.json] "
+                "[--tolerance 0.15] [--make-corpus boards.txt]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!Bench_LoadCorpus(Corpus))
+    {
+        return 1;
+    }
+
+    bench Benches[] = {
+        { "Board_Trace", Bench_Trace, NULL, 200, 0.0, 0.0, 0 },
+        { "Board_GetTrace", Bench_GetTrace, NULL, 200, 0.0, 0.0, 0 },
+        { "Board_GetTraceJunk", Bench_GetTraceJunk, NULL, 200, 0.0, 0.0, 0 },
+        { "Board_GravityStep", Bench_GravityStep, NULL, 200, 0.0, 0.0, 0 },
+        { "Brick_Random", Bench_BrickRandom, NULL, 10, 0.0, 0.0, 0 },
+        { "Board_CleanSurroundings", Bench_CleanSurroundings, NULL, 100, 0.0, 0.0, 0 },
+        { "GP_Update", Bench_Update, NULL, 10, 0.0, 0.0, 0 },
+        { "Field_GetTrace 256x1024", Bench_FieldGetTrace, Bench_PrepareField, 1, 0.0, 0.0, 0 },
+        { "Field_GetTraceJunk 256x1024", Bench_FieldGetTraceJunk, Bench_PrepareField, 1, 0.0, 0.0, 0 },
+        { "Field_Settle 256x1024", Bench_FieldSettle, Bench_PrepareFieldFalling, 1, 0.0, 0.0, 0 },
+        { "GP_Update 256x1024", Bench_FieldUpdate, Bench_PrepareFieldGame, 1, 0.0, 0.0, 0 },
+    };
+    int Count = sizeof(Benches)/sizeof(Benches[0]);
+
+    printf("%i boards from %s\n", BoardCount, Corpus);
+    for (int b = 0; b < Count; b++)
+    {
+        Bench_Measure(&Benches[b]);
+        printf("%-24s %10.1f ns/op %10.1f ns worst board\n", Benches[b].Name, Benches[b].NsPerOp, Benches[b].WorstBoardNs);
+    }
+
+    if (Out != NULL && !Bench_WriteJson(Benches, Count, Out))
+    {
+        return 1;
+    }
+
+    if (Baseline != NULL && !Bench_Compare(Benches, Count, Baseline, Tolerance))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static bool Bench_LoadCorpus(const char *FileName)
+{
+    FILE *File = fopen(FileName, "r");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", FileName);
+        return false;
+    }
+
+    char Line[256];
+    int Row = 0;
+    BoardCount = 0;
+
+    while (fgets(Line, sizeof(Line), File) != NULL && BoardCount < BENCH_MAX_BOARDS)
+    {
+        Line[strcspn(Line, "\r\n")] = '\0';
+        if (Line[0] == '\0')
+        {
+            continue;
+        }
+
+        if (Row == 0)
+        {
+            Board_Reset(&Boards[BoardCount]);
+        }
+
+        for (int x = 0; x < BOARD_WIDTH && Line[x] != '\0'; x++)
+        {
+            const char *Glyph = strchr(PIECE_GLYPHS, Line[x]);
+            if (Glyph == NULL)
+            {
+                fprintf(stderr, "%s: unknown piece '%c'\n", FileName, Line[x]);
+                fclose(File);
+                return false;
+            }
+            Board_SetTile(&Boards[BoardCount], x, Row, (piece)(Glyph - PIECE_GLYPHS));
+        }
+
+        if (++Row == BOARD_HEIGHT)
+        {
+            Row = 0;
+            BoardCount++;
+        }
+    }
+
+    fclose(File);
+
+    if (BoardCount == 0)
+    {
+        fprintf(stderr, "%s: no boards\n", FileName);
+        return false;
+    }
+
+    return true;
+}
+
+// Boards met by the bot in long games, plus dense random boards that grow the largest
+// networks the traces have to walk
+static bool Bench_MakeCorpus(const char *FileName)
+{
+    FILE *File = fopen(FileName, "w");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", FileName);
+        return false;
+    }
+
+    static gameplay Gameplay;
+    bot Bot;
+    if (!Bot_Init(&Bot, 1, 4, NULL))
+    {
+        fclose(File);
+        return false;
+    }
+
+    int Saved = 0;
+    for (int Game = 0; Saved < BENCH_GAME_BOARDS; Game++)
+    {
+        GP_Init(&Gameplay, (uint64_t)Game + 1);
+        Bot_Restart(&Bot);
+
+        for (int Tick = 1; Tick <= GP_TICKS_PER_SECOND*120 && Saved < BENCH_GAME_BOARDS; Tick++)
+        {
+            GP_Update(&Gameplay, Bot_Play(&Bot, &Gameplay));
+
+            if (Tick % (GP_TICKS_PER_SECOND*10) != 0 || BB_PopCount(Gameplay.Board.Occupied) < BOARD_CELLS/4)
+            {
+                continue;
+            }
+
+            for (int y = 0; y < BOARD_HEIGHT; y++)
+            {
+                for (int x = 0; x < BOARD_WIDTH; x++) fputc(PIECE_GLYPHS[Board_GetTile(&Gameplay.Board, x, y)], File);
+                fputc('\n', File);
+            }
+            fputc('\n', File);
+            Saved++;
+        }
+    }
+
+    rng Rng;
+    Rng_Seed(&Rng, 2024);
+    for (int b = 0; b < BENCH_DENSE_BOARDS; b++)
+    {
+        for (int y = 0; y < BOARD_HEIGHT; y++)
+        {
+            for (int x = 0; x < BOARD_WIDTH; x++)
+            {
+                // Mostly wires and nodes, a few junk and fire pieces
+                unsigned int Roll = Rng_Below(&Rng, 100);
+                piece Piece = (Roll < 80)? (piece)(PIECE_HCONN + Rng_Below(&Rng, 6)) : (Roll < 94)? PIECE_DST : (Roll < 98)? PIECE_JUNK : PIECE_FIRE;
+                fputc(PIECE_GLYPHS[Piece], File);
+            }
+            fputc('\n', File);
+        }
+        fputc('\n', File);
+    }
+
+    Bot_Free(&Bot);
+    fclose(File);
+    printf("%i boards written to %s\n", Saved + BENCH_DENSE_BOARDS, FileName);
+    return true;
+}
+
+static void Bench_Measure(bench *Bench)
+{
+    static double BoardNs[BENCH_MAX_BOARDS];
+    double BestTotal = 0.0;
+
+    for (int b = 0; b < BoardCount; b++) BoardNs[b] = 0.0;
+
+    for (int Pass = 0; Pass < BENCH_PASSES; Pass++)
+    {
+        double Total = 0.0;
+        long long Ops = 0;
+
+        for (int b = 0; b < BoardCount; b++)
+        {
+            int BoardOps = 0;
+            if (Bench->Prepare != NULL) Bench->Prepare(&Boards[b], b);
+
+            double Start = Pool_Seconds();
+            for (int r = 0; r < Bench->Repeat; r++)
+            {
+                BoardOps += Bench->Run(&Boards[b], b);
+            }
+            double Seconds = Pool_Seconds() - Start;
+
+            Total += Seconds;
+            Ops += BoardOps;
+
+            double Ns = (BoardOps > 0)? Seconds*1e9/BoardOps : 0.0;
+            if (Pass == 0 || Ns < BoardNs[b]) BoardNs[b] = Ns;
+        }
+
+        if (Pass == 0 || Total < BestTotal)
+        {
+            BestTotal = Total;
+            Bench->Ops = Ops;
+        }
+    }
+
+    Bench->NsPerOp = (Bench->Ops > 0)? BestTotal*1e9/Bench->Ops : 0.0;
+    Bench->WorstBoardNs = 0.0;
+    for (int b = 0; b < BoardCount; b++)
+    {
+        if (BoardNs[b] > Bench->WorstBoardNs) Bench->WorstBoardNs = BoardNs[b];
+    }
+}
+
+static bool Bench_WriteJson(bench *Benches, int Count, const char *FileName)
+{
+    FILE *File = fopen(FileName, "w");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot write %s\n", FileName);
+        return false;
+    }
+
+    fprintf(File, "{\n  \"boards\": %i,\n  \"passes\": %i,\n  \"benchmarks\": [\n", BoardCount, BENCH_PASSES);
+    for (int b = 0; b < Count; b++)
+    {
+        fprintf(File, "    { \"name\": \"%s\", \"ns_per_op\": %.2f, \"worst_board_ns\": %.2f, \"ops\": %lld }%s\n",
+            Benches[b].Name, Benches[b].NsPerOp, Benches[b].WorstBoardNs, Benches[b].Ops, (b + 1 < Count)? "," : "");
+    }
+    fprintf(File, "  ]\n}\n");
+
+    fclose(File);
+    return true;
+}
+
+// Reads back what Bench_WriteJson() writes, one benchmark per line
+static bool Bench_Compare(bench *Benches, int Count, const char *FileName, double Tolerance)
+{
+    FILE *File = fopen(FileName, "r");
+    if (File == NULL)
+    {
+        fprintf(stderr, "Cannot read %s\n", FileName);
+        return false;
+    }
+
+    bool Ok = true;
+    char Line[512];
+    printf("\n%-24s %12s %12s %8s\n", "compared to baseline", "ns/op", "baseline", "ratio");
+
+    while (fgets(Line, sizeof(Line), File) != NULL)
+    {
+        char Name[64];
+        double NsPerOp = 0.0, WorstBoardNs = 0.0;
+        const char *Entry = strstr(Line, "\"name\"");
+        if (Entry == NULL || sscanf(Entry, "\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"worst_board_ns\": %lf", Name, &NsPerOp, &WorstBoardNs) != 3)
+        {
+            continue;
+        }
+
+        for (int b = 0; b < Count; b++)
+        {
+            if (strcmp(Benches[b].Name, Name) != 0 || NsPerOp <= 0.0)
+            {
+                continue;
+            }
+
+            double Ratio = Benches[b].NsPerOp/NsPerOp;
+            double WorstRatio = (WorstBoardNs > 0.0)? Benches[b].WorstBoardNs/WorstBoardNs : 1.0;
+            bool Slower = Ratio > 1.0 + Tolerance || WorstRatio > 1.0 + Tolerance;
+            printf("%-24s %12.1f %12.1f %8.2f%s\n", Name, Benches[b].NsPerOp, NsPerOp, Ratio, Slower? "  SLOWER" : "");
+            if (Slower) Ok = false;
+        }
+    }
+
+    fclose(File);
+    return Ok;
+}
+
+// One op per node: the power trace from it, as Board_GetTrace() starts them
+static int Bench_Trace(board *Board, int Index)
+{
+    power_board Powers = { 0 };
+    trace Trace;
+    int Ops = 0;
+
+    bitboard Nodes = Board->Planes[PIECE_DST];
+    while (!BB_IsEmpty(Nodes))
+    {
+        int i = BB_Lowest(Nodes);
+        Nodes = BB_AndNot(Nodes, BB_Cell(i));
+        Board_Trace(Board, i % BOARD_WIDTH, i / BOARD_WIDTH, &Powers, &Trace);
+        Sink += Trace.Count;
+        Ops++;
+    }
+
+    return Ops;
+}
+
+static int Bench_GetTrace(board *Board, int Index)
+{
+    power_board Powers = { 0 };
+    trace Trace;
+    Board_GetTrace(Board, &Powers, &Trace);
+    Sink += Trace.Count;
+    return 1;
+}
+
+static int Bench_GetTraceJunk(board *Board, int Index)
+{
+    trace Trace;
+    Board_GetTraceJunk(Board, &Trace);
+    Sink += Trace.Count;
+    return 1;
+}
+
+// One op per step, on the board with every other row emptied so everything above falls
+static int Bench_GravityStep(board *Board, int Index)
+{
+    board Falling = *Board;
+    for (int y = BOARD_HEIGHT - 1; y >= 0; y -= 2)
+    {
+        for (int x = 0; x < BOARD_WIDTH; x++) Board_SetTile(&Falling, x, y, PIECE_EMPTY);
+    }
+
+    int Ops = 1;
+    while (Board_GravityStep(&Falling)) Ops++;
+    Sink += Falling.Version;
+    return Ops;
+}
+
+static int Bench_BrickRandom(board *Board, int Index)
+{
+    const brick_table *Table = Brick_DefaultTable();
+    rng Rng;
+    Rng_Seed(&Rng, (uint64_t)Index);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        brick Brick = Brick_Random(&Rng, Table);
+        Sink += Brick.Pieces[0] + Brick.Pieces[1];
+    }
+
+    return 1000;
+}
+
+// One op per cell, each on the board as saved
+static int Bench_CleanSurroundings(board *Board, int Index)
+{
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        board Cleaned = *Board;
+        Board_CleanSurroundings(&Cleaned, i % BOARD_WIDTH, i / BOARD_WIDTH);
+        Sink += Cleaned.Version;
+    }
+
+    return BOARD_CELLS;
+}
+
+// One op per tick of a game started on the saved board, with a fixed input pattern
+static int Bench_Update(board *Board, int Index)
+{
+    static gameplay Gameplay;
+    GP_Init(&Gameplay, (uint64_t)Index + 1);
+    Gameplay.Board = *Board;
+    Gameplay.Board.Version++;
+
+    rng Rng;
+    Rng_Seed(&Rng, (uint64_t)Index);
+    for (int t = 0; t < BENCH_TICKS_PER_BOARD; t++)
+    {
+        unsigned int Roll = Rng_Below(&Rng, 16);
+        GP_Update(&Gameplay, (Roll < 4)? 1u<<Roll : 0);
+    }
+
+    Sink += Gameplay.Scoring.Score;
+    return BENCH_TICKS_PER_BOARD;
+}
+
+// The saved board tiled over a stress size field
+static void Bench_PrepareField(board *Board, int Index)
+{
+    if (Field.Cells == NULL && !Field_Init(&Field, BENCH_FIELD_WIDTH, BENCH_FIELD_HEIGHT))
+    {
+        fprintf(stderr, "Out of memory for a %ix%i field\n", BENCH_FIELD_WIDTH, BENCH_FIELD_HEIGHT);
+        exit(1);
+    }
+
+    Field_CopyBoard(&Field, Board);
+}
+
+// Same, with every other row emptied so everything above falls
+static void Bench_PrepareFieldFalling(board *Board, int Index)
+{
+    Bench_PrepareField(Board, Index);
+
+    for (int y = Field.Height - 1; y >= 0; y -= 2)
+    {
+        for (int x = 0; x < Field.Width; x++) Field_SetTile(&Field, x, y, PIECE_EMPTY);
+    }
+}
+
+static void Bench_PrepareFieldGame(board *Board, int Index)
+{
+    gp_rules Rules = GP_DefaultRules();
+    Rules.Width = BENCH_FIELD_WIDTH;
+    Rules.Height = BENCH_FIELD_HEIGHT;
+
+    GP_Free(&FieldGameplay);
+    if (!GP_InitRules(&FieldGameplay, (uint64_t)Index + 1, &Rules))
+    {
+        fprintf(stderr, "Out of memory for a %ix%i field\n", BENCH_FIELD_WIDTH, BENCH_FIELD_HEIGHT);
+        exit(1);
+    }
+
+    Field_CopyBoard(&FieldGameplay.Field, Board);
+}
+
+// A full evaluation, as after a game over
+static int Bench_FieldGetTrace(board *Board, int Index)
+{
+    static field_trace Trace;
+    if (Trace.Cells == NULL) Field_TraceInit(&Trace, &Field);
+
+    Field_GetTrace(&Field, &Trace);
+    Sink += Trace.Count;
+    return 1;
+}
+
+static int Bench_FieldGetTraceJunk(board *Board, int Index)
+{
+    static field_trace Trace;
+    if (Trace.Cells == NULL) Field_TraceInit(&Trace, &Field);
+
+    Field_GetTraceJunk(&Field, &Trace);
+    Sink += Trace.Count;
+    return 1;
+}
+
+static int Bench_FieldSettle(board *Board, int Index)
+{
+    Sink += Field_Settle(&Field);
+    return 1;
+}
+
+// Bench_Update() on the tiled field, the first tick evaluates all of it
+static int Bench_FieldUpdate(board *Board, int Index)
+{
+    rng Rng;
+    Rng_Seed(&Rng, (uint64_t)Index);
+    for (int t = 0; t < BENCH_TICKS_PER_BOARD; t++)
+    {
+        unsigned int Roll = Rng_Below(&Rng, 16);
+        GP_Update(&FieldGameplay, (Roll < 4)? 1u<<Roll : 0);
+    }
+
+    Sink += FieldGameplay.Scoring.Score;
+    return BENCH_TICKS_PER_BOARD;
+}
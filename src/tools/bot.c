@@ -0,0 +1,124 @@
+/*******************************************************************************************
+*
+*   nettis_bot - headless games played by the placement search bot
+*
+*   Every game is driven only through GP_Update() input, one GP_INPUT_* per tick from
+*   Bot_Play(). Searches run on every CPU and the tool reports the search throughput in
+*   evaluated placements (nodes) per second
+*
+*   Usage: nettis_bot [games] [ticks] [depth] [width] [threads]
+*
+********************************************************************************************/
+
+#include "core/bot.h"
+#include "pool.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define BOT_DEFAULT_GAMES 4
+#define BOT_DEFAULT_TICKS (GP_TICKS_PER_SECOND*60*10)
+#define BOT_DEFAULT_DEPTH 3
+#define BOT_DEFAULT_WIDTH 32
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Bot_ParseArg(int argc, char **argv, int Index, int Default, int *Value);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    int Games, Ticks, Depth, Width, Threads;
+    if (argc > 6 || !Bot_ParseArg(argc, argv, 1, BOT_DEFAULT_GAMES, &Games) ||
+        !Bot_ParseArg(argc, argv, 2, BOT_DEFAULT_TICKS, &Ticks) ||
+        !Bot_ParseArg(argc, argv, 3, BOT_DEFAULT_DEPTH, &Depth) ||
+        !Bot_ParseArg(argc, argv, 4, BOT_DEFAULT_WIDTH, &Width) ||
+        !Bot_ParseArg(argc, argv, 5, 0, &Threads))
+    {
+        fprintf(stderr, "Usage: %s [games] [ticks] [depth] [width] [threads], all above zero\n", argv[0]);
+        return 1;
+    }
+    Pool_SetThreads(Threads);
+
+    static gameplay Gameplay;
+    bot Bot;
+    if (!Bot_Init(&Bot, Depth, Width, Pool_For))
+    {
+        fprintf(stderr, "Out of memory for a beam of %i\n", Width);
+        return 1;
+    }
+
+    printf("%i games, %i ticks, depth %i, width %i, %i threads\n", Games, Ticks, Bot.Depth, Bot.Width, Pool_Threads());
+
+    double PlaySeconds = 0.0;
+
+    for (int Game = 0; Game < Games; Game++)
+    {
+        GP_Init(&Gameplay, (uint64_t)Game + 1);
+        Bot_Restart(&Bot);
+
+        int Bricks = 0, Losses = 0, Best = 0;
+
+        for (int Tick = 0; Tick < Ticks; Tick++)
+        {
+            int Head = Gameplay.Queue.Head;
+
+            double Start = Pool_Seconds();
+            unsigned int Input = Bot_Play(&Bot, &Gameplay);
+            PlaySeconds += Pool_Seconds() - Start;
+
+            int Score = Gameplay.Scoring.Score;
+            GP_Update(&Gameplay, Input);
+
+            if (Gameplay.Queue.Head != Head) Bricks++;
+
+            // A lost game starts over with the score reset
+            if (Gameplay.Scoring.Score < Score)
+            {
+                Losses++;
+                if (Score > Best) Best = Score;
+            }
+        }
+
+        if (Gameplay.Scoring.Score > Best) Best = Gameplay.Scoring.Score;
+        printf("game %i: score %i, best %i, %i bricks, %i lost\n", Game + 1, Gameplay.Scoring.Score, Best, Bricks, Losses);
+    }
+
+    printf("%u searches, %llu nodes in %.3f s, %.0f nodes/s\n", Bot.Searches, Bot.Nodes, PlaySeconds,
+        (PlaySeconds > 0.0)? Bot.Nodes/PlaySeconds : 0.0);
+
+    Bot_Free(&Bot);
+    return 0;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definition
+//------------------------------------------------------------------------------------
+// Positional argument Index, Default when it is not given. False unless it is a whole number
+// above zero
+static bool Bot_ParseArg(int argc, char **argv, int Index, int Default, int *Value)
+{
+    if (argc <= Index)
+    {
+        *Value = Default;
+        return true;
+    }
+
+    char *End;
+    long Number = strtol(argv[Index], &End, 10);
+    if (End == argv[Index] || *End != '\0' || Number <= 0 || Number > INT_MAX)
+    {
+        return false;
+    }
+
+    *Value = (int)Number;
+    return true;
+}
@@ -0,0 +1,444 @@
+/*******************************************************************************************
+*
+*   nettis_check - headless equivalence checks of the core
+*
+*   The core reaches the same state more than one way, every pair of ways is played side by
+*   side here and has to agree:
+*     - the field kernels against the board ones, on random boards
+*     - gravity step by step against a settle, and the hash each keeps against one from scratch
+*     - a standard 6x13 game against the same game forced through the field path, tick for
+*       tick, with the same bot input. Fields resolve every tick, so this is also cascade
+*       playback against step by step resolution, bricks locking mid-chain included
+*     - the board and score Cascade.Outcome predicts against those the chain ends with
+*     - a game against a copy restored from its snapshot every few ticks, chains under way
+*       included, into the copy that still holds the chain or a new game that has to resolve
+*       it again. Both have to take the same snapshot again and go on the same way
+*     - a game evaluating through a small trace_cache against one evaluating every board, so
+*       entries are hit, evicted and overwritten all along
+*     - key presses and releases taken a tick at a time against the ticks they have to reach:
+*       several presses in one tick, a key held through Das and Arr and the release ending it
+*
+*   Prints one line per check and exits with 1 on the first mismatch. ctest runs it
+*
+*   Usage: nettis_check
+*
+********************************************************************************************/
+
+#include "core/bot.h"
+#include "core/snapshot.h"
+#include "core/input.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define CHECK_BOARDS 2000               // Random boards for the kernels
+#define CHECK_GAMES 3
+#define CHECK_TICKS (GP_TICKS_PER_SECOND*60)
+#define CHECK_BOT_DEPTH 2               // A shallow bot still sets off chains
+#define CHECK_BOT_WIDTH 8
+#define CHECK_SNAPSHOT_STRIDE 50        // Ticks played from each restored snapshot
+#define CHECK_CACHE_ENTRIES 16          // Few enough for boards to keep taking each other's slot
+#define CHECK_INPUT_TICKS 20
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Check_Kernels(void);
+static bool Check_FieldGame(bot *Bot, uint64_t Seed, int *Chains, int *MidChain);
+static bool Check_SnapshotGame(bot *Bot, uint64_t Seed, int *MidChain);
+static bool Check_CacheGame(bot *Bot, uint64_t Seed, trace_cache *Cache);
+static bool Check_Input(void);
+static bool Check_InitField(gameplay *Gameplay, uint64_t Seed);
+static piece Check_RandomPiece(rng *Rng);
+static bool Check_SameTrace(trace *Trace, field_trace *FieldTrace);
+static bool Check_SameBoardTrace(trace *a, trace *b);
+static bool Check_SamePowers(power_board *Powers, field *Field);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(void)
+{
+    bot Bot;
+    if (!Bot_Init(&Bot, CHECK_BOT_DEPTH, CHECK_BOT_WIDTH, NULL))
+    {
+        fprintf(stderr, "Out of memory for the bot\n");
+        return 1;
+    }
+
+    bool Passed = Check_Kernels();
+    printf("field kernels: %s\n", Passed? "ok" : "MISMATCH");
+
+    int Chains = 0, MidChain = 0;
+    for (int Game = 0; Passed && Game < CHECK_GAMES; Game++)
+    {
+        Passed = Check_FieldGame(&Bot, (uint64_t)Game + 1, &Chains, &MidChain);
+        printf("field game %i: %s\n", Game + 1, Passed? "ok" : "MISMATCH");
+    }
+
+    // Games that never lock mid-chain would leave the catch-up untested
+    if (Passed)
+    {
+        Passed = Chains > 0 && MidChain > 0;
+        printf("cascades: %i chains, %i locked mid-chain, %s\n", Chains, MidChain, Passed? "ok" : "NOT COVERED");
+    }
+
+    int Resumed = 0;
+    for (int Game = 0; Passed && Game < CHECK_GAMES; Game++)
+    {
+        Passed = Check_SnapshotGame(&Bot, (uint64_t)Game + 1, &Resumed);
+        printf("snapshot game %i: %s\n", Game + 1, Passed? "ok" : "MISMATCH");
+    }
+
+    if (Passed)
+    {
+        Passed = Resumed > 0;
+        printf("snapshots: %i taken mid-chain, %s\n", Resumed, Passed? "ok" : "NOT COVERED");
+    }
+
+    trace_cache Cache;
+    if (Passed && !Cache_Init(&Cache, CHECK_CACHE_ENTRIES))
+    {
+        fprintf(stderr, "Out of memory for the cache\n");
+        Passed = false;
+    }
+
+    for (int Game = 0; Passed && Game < CHECK_GAMES; Game++)
+    {
+        Passed = Check_CacheGame(&Bot, (uint64_t)Game + 1, &Cache);
+        printf("cache game %i: %s\n", Game + 1, Passed? "ok" : "MISMATCH");
+    }
+
+    // More misses than entries, so slots were taken over
+    if (Passed)
+    {
+        Passed = Cache.Hits > 0 && Cache.Misses > Cache.Mask + 1;
+        printf("cache: %llu hits, %llu misses on %u entries, %s\n", Cache.Hits, Cache.Misses, Cache.Mask + 1,
+            Passed? "ok" : "NOT COVERED");
+        Cache_Free(&Cache);
+    }
+
+    if (Passed)
+    {
+        Passed = Check_Input();
+        printf("input: %s\n", Passed? "ok" : "MISMATCH");
+    }
+
+    Bot_Free(&Bot);
+    return Passed? 0 : 1;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definition
+//------------------------------------------------------------------------------------
+// Traces, power, gravity and junk cleaning on a 6x13 field copied from a random board. The
+// board hashes, kept up to date by every change, have to be the ones computed from scratch
+static bool Check_Kernels(void)
+{
+    static field Field, Settled;
+    static field_trace FieldTrace;
+    if (!Field_Init(&Field, BOARD_WIDTH, BOARD_HEIGHT) || !Field_Init(&Settled, BOARD_WIDTH, BOARD_HEIGHT) ||
+        !Field_TraceInit(&FieldTrace, &Field))
+    {
+        fprintf(stderr, "Out of memory for the fields\n");
+        return false;
+    }
+
+    rng Rng;
+    Rng_Seed(&Rng, 7);
+    bool Passed = true;
+
+    for (int i = 0; Passed && i < CHECK_BOARDS; i++)
+    {
+        board Board = { 0 };
+        for (int Cell = 0; Cell < BOARD_CELLS; Cell++)
+        {
+            Board_SetTile(&Board, Cell % BOARD_WIDTH, Cell / BOARD_WIDTH, Check_RandomPiece(&Rng));
+        }
+        Field_CopyBoard(&Field, &Board);
+
+        trace Trace;
+        power_board Powers = { 0 };
+        Board_GetTrace(&Board, &Powers, &Trace);
+        Field_GetTrace(&Field, &FieldTrace);
+        Passed &= Check_SameTrace(&Trace, &FieldTrace) && Check_SamePowers(&Powers, &Field);
+
+        Board_GetTraceJunk(&Board, &Trace);
+        Field.TouchedJunk.All = true;
+        Field_GetTraceJunk(&Field, &FieldTrace);
+        Passed &= Check_SameTrace(&Trace, &FieldTrace);
+
+        board Fallen = Board;
+        Field_CopyBoard(&Settled, &Board);
+        Passed &= Board_Settle(&Fallen, NULL) == Field_Settle(&Settled);
+        Passed &= Board_Checksum(&Fallen) == Field_Checksum(&Settled);
+
+        board Stepped = Board;
+        while (Board_GravityStep(&Stepped));
+        Passed &= Board_Checksum(&Stepped) == Board_Checksum(&Fallen) && Stepped.Hash == Fallen.Hash;
+        Passed &= Fallen.Hash == Board_ComputeHash(&Fallen);
+
+        int x = (int)Rng_Below(&Rng, BOARD_WIDTH), y = (int)Rng_Below(&Rng, BOARD_HEIGHT);
+        Board_CleanSurroundings(&Board, x, y);
+        Field_CleanSurroundings(&Field, x, y);
+        Passed &= Board_Checksum(&Board) == Field_Checksum(&Field);
+        Passed &= Board.Hash == Board_ComputeHash(&Board);
+    }
+
+    Field_TraceFree(&FieldTrace);
+    Field_Free(&Settled);
+    Field_Free(&Field);
+    return Passed;
+}
+
+// The bot plays the standard game and the field game is given the same input. Counts the
+// chains resolved ahead and the bricks that locked while one was played back
+static bool Check_FieldGame(bot *Bot, uint64_t Seed, int *Chains, int *MidChain)
+{
+    static gameplay Game, FieldGame;
+    GP_Init(&Game, Seed);
+    if (!Check_InitField(&FieldGame, Seed))
+    {
+        fprintf(stderr, "Out of memory for the field game\n");
+        return false;
+    }
+    Bot_Restart(Bot);
+
+    bool Passed = true;
+    bool Predicted = false;
+    board Outcome;
+    int OutcomeScore = 0;
+    for (int Tick = 0; Passed && Tick < CHECK_TICKS; Tick++)
+    {
+        int Head = Game.Queue.Head;
+        bool Active = Game.Cascade.Active;
+
+        unsigned int Input = Bot_Play(Bot, &Game);
+        GP_Update(&Game, Input);
+        GP_Update(&FieldGame, Input);
+
+        Passed = GP_Checksum(&Game) == GP_Checksum(&FieldGame) &&
+            Game.Scoring.Score == FieldGame.Scoring.Score &&
+            Game.Brick.x == FieldGame.Brick.x && Game.Brick.y == FieldGame.Brick.y &&
+            Game.Brick.Orientation == FieldGame.Brick.Orientation &&
+            GP_IsIdle(&Game) == GP_IsIdle(&FieldGame);
+        if (!Passed) fprintf(stderr, "Seed %llu, tick %i: the field game went another way\n", (unsigned long long)Seed, Tick);
+
+        // A lock adds pieces the outcome could not know about
+        if (Game.Queue.Head != Head)
+        {
+            Predicted = false;
+            if (Active) (*MidChain)++;
+        }
+
+        // Built this tick, from the next one on
+        if (Game.Cascade.Active && Game.Cascade.Start == Game.Tick)
+        {
+            if (!Predicted) (*Chains)++;
+            Predicted = true;
+            Outcome = Game.Cascade.Outcome;
+            OutcomeScore = Game.Cascade.OutcomeScore;
+        }
+        else if (Predicted && GP_IsIdle(&Game))
+        {
+            Predicted = false;
+            if (Board_Checksum(&Outcome) != GP_Checksum(&Game) || OutcomeScore != Game.Scoring.Score)
+            {
+                fprintf(stderr, "Seed %llu, tick %i: the chain did not end as predicted\n", (unsigned long long)Seed, Tick);
+                Passed = false;
+            }
+        }
+    }
+
+    GP_Free(&FieldGame);
+    return Passed;
+}
+
+// The bot plays a game and a second one is restored from its snapshot every stride, then
+// both are given the same input until the next one. Every other stride the second game
+// starts over first, so it has no chain to play again. Counts the snapshots taken mid-chain
+static bool Check_SnapshotGame(bot *Bot, uint64_t Seed, int *MidChain)
+{
+    static gameplay Game, Restored;
+    GP_Init(&Game, Seed);
+    GP_Init(&Restored, Seed);
+    Bot_Restart(Bot);
+
+    bool Passed = true;
+    for (int Tick = 0; Passed && Tick < CHECK_TICKS; Tick++)
+    {
+        if (Tick % CHECK_SNAPSHOT_STRIDE == 0)
+        {
+            // Padding included, so the packed bytes compare as a whole
+            snapshot Taken, Again;
+            memset(&Taken, 0, sizeof(Taken));
+            memset(&Again, 0, sizeof(Again));
+            Snapshot_Take(&Taken, &Game);
+            if (Taken.Flags & SNAPSHOT_CASCADE) (*MidChain)++;
+            if ((Tick / CHECK_SNAPSHOT_STRIDE) % 2 == 1) GP_Init(&Restored, Seed);
+            Snapshot_Restore(&Taken, &Restored);
+            Snapshot_Take(&Again, &Restored);
+
+            Passed = memcmp(&Taken, &Again, sizeof(Taken)) == 0 && GP_Hash(&Game) == GP_Hash(&Restored);
+            if (!Passed)
+            {
+                fprintf(stderr, "Seed %llu, tick %i: the restored game is not the one taken\n", (unsigned long long)Seed, Tick);
+                break;
+            }
+        }
+
+        unsigned int Input = Bot_Play(Bot, &Game);
+        GP_Update(&Game, Input);
+        GP_Update(&Restored, Input);
+
+        Passed = GP_Hash(&Game) == GP_Hash(&Restored) && GP_IsIdle(&Game) == GP_IsIdle(&Restored) &&
+            memcmp(&Game.Powers, &Restored.Powers, sizeof(Game.Powers)) == 0;
+        if (!Passed) fprintf(stderr, "Seed %llu, tick %i: the restored game went another way\n", (unsigned long long)Seed, Tick);
+    }
+
+    return Passed;
+}
+
+// The bot plays the game without a cache and the one with it is given the same input. The
+// cache is kept across games, it never has to be cleared between them. Games only evaluate a
+// board again now and then, so every tick the board is also looked up directly
+static bool Check_CacheGame(bot *Bot, uint64_t Seed, trace_cache *Cache)
+{
+    static gameplay Game, Cached;
+    GP_Init(&Game, Seed);
+    GP_Init(&Cached, Seed);
+    Cached.Cache = Cache;
+    Bot_Restart(Bot);
+
+    bool Passed = true;
+    for (int Tick = 0; Passed && Tick < CHECK_TICKS; Tick++)
+    {
+        unsigned int Input = Bot_Play(Bot, &Game);
+        GP_Update(&Game, Input);
+        GP_Update(&Cached, Input);
+
+        Passed = GP_Hash(&Game) == GP_Hash(&Cached) && GP_IsIdle(&Game) == GP_IsIdle(&Cached) &&
+            memcmp(&Game.Powers, &Cached.Powers, sizeof(Game.Powers)) == 0 &&
+            Check_SameBoardTrace(&Game.Trace, &Cached.Trace) && Check_SameBoardTrace(&Game.TraceJunk, &Cached.TraceJunk);
+        if (!Passed) fprintf(stderr, "Seed %llu, tick %i: the cached game went another way\n", (unsigned long long)Seed, Tick);
+
+        board Board = Game.Board;
+        power_board Powers, CachedPowers;
+        trace Trace, CachedTrace;
+        Cache_GetTrace(NULL, &Board, &Powers, &Trace);
+        Cache_GetTrace(Cache, &Board, &CachedPowers, &CachedTrace);
+        Passed &= memcmp(&Powers, &CachedPowers, sizeof(Powers)) == 0 && Check_SameBoardTrace(&Trace, &CachedTrace);
+
+        Cache_GetTraceJunk(NULL, &Board, &Trace);
+        Cache_GetTraceJunk(Cache, &Board, &CachedTrace);
+        Passed &= Check_SameBoardTrace(&Trace, &CachedTrace);
+        if (!Passed) fprintf(stderr, "Seed %llu, tick %i: the cache returned another trace\n", (unsigned long long)Seed, Tick);
+    }
+
+    return Passed;
+}
+
+// A standard size game on a field, the way GP_InitRules() sets up any other size
+// Events queued up front and taken a tick at a time, like the game does with what it polls.
+// Times are in ticks, inside them rather than on their edges
+static bool Check_Input(void)
+{
+    static const struct { double Tick; unsigned int Flag; bool Down; } Events[] = {
+        { 0.1, GP_INPUT_ROTATE, true },
+        { 0.2, GP_INPUT_ROTATE, false },
+        { 0.3, GP_INPUT_ROTATE, true },     // Tick 0 has a rotation, this one and all after wait
+        { 0.4, GP_INPUT_LEFT, true },       // Held, repeats from 10.4 every 2 ticks
+        { 0.5, GP_INPUT_RIGHT, true },
+        { 0.6, GP_INPUT_RIGHT, false },     // A tap, no repeat
+        { 15.5, GP_INPUT_LEFT, false },     // Before the repeat at 16.4
+        { 15.6, GP_INPUT_ROTATE, false },   // Held all along, rotation does not repeat
+    };
+    static const unsigned int Expected[CHECK_INPUT_TICKS] = {
+        GP_INPUT_ROTATE, GP_INPUT_ROTATE | GP_INPUT_LEFT | GP_INPUT_RIGHT, 0, 0, 0, 0, 0, 0, 0, 0,
+        GP_INPUT_LEFT, 0, GP_INPUT_LEFT, 0, GP_INPUT_LEFT, 0, 0, 0, 0, 0,
+    };
+
+    input_config Config = Input_DefaultConfig();
+    Config.Das = INPUT_DAS_SECONDS;
+    Config.Arr = INPUT_ARR_SECONDS;
+    input_queue Queue;
+    Input_Init(&Queue, &Config);
+    for (int i = 0; i < (int)(sizeof(Events)/sizeof(Events[0])); i++)
+    {
+        double Time = Events[i].Tick/GP_TICKS_PER_SECOND;
+        if (Events[i].Down) Input_Press(&Queue, Events[i].Flag, Time);
+        else Input_Release(&Queue, Events[i].Flag, Time);
+    }
+
+    for (int Tick = 0; Tick < CHECK_INPUT_TICKS; Tick++)
+    {
+        unsigned int Input = Input_Take(&Queue, (double)(Tick + 1)/GP_TICKS_PER_SECOND, 0);
+        if (Input != Expected[Tick])
+        {
+            fprintf(stderr, "Tick %i: input %#x instead of %#x\n", Tick, Input, Expected[Tick]);
+            return false;
+        }
+    }
+
+    return Queue.Count == 0 && Queue.Held == 0;
+}
+
+static bool Check_InitField(gameplay *Gameplay, uint64_t Seed)
+{
+    GP_Init(Gameplay, Seed);
+    if (!Field_Init(&Gameplay->Field, BOARD_WIDTH, BOARD_HEIGHT) ||
+        !Field_TraceInit(&Gameplay->FieldTrace, &Gameplay->Field) ||
+        !Field_TraceInit(&Gameplay->FieldTraceJunk, &Gameplay->Field))
+    {
+        GP_Free(Gameplay);
+        return false;
+    }
+
+    return true;
+}
+
+// Mostly wires, enough sources to close circuits and a little junk and fire
+static piece Check_RandomPiece(rng *Rng)
+{
+    unsigned int Roll = Rng_Below(Rng, 100);
+    if (Roll < 30) return PIECE_EMPTY;
+    if (Roll < 80) return (piece)(PIECE_HCONN + Rng_Below(Rng, PIECE_UR - PIECE_HCONN + 1));
+    if (Roll < 92) return PIECE_DST;
+    if (Roll < 97) return PIECE_JUNK;
+    return PIECE_FIRE;
+}
+
+static bool Check_SameTrace(trace *Trace, field_trace *FieldTrace)
+{
+    if (Trace->Count != FieldTrace->Count || Trace->Junk != FieldTrace->Junk)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < Trace->Count; i++)
+    {
+        if (Trace->Cells[i] != FieldTrace->Cells[i]) return false;
+    }
+
+    return true;
+}
+
+// What tracing leaves for the game: the cells in order, their mask and whether it spread junk
+static bool Check_SameBoardTrace(trace *a, trace *b)
+{
+    return a->Count == b->Count && a->Junk == b->Junk && BB_Equal(a->Mask, b->Mask) &&
+        memcmp(a->Cells, b->Cells, a->Count) == 0;
+}
+
+static bool Check_SamePowers(power_board *Powers, field *Field)
+{
+    for (int i = 0; i < BOARD_CELLS; i++)
+    {
+        if (Powers->Incoming[i / BOARD_WIDTH][i % BOARD_WIDTH] != Field->Incoming[i]) return false;
+    }
+
+    return true;
+}
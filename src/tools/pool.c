@@ -0,0 +1,169 @@
+/*******************************************************************************************
+*
+*   Nettis tools - minimal parallel for
+*
+********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // clock_gettime() and sysconf() under -std=c99
+#endif
+
+#include "pool.h"
+
+#include <stdbool.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <time.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    pool_task Task;
+    void *Context;
+    int Count;
+    int Next;
+#if defined(_WIN32)
+    CRITICAL_SECTION Lock;
+#else
+    pthread_mutex_t Lock;
+#endif
+} pool_job;
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+static int Threads = 0;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static int Pool_Take(pool_job *Job);
+#if defined(_WIN32)
+static DWORD WINAPI Pool_Worker(LPVOID Argument);
+#else
+static void *Pool_Worker(void *Argument);
+#endif
+
+//--------------------------------------------------------------------------------------------
+// Module functions definition
+//--------------------------------------------------------------------------------------------
+int Pool_CpuCount(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    int Count = (int)Info.dwNumberOfProcessors;
+#else
+    int Count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return (Count < 1)? 1 : (Count > POOL_MAX_THREADS)? POOL_MAX_THREADS : Count;
+}
+
+void Pool_SetThreads(int Count)
+{
+    Threads = (Count <= 0)? 0 : (Count > POOL_MAX_THREADS)? POOL_MAX_THREADS : Count;
+}
+
+int Pool_Threads(void)
+{
+    return (Threads > 0)? Threads : Pool_CpuCount();
+}
+
+// The calling thread works too, Pool_Threads()-1 helpers are started at most
+void Pool_For(int Count, pool_task Task, void *Context)
+{
+    pool_job Job;
+    Job.Task = Task;
+    Job.Context = Context;
+    Job.Count = Count;
+    Job.Next = 0;
+
+    int Helpers = Pool_Threads() - 1;
+    if (Helpers > Count - 1) Helpers = Count - 1;
+
+    if (Helpers <= 0)
+    {
+        for (int i = 0; i < Count; i++) Task(Context, i);
+        return;
+    }
+
+#if defined(_WIN32)
+    HANDLE Handles[POOL_MAX_THREADS];
+    InitializeCriticalSection(&Job.Lock);
+    for (int t = 0; t < Helpers; t++) Handles[t] = CreateThread(NULL, 0, Pool_Worker, &Job, 0, NULL);
+    Pool_Worker(&Job);
+    for (int t = 0; t < Helpers; t++)
+    {
+        if (Handles[t] == NULL) continue;
+        WaitForSingleObject(Handles[t], INFINITE);
+        CloseHandle(Handles[t]);
+    }
+    DeleteCriticalSection(&Job.Lock);
+#else
+    pthread_t Handles[POOL_MAX_THREADS];
+    bool Started[POOL_MAX_THREADS];
+    pthread_mutex_init(&Job.Lock, NULL);
+    for (int t = 0; t < Helpers; t++) Started[t] = pthread_create(&Handles[t], NULL, Pool_Worker, &Job) == 0;
+    Pool_Worker(&Job);
+    for (int t = 0; t < Helpers; t++)
+    {
+        if (Started[t]) pthread_join(Handles[t], NULL);
+    }
+    pthread_mutex_destroy(&Job.Lock);
+#endif
+}
+
+double Pool_Seconds(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER Frequency, Counter;
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Counter);
+    return (double)Counter.QuadPart/(double)Frequency.QuadPart;
+#else
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (double)Now.tv_sec + (double)Now.tv_nsec*1e-9;
+#endif
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+// Next index to run, or -1 once the range is exhausted
+static int Pool_Take(pool_job *Job)
+{
+#if defined(_WIN32)
+    EnterCriticalSection(&Job->Lock);
+    int Index = (Job->Next < Job->Count)? Job->Next++ : -1;
+    LeaveCriticalSection(&Job->Lock);
+#else
+    pthread_mutex_lock(&Job->Lock);
+    int Index = (Job->Next < Job->Count)? Job->Next++ : -1;
+    pthread_mutex_unlock(&Job->Lock);
+#endif
+    return Index;
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI Pool_Worker(LPVOID Argument)
+#else
+static void *Pool_Worker(void *Argument)
+#endif
+{
+    pool_job *Job = Argument;
+
+    for (int i = Pool_Take(Job); i >= 0; i = Pool_Take(Job))
+    {
+        Job->Task(Job->Context, i);
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+/*******************************************************************************************
+*
+*   Nettis tools - minimal parallel for
+*
+*   Pool_For() runs a task for every index of a range on a fixed number of threads and
+*   returns when all of them are done. Indices are handed out one at a time, so uneven
+*   tasks still keep every thread busy. Threads are started per call: tasks are expected to
+*   be coarse (a beam level, a batch of games)
+*
+********************************************************************************************/
+
+#ifndef NETTIS_POOL_H
+#define NETTIS_POOL_H
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define POOL_MAX_THREADS 256
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef void (*pool_task)(void *Context, int Index);
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+int Pool_CpuCount(void);
+void Pool_SetThreads(int Threads);                                  // 0 uses every CPU
+int Pool_Threads(void);
+void Pool_For(int Count, pool_task Task, void *Context);
+double Pool_Seconds(void);                                          // Monotonic wall clock
+
+#endif // NETTIS_POOL_H
@@ -0,0 +1,225 @@
+/*******************************************************************************************
+*
+*   nettis_render - headless replay renderer
+*
+*   Plays a replay back and draws its frames with the software backend, no window or GPU
+*   needed. Frames are written as binary PPM, one after the other, which video encoders
+*   read as they are:
+*
+*       nettis_render game.ntrp --out - | ffmpeg -f image2pipe -c:v ppm -r 60 -i - game.mp4
+*
+*   --final writes the last frame alone and --expect compares it with a golden image, the
+*   exit code is 1 when they differ. --trace and --trace-slow work as in nettis_replay, the
+*   ticks and the drawing of each frame being zones of their own
+*
+*   Usage: nettis_render <file.ntrp> [--out <frames.ppm|->] [--every <ticks>]
+*                        [--final <frame.ppm>] [--expect <golden.ppm>]
+*                        [--trace <trace.json>] [--trace-slow <ms>]
+*
+********************************************************************************************/
+
+#include "core/gfx.h"
+#include "core/replay.h"
+#include "core/zone.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Render_WritePpm(FILE *File, gfx_framebuffer *Framebuffer);
+static bool Render_SavePpm(const char *FileName, gfx_framebuffer *Framebuffer);
+static bool Render_Matches(const char *FileName, gfx_framebuffer *Framebuffer);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    static gameplay Gameplay;
+    const char *ReplayFile = NULL;
+    const char *OutFile = NULL;
+    const char *FinalFile = NULL;
+    const char *ExpectFile = NULL;
+    const char *TraceFile = NULL;
+    double TraceSlow = 0.0;
+    int Every = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) OutFile = argv[++i];
+        else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) Every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--final") == 0 && i + 1 < argc) FinalFile = argv[++i];
+        else if (strcmp(argv[i], "--expect") == 0 && i + 1 < argc) ExpectFile = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) TraceFile = argv[++i];
+        else if (strcmp(argv[i], "--trace-slow") == 0 && i + 1 < argc) TraceSlow = atof(argv[++i])/1000.0;
+        else if (ReplayFile == NULL && argv[i][0] != '-') ReplayFile = argv[i];
+        else
+        {
+            ReplayFile = NULL;
+            break;
+        }
+    }
+
+    if (ReplayFile == NULL || Every < 1)
+    {
+        fprintf(stderr, "Usage: %s <file.ntrp> [--out <frames.ppm|->] [--every <ticks>] [--final <frame.ppm>] [--expect <golden.ppm>] [--trace <trace.json>] [--trace-slow <ms>]\n", argv[0]);
+        return 1;
+    }
+
+    replay Replay;
+    if (!Replay_Load(&Replay, ReplayFile))
+    {
+        fprintf(stderr, "%s: cannot load\n", ReplayFile);
+        return 1;
+    }
+
+    gfx_framebuffer Framebuffer;
+    if (!GFX_SoftInit(&Framebuffer, GFX_SCREEN_WIDTH, GFX_SCREEN_HEIGHT))
+    {
+        fprintf(stderr, "Out of memory\n");
+        Replay_Free(&Replay);
+        return 1;
+    }
+    gfx Gfx = GFX_Soft(&Framebuffer);
+
+    FILE *Out = NULL;
+    if (OutFile != NULL)
+    {
+        Out = (strcmp(OutFile, "-") == 0)? stdout : fopen(OutFile, "wb");
+        if (Out == NULL)
+        {
+            fprintf(stderr, "%s: cannot write\n", OutFile);
+            GFX_SoftFree(&Framebuffer);
+            Replay_Free(&Replay);
+            return 1;
+        }
+    }
+
+    zone_trace Trace = { 0 };
+    if (TraceFile != NULL)
+    {
+        if (!ZONE_ENABLED) fprintf(stderr, "Built without NETTIS_ZONES, %s will be empty\n", TraceFile);
+        if (Zone_Init(&Trace, ZONE_EVENTS, Pool_Seconds))
+        {
+            Trace.MinSeconds = TraceSlow;
+            Zone_Attach(&Trace);
+        }
+        else TraceFile = NULL;
+    }
+
+    // Frames are drawn after the tick they show, like the game does
+    replay_player Player;
+    unsigned long long Frames = 0;
+    double Seconds = 0.0;
+    bool Written = true;
+
+    Replay_Start(&Player, &Replay, &Gameplay);
+    while (Replay_Step(&Player, &Gameplay))
+    {
+        if (Player.Tick % Every != 0) continue;
+
+        clock_t Start = clock();
+        GFX_DrawGame(&Gfx, &Gameplay);
+        Seconds += (double)(clock() - Start)/CLOCKS_PER_SEC;
+        Frames++;
+
+        if (Out != NULL) Written = Written && Render_WritePpm(Out, &Framebuffer);
+    }
+    GFX_DrawGame(&Gfx, &Gameplay);
+
+    int Failed = 0;
+    if (Out != NULL && Out != stdout) fclose(Out);
+    if (!Written)
+    {
+        fprintf(stderr, "%s: write failed\n", OutFile);
+        Failed = 1;
+    }
+    if (FinalFile != NULL && !Render_SavePpm(FinalFile, &Framebuffer))
+    {
+        fprintf(stderr, "%s: cannot write\n", FinalFile);
+        Failed = 1;
+    }
+    if (ExpectFile != NULL && !Render_Matches(ExpectFile, &Framebuffer))
+    {
+        fprintf(stderr, "%s: last frame differs\n", ExpectFile);
+        Failed = 1;
+    }
+
+    // Progress goes to stderr, stdout may be carrying the frames
+    fprintf(stderr, "%s: %s, %llu frames in %.3f s, %.0f frames/s\n", ReplayFile, Replay_Matches(&Replay, &Gameplay)? "ok" : "DIVERGED",
+        Frames, Seconds, (Seconds > 0.0)? Frames/Seconds : 0.0);
+
+    if (TraceFile != NULL)
+    {
+        if (Zone_Save(&Trace, TraceFile)) fprintf(stderr, "%s: %i zones\n", TraceFile, Zone_Count(&Trace));
+        else
+        {
+            fprintf(stderr, "%s: cannot write\n", TraceFile);
+            Failed = 1;
+        }
+        Zone_Free(&Trace);
+    }
+
+    GFX_SoftFree(&Framebuffer);
+    Replay_Free(&Replay);
+    return Failed;
+}
+
+//------------------------------------------------------------------------------------
+// Module Functions Definition
+//------------------------------------------------------------------------------------
+static bool Render_WritePpm(FILE *File, gfx_framebuffer *Framebuffer)
+{
+    size_t Count = (size_t)Framebuffer->Width*Framebuffer->Height;
+    unsigned char *Rgb = malloc(Count*3);
+    if (Rgb == NULL) return false;
+
+    const unsigned char *Rgba = (const unsigned char *)Framebuffer->Pixels;
+    for (size_t i = 0; i < Count; i++)
+    {
+        Rgb[i*3 + 0] = Rgba[i*4 + 0];
+        Rgb[i*3 + 1] = Rgba[i*4 + 1];
+        Rgb[i*3 + 2] = Rgba[i*4 + 2];
+    }
+
+    bool Ok = fprintf(File, "P6\n%i %i\n255\n", Framebuffer->Width, Framebuffer->Height) > 0 &&
+        fwrite(Rgb, 3, Count, File) == Count;
+    free(Rgb);
+    return Ok;
+}
+
+static bool Render_SavePpm(const char *FileName, gfx_framebuffer *Framebuffer)
+{
+    FILE *File = fopen(FileName, "wb");
+    if (File == NULL) return false;
+
+    bool Ok = Render_WritePpm(File, Framebuffer);
+    return (fclose(File) == 0) && Ok;
+}
+
+// Only reads back what Render_WritePpm() writes
+static bool Render_Matches(const char *FileName, gfx_framebuffer *Framebuffer)
+{
+    FILE *File = fopen(FileName, "rb");
+    if (File == NULL) return false;
+
+    int Width = 0, Height = 0, Max = 0;
+    bool Match = fscanf(File, "P6 %i %i %i", &Width, &Height, &Max) == 3 && fgetc(File) == '\n' &&
+        Width == Framebuffer->Width && Height == Framebuffer->Height && Max == 255;
+
+    const unsigned char *Rgba = (const unsigned char *)Framebuffer->Pixels;
+    for (size_t i = 0; Match && i < (size_t)Width*Height; i++)
+    {
+        unsigned char Rgb[3];
+        Match = fread(Rgb, 1, 3, File) == 3 &&
+            Rgb[0] == Rgba[i*4 + 0] && Rgb[1] == Rgba[i*4 + 1] && Rgb[2] == Rgba[i*4 + 2];
+    }
+
+    fclose(File);
+    return Match;
+}
@@ -0,0 +1,107 @@
+/*******************************************************************************************
+*
+*   nettis_replay - headless replay player
+*
+*   Plays every replay given on the command line at full speed and checks that it ends
+*   with the recorded score and board. Exits with 1 if any replay diverged or failed to load
+*
+*   --trace writes the zones of the run as a Chrome trace, in builds with NETTIS_ZONES, and
+*   --trace-slow keeps only the ticks that took at least that many milliseconds
+*
+*   Usage: nettis_replay <file.ntrp> [more.ntrp ...] [--trace <trace.json>] [--trace-slow <ms>]
+*
+********************************************************************************************/
+
+#include "core/replay.h"
+#include "core/zone.h"
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    static gameplay Gameplay;
+    int Failed = 0;
+    double TotalSeconds = 0.0;
+    unsigned long long TotalTicks = 0;
+    const char *TraceFile = NULL;
+    double TraceSlow = 0.0;
+    int Files = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) TraceFile = argv[++i];
+        else if (strcmp(argv[i], "--trace-slow") == 0 && i + 1 < argc) TraceSlow = atof(argv[++i])/1000.0;
+        else if (argv[i][0] != '-') Files++;
+        else Files = -argc;
+    }
+
+    if (Files <= 0)
+    {
+        fprintf(stderr, "Usage: %s <file.ntrp> [more.ntrp ...] [--trace <trace.json>] [--trace-slow <ms>]\n", argv[0]);
+        return 1;
+    }
+
+    zone_trace Trace = { 0 };
+    if (TraceFile != NULL)
+    {
+        if (!ZONE_ENABLED) fprintf(stderr, "Built without NETTIS_ZONES, %s will be empty\n", TraceFile);
+        if (!Zone_Init(&Trace, ZONE_EVENTS, Pool_Seconds))
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        Trace.MinSeconds = TraceSlow;
+        Zone_Attach(&Trace);
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--trace", 7) == 0)
+        {
+            i++;
+            continue;
+        }
+
+        replay Replay;
+        if (!Replay_Load(&Replay, argv[i]))
+        {
+            printf("%s: cannot load\n", argv[i]);
+            Failed++;
+            continue;
+        }
+
+        clock_t Start = clock();
+        bool Match = Replay_Play(&Replay, &Gameplay);
+        double Seconds = (double)(clock() - Start)/CLOCKS_PER_SEC;
+
+        printf("%s: %s, %u ticks, score %i (recorded %i), hash %016llx, %.3f ms\n", argv[i], Match? "ok" : "DIVERGED",
+            Replay.Ticks, Gameplay.Scoring.Score, Replay.Score, (unsigned long long)GP_Hash(&Gameplay), Seconds*1000.0);
+
+        TotalSeconds += Seconds;
+        TotalTicks += Replay.Ticks;
+        if (!Match) Failed++;
+
+        Replay_Free(&Replay);
+    }
+
+    if (TotalSeconds > 0.0)
+    {
+        printf("%llu ticks in %.3f s, %.0f ticks/s\n", TotalTicks, TotalSeconds, TotalTicks/TotalSeconds);
+    }
+
+    if (TraceFile != NULL)
+    {
+        if (Zone_Save(&Trace, TraceFile)) printf("%s: %i zones\n", TraceFile, Zone_Count(&Trace));
+        else printf("%s: cannot write\n", TraceFile);
+        Zone_Free(&Trace);
+    }
+
+    return (Failed > 0)? 1 : 0;
+}
@@ -0,0 +1,384 @@
+/*******************************************************************************************
+*
+*   nettis_versus - rollback versus matches over loopback, through a latency proxy
+*
+*   Without "proxy", plays a whole match between two bots in one process. Each bot is a
+*   peer with its own copy of the match, talking to the other over UDP on 127.0.0.1 through
+*   a proxy that delays, jitters and drops packets. Time is simulated, a frame every tick,
+*   so a long match takes seconds. The tool reports the rollbacks, their cost, and whether
+*   both peers ended up with the same match, and exits with 1 when they did not or either
+*   saw a desync. ctest runs a short match.
+*
+*   With "proxy", only runs the proxy in real time, for two games started with --versus
+*   pointing at its port and the same --seed. The first two ports that send to it are the players
+*
+*   Usage: nettis_versus [frames] [delay ms] [jitter ms] [loss %] [seed]
+*          nettis_versus proxy <port> [delay ms] [jitter ms] [loss %]
+*
+********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L     // nanosleep() under -std=c99
+#endif
+
+#include "core/versus.h"
+#include "core/net.h"
+#include "core/bot.h"
+#include "core/rng.h"
+#include "pool.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define VERSUS_DEFAULT_FRAMES (GP_TICKS_PER_SECOND*60*5)
+#define VERSUS_DEFAULT_DELAY 50.0           // One way, in milliseconds
+#define VERSUS_DEFAULT_JITTER 10.0
+#define VERSUS_DEFAULT_LOSS 2
+#define VERSUS_BOT_DEPTH 2
+#define VERSUS_BOT_WIDTH 4                  // Player 2 searches half as wide, so the games part
+
+#define PROXY_QUEUE 1024                    // Packets in flight
+#define PROXY_PACKET 256
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+typedef struct {
+    double Due;
+    int To;                                 // Port
+    int Size;
+    unsigned char Data[PROXY_PACKET];
+} proxy_packet;
+
+typedef struct {
+    net_socket Socket;
+    int Peers[2];                           // Ports, 0 until they first send
+    double Delay;                           // Seconds
+    double Jitter;
+    int Loss;                               // Percent
+    rng Rng;
+    proxy_packet Queue[PROXY_QUEUE];
+    int Count;
+    unsigned long long Forwarded;
+    unsigned long long Dropped;
+} proxy;
+
+typedef struct {
+    versus Versus;
+    net_socket Socket;
+    bot Bot;
+    unsigned int Stalls;                    // Frames spent waiting for the other peer
+    double Seconds;                         // In Versus_Advance() calls that rolled back
+    double Worst;
+} peer;
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Declaration
+//----------------------------------------------------------------------------------
+static bool Proxy_Open(proxy *Proxy, int Port, double DelayMs, double JitterMs, int Loss);
+static void Proxy_Pump(proxy *Proxy, double Now);
+static void Peer_Receive(peer *Peer);
+static void Peer_Frame(peer *Peer);
+static int RunProxy(int argc, char **argv);
+static void Sleep_Seconds(double Seconds);
+static bool Arg_ParseInt(int argc, char **argv, int Index, int Default, int Min, int Max, int *Value);
+static bool Arg_ParseMs(int argc, char **argv, int Index, double Default, double *Value);
+static bool Arg_ParseSeed(int argc, char **argv, int Index, uint64_t Default, uint64_t *Value);
+
+//------------------------------------------------------------------------------------
+// Program main entry point
+//------------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "proxy") == 0)
+    {
+        return RunProxy(argc, argv);
+    }
+
+    int Frames, Loss;
+    double Delay, Jitter;
+    uint64_t Seed;
+    if (argc > 6 || !Arg_ParseInt(argc, argv, 1, VERSUS_DEFAULT_FRAMES, 1, INT_MAX, &Frames) ||
+        !Arg_ParseMs(argc, argv, 2, VERSUS_DEFAULT_DELAY, &Delay) ||
+        !Arg_ParseMs(argc, argv, 3, VERSUS_DEFAULT_JITTER, &Jitter) ||
+        !Arg_ParseInt(argc, argv, 4, VERSUS_DEFAULT_LOSS, 0, 100, &Loss) ||
+        !Arg_ParseSeed(argc, argv, 5, 1, &Seed))
+    {
+        fprintf(stderr, "Usage: %s [frames] [delay ms] [jitter ms] [loss %%] [seed], frames above zero, "
+            "loss up to 100\n", argv[0]);
+        return 1;
+    }
+
+    static proxy Proxy;
+    static peer Peers[VERSUS_PLAYERS];
+
+    if (!Proxy_Open(&Proxy, 0, Delay, Jitter, Loss))
+    {
+        fprintf(stderr, "Cannot open the proxy socket\n");
+        return 1;
+    }
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Versus_Init(&Peers[p].Versus, Seed, p);
+        if (!Net_Open(&Peers[p].Socket, 0) || !Bot_Init(&Peers[p].Bot, VERSUS_BOT_DEPTH, VERSUS_BOT_WIDTH >> p, NULL))
+        {
+            fprintf(stderr, "Cannot set up player %i\n", p + 1);
+            return 1;
+        }
+        Proxy.Peers[p] = Peers[p].Socket.Port;
+    }
+
+    printf("%i frames, %.0f ms delay, %.0f ms jitter, %i%% loss\n", Frames, Delay, Jitter, Loss);
+
+    // Runs until both peers played every frame and have all the other's inputs
+    int Frame = 0;
+    for (; Frame < Frames*2; Frame++)
+    {
+        double Now = (double)Frame/GP_TICKS_PER_SECOND;
+        bool Done = true;
+
+        for (int p = 0; p < VERSUS_PLAYERS; p++)
+        {
+            peer *Peer = &Peers[p];
+            Peer_Receive(Peer);
+            if (Peer->Versus.Match.Frame < (unsigned int)Frames) Peer_Frame(Peer);
+            else Versus_Sync(&Peer->Versus);
+
+            versus_packet Packet;
+            Versus_MakePacket(&Peer->Versus, &Packet);
+            Net_Send(&Peer->Socket, Proxy.Socket.Port, &Packet, sizeof(Packet));
+
+            if (Versus_Confirmed(&Peer->Versus) < (unsigned int)Frames) Done = false;
+        }
+        Proxy_Pump(&Proxy, Now);
+
+        if (Done) break;
+    }
+
+    bool Same = Versus_MatchHash(&Peers[0].Versus.Match) == Versus_MatchHash(&Peers[1].Versus.Match);
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        peer *Peer = &Peers[p];
+        versus *Versus = &Peer->Versus;
+        versus_tally *Tally = &Versus->Match.Tally;
+
+        printf("peer %i: frame %u, %llu rollbacks replaying %llu frames (deepest %u), %u stalls, "
+            "rollback %.1f us average, %.1f us worst%s\n", p + 1, Versus->Match.Frame,
+            Versus->Rollbacks, Versus->Replayed, Versus->Deepest, Peer->Stalls,
+            (Versus->Rollbacks > 0)? Peer->Seconds*1e6/Versus->Rollbacks : 0.0, Peer->Worst*1e6,
+            Versus->Desynced? ", DESYNCED" : "");
+        if (p == 0)
+        {
+            printf("match: scores %i / %i, junk sent %i / %i, lost %i / %i\n",
+                Tally->LastScore[0], Tally->LastScore[1], Tally->Sent[0], Tally->Sent[1], Tally->Losses[0], Tally->Losses[1]);
+        }
+    }
+    printf("proxy: %llu packets forwarded, %llu dropped\n", Proxy.Forwarded, Proxy.Dropped);
+    printf("%s\n", Same? "peers agree" : "PEERS DIVERGED");
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++)
+    {
+        Bot_Free(&Peers[p].Bot);
+        Net_Close(&Peers[p].Socket);
+        GP_Free(&Peers[p].Versus.Match.Games[0]);
+        GP_Free(&Peers[p].Versus.Match.Games[1]);
+    }
+    Net_Close(&Proxy.Socket);
+
+    return (Same && !Peers[0].Versus.Desynced && !Peers[1].Versus.Desynced)? 0 : 1;
+}
+
+//----------------------------------------------------------------------------------
+// Module Internal Functions Definition
+//----------------------------------------------------------------------------------
+static bool Proxy_Open(proxy *Proxy, int Port, double DelayMs, double JitterMs, int Loss)
+{
+    *Proxy = (proxy){ 0 };
+    Proxy->Delay = DelayMs/1000.0;
+    Proxy->Jitter = JitterMs/1000.0;
+    Proxy->Loss = Loss;
+    Rng_Seed(&Proxy->Rng, 0x5EED);
+    return Net_Open(&Proxy->Socket, Port);
+}
+
+// Takes every waiting packet into the queue, then sends the ones due by Now
+static void Proxy_Pump(proxy *Proxy, double Now)
+{
+    unsigned char Data[PROXY_PACKET];
+    int From, Size;
+
+    while ((Size = Net_Receive(&Proxy->Socket, Data, sizeof(Data), &From)) > 0)
+    {
+        if (Proxy->Peers[0] == 0) Proxy->Peers[0] = From;
+        else if (Proxy->Peers[1] == 0 && From != Proxy->Peers[0]) Proxy->Peers[1] = From;
+
+        int To = (From == Proxy->Peers[0])? Proxy->Peers[1] : (From == Proxy->Peers[1])? Proxy->Peers[0] : 0;
+        if (To == 0 || Proxy->Count == PROXY_QUEUE || (int)Rng_Below(&Proxy->Rng, 100) < Proxy->Loss)
+        {
+            Proxy->Dropped++;
+            continue;
+        }
+
+        proxy_packet *Packet = &Proxy->Queue[Proxy->Count++];
+        Packet->Due = Now + Proxy->Delay + Proxy->Jitter*Rng_Below(&Proxy->Rng, 1001)/1000.0;
+        Packet->To = To;
+        Packet->Size = Size;
+        memcpy(Packet->Data, Data, Size);
+    }
+
+    for (int i = 0; i < Proxy->Count;)
+    {
+        proxy_packet *Packet = &Proxy->Queue[i];
+        if (Packet->Due > Now)
+        {
+            i++;
+            continue;
+        }
+
+        Net_Send(&Proxy->Socket, Packet->To, Packet->Data, Packet->Size);
+        Proxy->Forwarded++;
+        *Packet = Proxy->Queue[--Proxy->Count];
+    }
+}
+
+static void Peer_Receive(peer *Peer)
+{
+    versus_packet Packet;
+    while (Net_Receive(&Peer->Socket, &Packet, sizeof(Packet), NULL) == sizeof(Packet))
+    {
+        Versus_ReadPacket(&Peer->Versus, &Packet);
+    }
+}
+
+// The bot decides on the game as this peer sees it, predictions included
+static void Peer_Frame(peer *Peer)
+{
+    versus *Versus = &Peer->Versus;
+    unsigned int Input = Bot_Play(&Peer->Bot, &Versus->Match.Games[Versus->Local]);
+    unsigned long long Rollbacks = Versus->Rollbacks;
+
+    double Start = Pool_Seconds();
+    bool Played = Versus_Advance(Versus, Input);
+    double Seconds = Pool_Seconds() - Start;
+
+    if (Versus->Rollbacks != Rollbacks)
+    {
+        Peer->Seconds += Seconds;
+        if (Seconds > Peer->Worst) Peer->Worst = Seconds;
+    }
+    if (!Played) Peer->Stalls++;
+}
+
+static int RunProxy(int argc, char **argv)
+{
+    int Port, Loss;
+    double Delay, Jitter;
+    if (argc < 3 || argc > 6 || !Arg_ParseInt(argc, argv, 2, 0, 1, 65535, &Port) ||
+        !Arg_ParseMs(argc, argv, 3, VERSUS_DEFAULT_DELAY, &Delay) ||
+        !Arg_ParseMs(argc, argv, 4, VERSUS_DEFAULT_JITTER, &Jitter) ||
+        !Arg_ParseInt(argc, argv, 5, VERSUS_DEFAULT_LOSS, 0, 100, &Loss))
+    {
+        fprintf(stderr, "Usage: %s proxy <port> [delay ms] [jitter ms] [loss %%], port 1 to 65535, "
+            "loss up to 100. Start both games with the same --seed\n", argv[0]);
+        return 1;
+    }
+
+    static proxy Proxy;
+    if (!Proxy_Open(&Proxy, Port, Delay, Jitter, Loss))
+    {
+        fprintf(stderr, "Cannot listen on port %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("Proxy on port %i, %.0f ms delay, %.0f ms jitter, %i%% loss\n", Proxy.Socket.Port, Delay, Jitter, Loss);
+    printf("Start both games with --versus <own port> %i <player> and the same --seed\n", Proxy.Socket.Port);
+    double Start = Pool_Seconds();
+    while (true)
+    {
+        Proxy_Pump(&Proxy, Pool_Seconds() - Start);
+        Sleep_Seconds(0.0005);
+    }
+}
+
+static void Sleep_Seconds(double Seconds)
+{
+#if defined(_WIN32)
+    Sleep((DWORD)(Seconds*1000.0 + 0.5));
+#else
+    struct timespec Time = { 0, (long)(Seconds*1e9) };
+    nanosleep(&Time, NULL);
+#endif
+}
+
+// Positional argument Index, Default when it is not given. False unless it is a whole number
+// from Min to Max
+static bool Arg_ParseInt(int argc, char **argv, int Index, int Default, int Min, int Max, int *Value)
+{
+    if (argc <= Index)
+    {
+        *Value = Default;
+        return true;
+    }
+
+    char *End;
+    long Number = strtol(argv[Index], &End, 10);
+    if (End == argv[Index] || *End != '\0' || Number < Min || Number > Max)
+    {
+        return false;
+    }
+
+    *Value = (int)Number;
+    return true;
+}
+
+// Milliseconds, zero or more and under a minute
+static bool Arg_ParseMs(int argc, char **argv, int Index, double Default, double *Value)
+{
+    if (argc <= Index)
+    {
+        *Value = Default;
+        return true;
+    }
+
+    char *End;
+    double Number = strtod(argv[Index], &End);
+    if (End == argv[Index] || *End != '\0' || !isfinite(Number) || Number < 0.0 || Number >= 60000.0)
+    {
+        return false;
+    }
+
+    *Value = Number;
+    return true;
+}
+
+static bool Arg_ParseSeed(int argc, char **argv, int Index, uint64_t Default, uint64_t *Value)
+{
+    if (argc <= Index)
+    {
+        *Value = Default;
+        return true;
+    }
+
+    char *End;
+    unsigned long long Number = strtoull(argv[Index], &End, 10);
+    if (End == argv[Index] || *End != '\0' || argv[Index][0] == '-')
+    {
+        return false;
+    }
+
+    *Value = (uint64_t)Number;
+    return true;
+}